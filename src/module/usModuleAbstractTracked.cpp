@@ -0,0 +1,488 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usModuleAbstractTracked_p.h"
+
+#include "usUtils_p.h"
+
+US_BEGIN_NAMESPACE
+
+const bool ModuleAbstractTracked::DEBUG_OUTPUT = false;
+
+TrackedObject::TrackedObject(void* object, Deleter deleter)
+  : object(object), deleter(deleter)
+{
+}
+
+TrackedObject::~TrackedObject()
+{
+  deleter(object);
+}
+
+ModuleAbstractTracked::RankingKey::RankingKey()
+  : ranking(0), id(0)
+{
+}
+
+ModuleAbstractTracked::RankingKey::RankingKey(int ranking, long int id)
+  : ranking(ranking), id(id)
+{
+}
+
+bool ModuleAbstractTracked::RankingKey::operator<(const RankingKey& other) const
+{
+  if (ranking != other.ranking)
+  {
+    return ranking > other.ranking;
+  }
+  return id < other.id;
+}
+
+ModuleAbstractTracked::TrackedItem::TrackedItem(ServiceReferenceU item,
+                                                const TrackedObjectPointer& object,
+                                                int ranking)
+  : item(item), object(object), ranking(ranking)
+{
+}
+
+class ModuleAbstractTracked::TrackInitialTask : public ServiceTask
+{
+
+public:
+
+  TrackInitialTask(ModuleAbstractTracked* tracked, ServiceReferenceU item)
+    : m_tracked(tracked), m_item(item)
+  {
+  }
+
+  void Run()
+  {
+    m_tracked->TrackInitialTaskRun(m_item);
+  }
+
+private:
+
+  ModuleAbstractTracked* const m_tracked;
+  const ServiceReferenceU m_item;
+
+  // purposely not implemented
+  TrackInitialTask(const TrackInitialTask&);
+  TrackInitialTask& operator=(const TrackInitialTask&);
+};
+
+ModuleAbstractTracked::ModuleAbstractTracked()
+  : pendingInitial(0)
+{
+  closed = false;
+  this->SetLockName("ServiceTracker::tracked");
+}
+
+ModuleAbstractTracked::~ModuleAbstractTracked()
+{
+
+}
+
+void ModuleAbstractTracked::SetInitial(const std::vector<ServiceReferenceU>& initiallist)
+{
+  for (std::vector<ServiceReferenceU>::const_iterator item = initiallist.begin();
+       item != initiallist.end(); ++item)
+  {
+    if (initialIndex.find(*item) == initialIndex.end())
+    {
+      initialIndex.insert(std::make_pair(*item, initial.insert(initial.end(), *item)));
+    }
+  }
+
+  if (DEBUG_OUTPUT)
+  {
+    for(std::list<ServiceReferenceU>::const_iterator item = initial.begin();
+      item != initial.end(); ++item)
+    {
+      US_DEBUG << "ModuleAbstractTracked::setInitial: " << (*item);
+    }
+  }
+}
+
+void ModuleAbstractTracked::TrackInitial(ServiceExecutor* executor)
+{
+  while (true)
+  {
+    ServiceReferenceU item;
+    {
+      Lock lock(this); US_UNUSED(lock);
+      if (closed || initial.empty())
+      {
+        /*
+         * if there are no more initial items, wait for the
+         * items handed to the executor
+         */
+#ifdef US_ENABLE_THREADING_SUPPORT
+        while (pendingInitial > 0)
+        {
+          this->Wait();
+        }
+#endif
+        return; /* we are done */
+      }
+      /*
+       * move the first item from the initial list to the adding list
+       * within this synchronized block.
+       */
+      item = initial.front();
+      initialIndex.erase(item);
+      initial.pop_front();
+      if (GetCustomizedObject_unlocked(GetRankingKey(item)))
+      {
+        /* if we are already tracking this item */
+        US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackInitial[already tracked]: " << item;
+        continue; /* skip this item */
+      }
+      if (adding.count(item) != 0)
+      {
+        /*
+         * if this item is already in the process of being added.
+         */
+        US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackInitial[already adding]: " << item;
+        continue; /* skip this item */
+      }
+      adding.insert(item);
+      if (executor)
+      {
+        initialTasks.insert(item);
+        ++pendingInitial;
+      }
+    }
+    US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackInitial: " << item;
+    if (executor)
+    {
+      /* the task only runs the customizer if it still owns adding the
+       * item, or decrements pendingInitial if it was cancelled */
+      executor->Execute(new TrackInitialTask(this, item));
+      continue;
+    }
+    TrackAdding(item, ServiceEvent());
+    /*
+     * Begin tracking it. We call trackAdding
+     * since we have already put the item in the
+     * adding list.
+     */
+  }
+}
+
+void ModuleAbstractTracked::TrackInitialTaskRun(ServiceReferenceU item)
+{
+  bool cancelled = false;
+  {
+    Lock lock(this); US_UNUSED(lock);
+    /* the item was untracked, possibly tracked again by an event, or the
+     * tracker closed before the task ran */
+    const bool owned = initialTasks.erase(item) != 0;
+    cancelled = closed || !owned;
+    if (cancelled && owned)
+    {
+      adding.erase(item);
+    }
+  }
+  if (cancelled)
+  {
+    US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackInitial[cancelled]: " << item;
+  }
+  else
+  {
+    try
+    {
+      TrackAdding(item, ServiceEvent());
+    }
+    catch (const std::exception& e)
+    {
+      US_WARN << "Tracking the initial item " << item << " failed: " << e.what();
+    }
+    catch (...)
+    {
+      US_WARN << "Tracking the initial item " << item << " failed";
+    }
+  }
+
+  Lock lock(this); US_UNUSED(lock);
+  if (--pendingInitial == 0)
+  {
+    this->NotifyAll(); /* wake up TrackInitial */
+  }
+}
+
+void ModuleAbstractTracked::Close()
+{
+  closed = true;
+}
+
+void ModuleAbstractTracked::Track(ServiceReferenceU item, ServiceEvent related)
+{
+  TrackedObjectPointer object;
+  /* read the ranking outside of synchronized region */
+  const RankingKey key = GetRankingKey(item);
+  {
+    Lock lock(this); US_UNUSED(lock);
+    if (closed)
+    {
+      return;
+    }
+    object = GetCustomizedObject_unlocked(key);
+    if (!object)
+    { /* we are not tracking the item */
+      if (adding.count(item) != 0)
+      {
+        /* if this item is already in the process of being added. */
+        US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::track[already adding]: " << item;
+        return;
+      }
+      adding.insert(item); /* mark this item is being added */
+    }
+    else
+    { /* we are currently tracking this item */
+      US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::track[modified]: " << item;
+      SetRanking_unlocked(key);
+      Modified(); /* increment modification count */
+    }
+  }
+
+  if (!object)
+  { /* we are not tracking the item */
+    TrackAdding(item, related);
+  }
+  else
+  {
+    /* Call customizer outside of synchronized region */
+    CustomizerModified(item, related, object);
+    /*
+     * If the customizer throws an unchecked exception, it is safe to
+     * let it propagate
+     */
+  }
+}
+
+void ModuleAbstractTracked::Untrack(ServiceReferenceU item, ServiceEvent related)
+{
+  TrackedObjectPointer object;
+  const RankingKey key = GetRankingKey(item);
+  {
+    Lock lock(this); US_UNUSED(lock);
+    InitialIndex::iterator initialIter = initialIndex.find(item);
+    if (initialIter != initialIndex.end())
+    { /* if this item is already in the list
+       * of initial references to process
+       */
+      initial.erase(initialIter->second);
+      initialIndex.erase(initialIter);
+      US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::untrack[removed from initial]: " << item;
+      return; /* we have removed it from the list and it will not be
+               * processed
+               */
+    }
+
+    if (adding.erase(item) != 0)
+    { /* if the item is in the process of
+       * being added
+       */
+      initialTasks.erase(item); /* cancel a pending initial task */
+      US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::untrack[being added]: " << item;
+      return; /*
+           * in case the item is untracked while in the process of
+           * adding
+           */
+    }
+    /*
+     * must remove from tracker before
+     * calling customizer callback
+     */
+    object = RemoveTracked_unlocked(key);
+    if (!object)
+    { /* are we actually tracking the item */
+      return;
+    }
+    Modified(); /* increment modification count */
+  }
+  US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::untrack[removed]: " << item;
+  /* Call customizer outside of synchronized region */
+  CustomizerRemoved(item, related, object);
+  /*
+   * If the customizer throws an unchecked exception, it is safe to let it
+   * propagate
+   */
+}
+
+std::size_t ModuleAbstractTracked::Size() const
+{
+  return tracked.size();
+}
+
+bool ModuleAbstractTracked::IsEmpty() const
+{
+  return tracked.empty();
+}
+
+TrackedObjectPointer ModuleAbstractTracked::GetCustomizedObject(ServiceReferenceU item) const
+{
+  return GetCustomizedObject_unlocked(GetRankingKey(item));
+}
+
+void ModuleAbstractTracked::GetTracked(std::vector<ServiceReferenceU>& items) const
+{
+  for (TrackedItemMap::const_iterator i = tracked.begin();
+       i != tracked.end(); ++i)
+  {
+    items.push_back(i->second.item);
+  }
+}
+
+TrackedObjectPointer ModuleAbstractTracked::GetHighestRanked() const
+{
+  if (ranked.empty()) return TrackedObjectPointer();
+  return GetCustomizedObject_unlocked(ranked.begin()->first);
+}
+
+void ModuleAbstractTracked::GetRanked(std::vector<RankedObject>& items) const
+{
+  for (RankingMap::const_iterator i = ranked.begin(); i != ranked.end(); ++i)
+  {
+    items.push_back(std::make_pair(i->first, GetCustomizedObject_unlocked(i->first)));
+  }
+}
+
+void ModuleAbstractTracked::Modified()
+{
+  trackingCount.Ref();
+}
+
+int ModuleAbstractTracked::GetTrackingCount() const
+{
+  return trackingCount;
+}
+
+bool ModuleAbstractTracked::CustomizerAddingFinal(ServiceReferenceU item,
+                                                  const TrackedObjectPointer& custom,
+                                                  const RankingKey& key)
+{
+  Lock lock(this); US_UNUSED(lock);
+  if (adding.erase(item) != 0 && !closed)
+  {
+    /*
+     * if the item was not untracked during the customizer
+     * callback
+     */
+    if (custom)
+    {
+      SetTracked_unlocked(item, custom, key);
+      Modified(); /* increment modification count */
+      this->NotifyAll(); /* notify any waiters */
+    }
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+void ModuleAbstractTracked::TrackAdding(ServiceReferenceU item, ServiceEvent related)
+{
+  US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackAdding:" << item;
+  TrackedObjectPointer object;
+  bool becameUntracked = false;
+  RankingKey key;
+  /* Call customizer outside of synchronized region */
+  try
+  {
+    object = CustomizerAdding(item, related);
+    if (object)
+    {
+      key = GetRankingKey(item);
+    }
+    becameUntracked = this->CustomizerAddingFinal(item, object, key);
+  }
+  catch (...)
+  {
+    /*
+     * If the customizer throws an exception, it will
+     * propagate after the cleanup code.
+     */
+    this->CustomizerAddingFinal(item, object, key);
+    throw;
+  }
+
+  if (!becameUntracked && object)
+  {
+    /* Call outside of synchronized region */
+    ItemAdded(item, object);
+  }
+
+  /*
+   * The item became untracked during the customizer callback.
+   */
+  if (becameUntracked && object)
+  {
+    US_DEBUG(DEBUG_OUTPUT) << "ModuleAbstractTracked::trackAdding[removed]: " << item;
+    /* Call customizer outside of synchronized region */
+    CustomizerRemoved(item, related, object);
+    /*
+     * If the customizer throws an unchecked exception, it is safe to
+     * let it propagate
+     */
+  }
+}
+
+TrackedObjectPointer ModuleAbstractTracked::GetCustomizedObject_unlocked(const RankingKey& key) const
+{
+  TrackedItemMap::const_iterator i = tracked.find(key.id);
+  if (i != tracked.end()) return i->second.object;
+  return TrackedObjectPointer();
+}
+
+void ModuleAbstractTracked::SetTracked_unlocked(ServiceReferenceU item,
+                                                const TrackedObjectPointer& object,
+                                                const RankingKey& key)
+{
+  RemoveTracked_unlocked(key);
+  tracked.insert(std::make_pair(key.id, TrackedItem(item, object, key.ranking)));
+  ranked.insert(std::make_pair(key, item));
+}
+
+void ModuleAbstractTracked::SetRanking_unlocked(const RankingKey& key)
+{
+  TrackedItemMap::iterator i = tracked.find(key.id);
+  if (i == tracked.end() || i->second.ranking == key.ranking) return;
+
+  ranked.erase(RankingKey(i->second.ranking, key.id));
+  i->second.ranking = key.ranking;
+  ranked.insert(std::make_pair(key, i->second.item));
+}
+
+TrackedObjectPointer ModuleAbstractTracked::RemoveTracked_unlocked(const RankingKey& key)
+{
+  TrackedItemMap::iterator i = tracked.find(key.id);
+  if (i == tracked.end()) return TrackedObjectPointer();
+
+  TrackedObjectPointer object = i->second.object;
+  ranked.erase(RankingKey(i->second.ranking, key.id));
+  tracked.erase(i);
+  return object;
+}
+
+US_END_NAMESPACE
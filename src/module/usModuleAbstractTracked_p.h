@@ -24,12 +24,51 @@
 #define USMODULEABSTRACTTRACKED_H
 
 #include <vector>
+#include <list>
+#include <map>
 
 #include "usAtomicInt_p.h"
+#include "usThreads_p.h"
 #include "usAny.h"
+#include "usSharedData.h"
+#include "usServiceEvent.h"
+#include "usServiceExecutor.h"
+#include "usServiceReference.h"
 
 US_BEGIN_NAMESPACE
 
+/**
+ * The customized object of a tracked item. It is shared by the tracker and
+ * the snapshots and caches referring to it and is destroyed, together with
+ * the type-erased object, when the last of them releases it.
+ */
+class TrackedObject : public SharedData
+{
+
+public:
+
+  typedef void (*Deleter)(void*);
+
+  TrackedObject(void* object, Deleter deleter);
+
+  ~TrackedObject();
+
+  /**
+   * The object created by the typed <code>ServiceTracker</code>.
+   */
+  void* const object;
+
+private:
+
+  const Deleter deleter;
+
+  // purposely not implemented
+  TrackedObject(const TrackedObject&);
+  TrackedObject& operator=(const TrackedObject&);
+};
+
+typedef ExplicitlySharedDataPointer<TrackedObject> TrackedObjectPointer;
+
 /**
  * This class is not intended to be used directly. It is exported to support
  * the CppMicroServices module system.
@@ -41,23 +80,39 @@ US_BEGIN_NAMESPACE
  * tracked items. This is not a public class. It is only for use by the
  * implementation of the Tracker class.
  *
- * @tparam S The tracked item. It is the key.
- * @tparam T The value mapped to the tracked item.
- * @tparam R The reason the tracked item is  being tracked or untracked.
+ * The tracked items are service references and the customized objects are
+ * type-erased <code>TrackedObject</code> instances, so this class is compiled
+ * once into the library for all tracked service types. A null customized
+ * object means that the item is not tracked.
+ *
  * @ThreadSafe
  */
-template<class S, class TTT, class R>
 class ModuleAbstractTracked : public MultiThreaded<MutexLockingStrategy,WaitCondition>
 {
 
 public:
 
-  typedef typename TTT::TrackedType T;
-
   /* set this to true to compile in debug messages */
   static const bool DEBUG_OUTPUT; // = false;
 
-  typedef std::map<S,T> TrackingMap;
+  /**
+   * Sort key of a tracked item. Keys with a higher ranking order first,
+   * keys with equal ranking are ordered by ascending id.
+   */
+  struct RankingKey
+  {
+    RankingKey();
+    RankingKey(int ranking, long int id);
+
+    bool operator<(const RankingKey& other) const;
+
+    int ranking;
+    long int id;
+  };
+
+  typedef std::map<RankingKey,ServiceReferenceU> RankingMap;
+
+  typedef std::pair<RankingKey,TrackedObjectPointer> RankedObject;
 
   /**
    * ModuleAbstractTracked constructor.
@@ -77,7 +132,7 @@ public:
    *        entries in the list are ignored.
    * @GuardedBy this
    */
-  void SetInitial(const std::vector<S>& list);
+  void SetInitial(const std::vector<ServiceReferenceU>& list);
 
   /**
    * Track the initial list of items. This is called after events can begin to
@@ -86,8 +141,16 @@ public:
    * This method must be called from Tracker's open method while not
    * synchronized on this object after the add listener call.
    *
+   * If an executor is given, the customizer adding method is called for
+   * the initial items from tasks run by the executor. This method then
+   * returns after all tasks completed or were cancelled, because their
+   * item became untracked before the task ran. Exceptions thrown by the
+   * customizer in a task are logged and the item is not tracked.
+   *
+   * @param executor The executor to run the customizer calls, or
+   *        <code>null</code> to call them from the calling thread.
    */
-  void TrackInitial();
+  void TrackInitial(ServiceExecutor* executor = 0);
 
   /**
    * Called by the owning Tracker object when it is closed.
@@ -97,18 +160,18 @@ public:
   /**
    * Begin to track an item.
    *
-   * @param item S to be tracked.
+   * @param item Item to be tracked.
    * @param related Action related object.
    */
-  void Track(S item, R related);
+  void Track(ServiceReferenceU item, ServiceEvent related);
 
   /**
    * Discontinue tracking the item.
    *
-   * @param item S to be untracked.
+   * @param item Item to be untracked.
    * @param related Action related object.
    */
-  void Untrack(S item, R related);
+  void Untrack(ServiceReferenceU item, ServiceEvent related);
 
   /**
    * Returns the number of tracked items.
@@ -136,7 +199,7 @@ public:
    *
    * @GuardedBy this
    */
-  T GetCustomizedObject(S item) const;
+  TrackedObjectPointer GetCustomizedObject(ServiceReferenceU item) const;
 
   /**
    * Return the list of tracked items.
@@ -144,7 +207,27 @@ public:
    * @return The tracked items.
    * @GuardedBy this
    */
-  void GetTracked(std::vector<S>& items) const;
+  void GetTracked(std::vector<ServiceReferenceU>& items) const;
+
+  /**
+   * Return the customized object of the tracked item with the highest
+   * ranking. If more than one item has the highest ranking, the one with
+   * the lowest id is used.
+   *
+   * @return The customized object or a null pointer if no item is being
+   *         tracked.
+   * @GuardedBy this
+   */
+  TrackedObjectPointer GetHighestRanked() const;
+
+  /**
+   * Copy the customized objects of the tracked items together with the
+   * ranking keys of the items, the highest ranked item first.
+   *
+   * @param items The vector to append the objects to.
+   * @GuardedBy this
+   */
+  void GetRanked(std::vector<RankedObject>& items) const;
 
   /**
    * Increment the modification count. If this method is overridden, the
@@ -166,27 +249,17 @@ public:
    */
   int GetTrackingCount() const;
 
-  /**
-   * Copy the tracked items and associated values into the specified map.
-   *
-   * @param map The map into which to copy the tracked items and associated
-   *        values. This map must not be a user provided map so that user code
-   *        is not executed while synchronized on this.
-   * @return The specified map.
-   * @GuardedBy this
-   */
-  void CopyEntries(TrackingMap& map) const;
-
   /**
    * Call the specific customizer adding method. This method must not be
    * called while synchronized on this object.
    *
-   * @param item S to be tracked.
+   * @param item Item to be tracked.
    * @param related Action related object.
    * @return Customized object for the tracked item or <code>null</code> if
    *         the item is not to be tracked.
    */
-  virtual T CustomizerAdding(S item, const R& related) = 0;
+  virtual TrackedObjectPointer CustomizerAdding(ServiceReferenceU item,
+                                                const ServiceEvent& related) = 0;
 
   /**
    * Call the specific customizer modified method. This method must not be
@@ -196,8 +269,8 @@ public:
    * @param related Action related object.
    * @param object Customized object for the tracked item.
    */
-  virtual void CustomizerModified(S item, const R& related,
-                                  T object) = 0;
+  virtual void CustomizerModified(ServiceReferenceU item, const ServiceEvent& related,
+                                  const TrackedObjectPointer& object) = 0;
 
   /**
    * Call the specific customizer removed method. This method must not be
@@ -207,8 +280,28 @@ public:
    * @param related Action related object.
    * @param object Customized object for the tracked item.
    */
-  virtual void CustomizerRemoved(S item, const R& related,
-                                 T object) = 0;
+  virtual void CustomizerRemoved(ServiceReferenceU item, const ServiceEvent& related,
+                                 const TrackedObjectPointer& object) = 0;
+
+  /**
+   * Called after an item has been added to the tracked items. This method
+   * is called while not synchronized on this object.
+   *
+   * @param item Tracked item.
+   * @param object Customized object for the tracked item.
+   */
+  virtual void ItemAdded(ServiceReferenceU item, const TrackedObjectPointer& object) = 0;
+
+  /**
+   * Compute the sort key of the specified item. The id of the key must
+   * identify the item for its whole lifetime, the ranking may change.
+   * This method may be called while synchronized on this object and must
+   * not call back into the tracker.
+   *
+   * @param item Item to compute the key for.
+   * @return The ranking key of the item.
+   */
+  virtual RankingKey GetRankingKey(ServiceReferenceU item) const = 0;
 
   /**
    * List of items in the process of being added. This is used to deal with
@@ -218,13 +311,13 @@ public:
    * nested call to untrack that the service was unregistered can be made to
    * the track method.
    *
-   * Since the std::vector implementation is not synchronized, all access to
-   * this list must be protected by the same synchronized object for
+   * Since the set implementation is not synchronized, all access to
+   * this set must be protected by the same synchronized object for
    * thread-safety.
    *
    * @GuardedBy this
    */
-  std::list<S> adding;
+  US_UNORDERED_SET_TYPE<ServiceReferenceU> adding;
 
   /**
    * true if the tracked object is closed.
@@ -251,28 +344,77 @@ public:
    *
    * @GuardedBy this
    */
-  std::list<S> initial;
+  std::list<ServiceReferenceU> initial;
+
+  /**
+   * Index of the items in the initial list, for constant time lookup
+   * and removal.
+   *
+   * @GuardedBy this
+   */
+  typedef US_UNORDERED_MAP_TYPE<ServiceReferenceU, std::list<ServiceReferenceU>::iterator> InitialIndex;
+  InitialIndex initialIndex;
 
   /**
    * Common logic to add an item to the tracker used by track and
    * trackInitial. The specified item must have been placed in the adding list
    * before calling this method.
    *
-   * @param item S to be tracked.
+   * @param item Item to be tracked.
    * @param related Action related object.
    */
-  void TrackAdding(S item, R related);
+  void TrackAdding(ServiceReferenceU item, ServiceEvent related);
 
 private:
 
-  typedef ModuleAbstractTracked<S,TTT,R> Self;
+  class TrackInitialTask;
+
+  /**
+   * Number of initial items handed to an executor which have not been
+   * processed yet.
+   *
+   * @GuardedBy this
+   */
+  std::size_t pendingInitial;
+
+  /**
+   * Items in the adding list whose adding is still owned by a task
+   * handed to an executor. Untrack removes the item, so a task whose item
+   * was untracked and then added again by Track does not add it a
+   * second time.
+   *
+   * @GuardedBy this
+   */
+  US_UNORDERED_SET_TYPE<ServiceReferenceU> initialTasks;
+
+  void TrackInitialTaskRun(ServiceReferenceU item);
+
+  struct TrackedItem
+  {
+    TrackedItem(ServiceReferenceU item, const TrackedObjectPointer& object, int ranking);
+
+    ServiceReferenceU item;
+    TrackedObjectPointer object;
+    int ranking;
+  };
 
   /**
-   * Map of tracked items to customized objects.
+   * Map of item ids to tracked items and customized objects. The items
+   * are keyed by their id and not by the items themselves, because the
+   * order of items may depend on mutable state (like a service ranking).
    *
    * @GuardedBy this
    */
-  TrackingMap tracked;
+  typedef std::map<long int,TrackedItem> TrackedItemMap;
+  TrackedItemMap tracked;
+
+  /**
+   * Tracked items ordered by their ranking key, the highest ranked
+   * item is at the front.
+   *
+   * @GuardedBy this
+   */
+  RankingMap ranked;
 
   /**
    * Modification count. This field is initialized to zero and incremented by
@@ -282,12 +424,20 @@ private:
    */
   AtomicInt trackingCount;
 
-  bool CustomizerAddingFinal(S item, const T& custom);
+  bool CustomizerAddingFinal(ServiceReferenceU item, const TrackedObjectPointer& custom,
+                             const RankingKey& key);
+
+  TrackedObjectPointer GetCustomizedObject_unlocked(const RankingKey& key) const;
+
+  void SetTracked_unlocked(ServiceReferenceU item, const TrackedObjectPointer& object,
+                           const RankingKey& key);
+
+  void SetRanking_unlocked(const RankingKey& key);
+
+  TrackedObjectPointer RemoveTracked_unlocked(const RankingKey& key);
 
 };
 
 US_END_NAMESPACE
 
-#include "usModuleAbstractTracked.tpp"
-
 #endif // USMODULEABSTRACTTRACKED_H
@@ -28,6 +28,7 @@
 #include "usCoreModuleContext_p.h"
 #include "usServiceRegistry_p.h"
 #include "usServiceReferenceBasePrivate.h"
+#include "usLDAPFilter_p.h"
 
 US_BEGIN_NAMESPACE
 
@@ -37,9 +38,87 @@ public:
 
   ModuleContextPrivate(ModulePrivate* module)
   : module(module)
-  {}
+  {
+    referenceCacheMutex.SetName("ModuleContext::referenceCacheMutex");
+  }
 
   ModulePrivate* module;
+
+  struct CachedReference
+  {
+    CachedReference() : epoch(-1) {}
+
+    int epoch;
+    ServiceReferenceU reference;
+  };
+
+  /**
+   * The results of GetServiceReference by class name, valid as long as the
+   * registry epoch equals their epoch. A published cache is never
+   * modified, updates publish a modified copy.
+   */
+  struct ReferenceCache : public SharedData
+  {
+    typedef US_UNORDERED_MAP_TYPE<std::string, CachedReference> Map;
+
+    Map references;
+  };
+
+  /**
+   * Returns a handle to the published reference cache or a null handle.
+   * Does not lock.
+   */
+  ExplicitlySharedDataPointer<const ReferenceCache> GetReferenceCache() const
+  {
+    ExplicitlySharedDataPointer<const ReferenceCache> cache;
+    referenceCache.Load(cache);
+    return cache;
+  }
+
+  /**
+   * Publishes a copy of the reference cache in which <code>cached</code>
+   * is remembered for <code>clazz</code>, unless a newer result is known
+   * already. A NULL <code>cached</code> forgets the result for
+   * <code>clazz</code>.
+   */
+  void UpdateReferenceCache(const std::string& clazz, const CachedReference* cached)
+  {
+    MutexLock lock(referenceCacheMutex, US_LOCK_SITE);
+    const ReferenceCache* old = referenceCache.Get();
+    const CachedReference* current = NULL;
+    if (old != NULL)
+    {
+      ReferenceCache::Map::const_iterator entry = old->references.find(clazz);
+      if (entry != old->references.end()) current = &entry->second;
+    }
+    if (cached == NULL ? current == NULL
+                       : current != NULL && current->epoch >= cached->epoch)
+    {
+      return;
+    }
+
+    ReferenceCache* updated = old != NULL ? new ReferenceCache(*old) : new ReferenceCache();
+    if (cached == NULL)
+    {
+      updated->references.erase(clazz);
+    }
+    else
+    {
+      updated->references[clazz] = *cached;
+    }
+    referenceCache.Store(updated);
+  }
+
+  /**
+   * The published reference cache, replaced with referenceCacheMutex
+   * held.
+   */
+  PublishedPointer<const ReferenceCache> referenceCache;
+
+  /**
+   * Serializes updates of the reference cache.
+   */
+  Mutex referenceCacheMutex;
 };
 
 
@@ -94,9 +173,63 @@ std::vector<ServiceReferenceU > ModuleContext::GetServiceReferences(const std::s
   return result;
 }
 
+std::vector<ServiceReferenceU > ModuleContext::GetServiceReferences(const std::string& clazz,
+                                                                    const LDAPFilter& filter)
+{
+  std::vector<ServiceReferenceU> result;
+  std::vector<ServiceReferenceBase> refs;
+  d->module->coreCtx->services.Get(clazz, filter ? filter.d->ldapExpr : LDAPExpr(), d->module, refs);
+  for (std::vector<ServiceReferenceBase>::const_iterator iter = refs.begin();
+       iter != refs.end(); ++iter)
+  {
+    result.push_back(ServiceReferenceU(*iter));
+  }
+  return result;
+}
+
 ServiceReferenceU ModuleContext::GetServiceReference(const std::string& clazz)
 {
-  return d->module->coreCtx->services.Get(d->module, clazz);
+  ServiceRegistry& registry = d->module->coreCtx->services;
+  const int epoch = registry.GetEpoch();
+  ModuleContextPrivate::CachedReference cached;
+  {
+    // a hit does not lock, it only hashes clazz and copies the reference
+    ExplicitlySharedDataPointer<const ModuleContextPrivate::ReferenceCache> cache =
+        d->GetReferenceCache();
+    if (cache)
+    {
+      ModuleContextPrivate::ReferenceCache::Map::const_iterator i = cache->references.find(clazz);
+      if (i != cache->references.end())
+      {
+        if (i->second.epoch == epoch)
+        {
+          return i->second.reference;
+        }
+        cached = i->second;
+      }
+    }
+  }
+
+  // other services changed, revalidate without looking up the services again
+  if (cached.epoch != -1 && registry.IsUnchanged(clazz, cached.epoch))
+  {
+    d->UpdateReferenceCache(clazz, &cached);
+    return cached.reference;
+  }
+
+  cached.reference = registry.Get(d->module, clazz, &cached.epoch);
+  d->UpdateReferenceCache(clazz, cached.epoch == -1 ? NULL : &cached);
+  return cached.reference;
+}
+
+int ModuleContext::GetServiceRegistryEpoch() const
+{
+  return d->module->coreCtx->services.GetEpoch();
+}
+
+int ModuleContext::GetServiceRegistryEpoch(const std::string& clazz) const
+{
+  return d->module->coreCtx->services.GetEpoch(clazz);
 }
 
 void* ModuleContext::GetService(const ServiceReferenceBase& reference)
@@ -114,7 +247,7 @@ InterfaceMap ModuleContext::GetService(const ServiceReferenceU& reference)
   {
     throw std::invalid_argument("Default constructed ServiceReference is not a valid input to GetService()");
   }
-  return reference.d->GetServiceInterfaceMap(d->module->q);
+  return reference.d->GetServiceInterfaceMap(d->module->q).ToInterfaceMap();
 }
 
 bool ModuleContext::UngetService(const ServiceReferenceBase& reference)
@@ -36,10 +36,12 @@ US_BEGIN_NAMESPACE
 typedef US_SERVICE_LISTENER_FUNCTOR ServiceListener;
 typedef US_MODULE_LISTENER_FUNCTOR ModuleListener;
 
+class LDAPFilter;
 class ModuleContextPrivate;
 class ServiceFactory;
 
 template<class S> class ServiceObjects;
+template<class S> class ServiceHandle;
 
 /**
  * \ingroup MicroServices
@@ -439,6 +441,31 @@ public:
    */
   std::vector<ServiceReferenceU> GetServiceReferences(const std::string& clazz, const std::string& filter = std::string());
 
+  /**
+   * Returns a list of <code>ServiceReference</code> objects. The returned
+   * list contains services that
+   * were registered under the specified class and match the specified
+   * <code>LDAPFilter</code>.
+   *
+   * <p>
+   * This method is identical to GetServiceReferences(const std::string&, const std::string&)
+   * except that the filter is already compiled. Use this overload with an
+   * <code>LDAPFilter</code> object which is kept around, or with one created from
+   * a LDAPProp expression, to avoid parsing a filter string on every call.
+   *
+   * @param clazz The class name with which the service was registered or
+   *        an empty string for all services.
+   * @param filter The filter, an invalid <code>LDAPFilter</code> matches
+   *        all services.
+   * @return A list of <code>ServiceReference</code> objects or
+   *         an empty list if no services are registered which satisfy the
+   *         search.
+   * @throws std::logic_error If this ModuleContext is no longer valid.
+   *
+   * @see GetServiceReferences(const std::string&, const std::string&)
+   */
+  std::vector<ServiceReferenceU> GetServiceReferences(const std::string& clazz, const LDAPFilter& filter);
+
   /**
    * Returns a list of <code>ServiceReference</code> objects. The returned
    * list contains services that
@@ -477,6 +504,42 @@ public:
     return result;
   }
 
+  /**
+   * Returns a list of <code>ServiceReference</code> objects. The returned
+   * list contains services that
+   * were registered under the interface id of the template argument <code>S</code>
+   * and match the specified <code>LDAPFilter</code>.
+   *
+   * <p>
+   * This method is identical to GetServiceReferences(const std::string&, const LDAPFilter&) except that
+   * the class name for the service object is automatically deduced from the template argument.
+   *
+   * @tparam S The type under which the requested service objects must have been registered.
+   * @param filter The filter, an invalid <code>LDAPFilter</code> matches
+   *        all services.
+   * @return A list of <code>ServiceReference</code> objects or
+   *         an empty list if no services are registered which satisfy the
+   *         search.
+   * @throws std::logic_error If this ModuleContext is no longer valid.
+   * @throws ServiceException If the service type \c S is invalid.
+   *
+   * @see GetServiceReferences(const std::string&, const LDAPFilter&)
+   */
+  template<class S>
+  std::vector<ServiceReference<S> > GetServiceReferences(const LDAPFilter& filter)
+  {
+    const char* clazz = us_service_interface_iid<S>();
+    if (clazz == 0) throw ServiceException("The service interface class has no US_DECLARE_SERVICE_INTERFACE macro");
+    typedef std::vector<ServiceReferenceU> BaseVectorT;
+    BaseVectorT serviceRefs = GetServiceReferences(std::string(clazz), filter);
+    std::vector<ServiceReference<S> > result;
+    for(BaseVectorT::const_iterator i = serviceRefs.begin(); i != serviceRefs.end(); ++i)
+    {
+      result.push_back(ServiceReference<S>(*i));
+    }
+    return result;
+  }
+
   /**
    * Returns a <code>ServiceReference</code> object for a service that
    * implements and was registered under the specified class.
@@ -499,6 +562,13 @@ public:
    * If there is a tie in ranking, the service with the lowest service ID (as
    * specified in its ServiceConstants::SERVICE_ID() property); that is, the
    * service that was registered first is returned.
+   * <p>
+   * The result is remembered per class name and returned again without a
+   * registry lookup or locking until a service registered under
+   * <code>clazz</code> changes, see GetServiceRegistryEpoch(const std::string&).
+   * Results filtered by service find hooks are not remembered. A remembered
+   * reference to a service which was unregistered is only released by the
+   * next call for the same class name or when this context becomes invalid.
    *
    * @param clazz The class name with which the service was registered.
    * @return A <code>ServiceReference</code> object, or an invalid <code>ServiceReference</code> if
@@ -534,6 +604,63 @@ public:
     return ServiceReference<S>(GetServiceReference(std::string(clazz)));
   }
 
+  /**
+   * Returns the current epoch of the framework service registry.
+   *
+   * <p>
+   * The epoch is incremented whenever a service is registered, has its
+   * properties modified or is unregistered. As long as the epoch does not
+   * change, the results of service queries do not change either, unless
+   * service find hooks are registered. Callers can use it to validate their
+   * own caches of query results.
+   *
+   * @return The current registry epoch.
+   *
+   * @see #GetServiceRegistryEpoch(const std::string&)
+   */
+  int GetServiceRegistryEpoch() const;
+
+  /**
+   * Returns the registry epoch of the last change of a service registered
+   * under the specified class.
+   *
+   * <p>
+   * The returned value only increases and is not affected by changes of
+   * services registered under other classes only.
+   *
+   * @param clazz The class name with which the services were registered.
+   * @return The epoch of the last change of a service registered under
+   *         <code>clazz</code>, or <code>0</code> if no such service was
+   *         ever registered.
+   *
+   * @see #GetServiceRegistryEpoch()
+   */
+  int GetServiceRegistryEpoch(const std::string& clazz) const;
+
+  /**
+   * Returns the registry epoch of the last change of a service registered
+   * under the specified template class argument.
+   *
+   * <p>
+   * This method is identical to GetServiceRegistryEpoch(const std::string&) except that
+   * the class name is automatically deduced from the template argument.
+   *
+   * @tparam S The type under which the services were registered.
+   * @return The epoch of the last change of a service registered under
+   *         the type <code>S</code>, or <code>0</code> if no such service was
+   *         ever registered.
+   * @throws ServiceException If <code>S</code> has no interface id.
+   *
+   * @see #GetServiceRegistryEpoch(const std::string&)
+   */
+  template<class S>
+  int GetServiceRegistryEpoch() const
+  {
+    const char* clazz = us_service_interface_iid<S>();
+    if (clazz == 0) throw ServiceException("The service interface class has no US_DECLARE_SERVICE_INTERFACE macro");
+    return GetServiceRegistryEpoch(std::string(clazz));
+  }
+
   /**
    * Returns the service object referenced by the specified
    * <code>ServiceReferenceBase</code> object.
@@ -641,6 +768,29 @@ public:
     return ServiceObjects<S>(this, reference);
   }
 
+  /**
+   * Returns a ServiceHandle object which pins the service referenced by the
+   * specified ServiceReference object. The handle holds one use count of the
+   * service for the context module, which is released when the last copy of
+   * the handle is destroyed. Accessing the service through the handle does
+   * not require any locking.
+   *
+   * @tparam S Type of Service.
+   * @param reference A reference to the service.
+   * @return A ServiceHandle object for the service associated with the specified
+   * reference. The handle is invalid if the service could not be obtained.
+   * @throws std::logic_error If this ModuleContext is no longer valid.
+   * @throws std::invalid_argument If the specified ServiceReference is invalid
+   * (default constructed or the service has been unregistered)
+   *
+   * @see ServiceHandle
+   */
+  template<class S>
+  ServiceHandle<S> GetServiceHandle(const ServiceReference<S>& reference)
+  {
+    return ServiceHandle<S>(this, reference);
+  }
+
   /**
    * Releases the service object referenced by the specified
    * <code>ServiceReference</code> object. If the context module's use count
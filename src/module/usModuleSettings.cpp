@@ -57,7 +57,7 @@ std::string ModuleSettings::CURRENT_MODULE_PATH()
   return var;
 }
 
-struct ModuleSettingsPrivate : public MultiThreaded<>
+struct ModuleSettingsPrivate : public MultiThreaded<SharedMutexLockingStrategy>
 {
   ModuleSettingsPrivate()
     : autoLoadPaths()
@@ -94,6 +94,8 @@ struct ModuleSettingsPrivate : public MultiThreaded<>
     {
       autoLoadingDisabled = true;
     }
+
+    SetLockName("ModuleSettings");
   }
 
   std::set<std::string> autoLoadPaths;
@@ -116,7 +118,7 @@ bool ModuleSettings::IsThreadingSupportEnabled()
 
 bool ModuleSettings::IsAutoLoadingEnabled()
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::SharedLock lock(moduleSettingsPrivate()); US_UNUSED(lock);
 #ifdef US_ENABLE_AUTOLOADING_SUPPORT
   return !moduleSettingsPrivate()->autoLoadingDisabled &&
       moduleSettingsPrivate()->autoLoadingEnabled;
@@ -127,13 +129,13 @@ bool ModuleSettings::IsAutoLoadingEnabled()
 
 void ModuleSettings::SetAutoLoadingEnabled(bool enable)
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::Lock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   moduleSettingsPrivate()->autoLoadingEnabled = enable;
 }
 
 ModuleSettings::PathList ModuleSettings::GetAutoLoadPaths()
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::SharedLock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   ModuleSettings::PathList paths(moduleSettingsPrivate()->autoLoadPaths.begin(),
                                  moduleSettingsPrivate()->autoLoadPaths.end());
   paths.insert(paths.end(), moduleSettingsPrivate()->extraPaths.begin(),
@@ -149,26 +151,26 @@ void ModuleSettings::SetAutoLoadPaths(const PathList& paths)
   normalizedPaths.resize(paths.size());
   std::transform(paths.begin(), paths.end(), normalizedPaths.begin(), RemoveTrailingPathSeparator);
 
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::Lock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   moduleSettingsPrivate()->autoLoadPaths.clear();
   moduleSettingsPrivate()->autoLoadPaths.insert(normalizedPaths.begin(), normalizedPaths.end());
 }
 
 void ModuleSettings::AddAutoLoadPath(const std::string& path)
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::Lock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   moduleSettingsPrivate()->autoLoadPaths.insert(RemoveTrailingPathSeparator(path));
 }
 
 void ModuleSettings::SetStoragePath(const std::string &path)
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::Lock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   moduleSettingsPrivate()->storagePath = RemoveTrailingPathSeparator(path);
 }
 
 std::string ModuleSettings::GetStoragePath()
 {
-  US_UNUSED(ModuleSettingsPrivate::Lock(moduleSettingsPrivate()));
+  ModuleSettingsPrivate::SharedLock lock(moduleSettingsPrivate()); US_UNUSED(lock);
   return moduleSettingsPrivate()->storagePath;
 }
 
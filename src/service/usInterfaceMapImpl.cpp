@@ -0,0 +1,205 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usInterfaceMapImpl_p.h"
+
+#include "usStaticInit_p.h"
+#include "usStringTable_p.h"
+
+#include <algorithm>
+
+US_BEGIN_NAMESPACE
+
+namespace {
+
+std::size_t HashEntry(int id, void* pointer)
+{
+  return (static_cast<std::size_t>(id) * 2654435761u) ^ (reinterpret_cast<std::size_t>(pointer) * 31);
+}
+
+struct InterfaceIdsPrivate : public StringTable
+{
+  InterfaceIdsPrivate()
+    : StringTable(false)
+  {}
+};
+
+// The names of the interface maps are only stored in the table, and maps
+// may be used until the very end of static destruction. So the table is
+// never deleted.
+template<typename T>
+struct InterfaceIdsDeleter
+{
+  void operator()(GlobalStatic<T>& globalStatic) const
+  {
+    globalStatic.destroyed = true;
+  }
+};
+
+}
+
+US_GLOBAL_STATIC_WITH_DELETER(InterfaceIdsPrivate, interfaceIdsPrivate, InterfaceIdsDeleter)
+
+InterfaceMapImpl::InterfaceMapImpl()
+{
+}
+
+InterfaceMapImpl::InterfaceMapImpl(const InterfaceMap& map)
+{
+  if (map.empty()) return;
+
+  InterfaceIdsPrivate* interfaceIds = interfaceIdsPrivate();
+  Data* data = new Data();
+  d = data;
+  data->entries.resize(map.size());
+  std::vector<Entry>::iterator entry = data->entries.begin();
+  for (InterfaceMap::const_iterator i = map.begin(); i != map.end(); ++i, ++entry)
+  {
+    entry->id = interfaceIds->Intern(i->first);
+    entry->pointer = i->second;
+    // the sum does not depend on the order of the entries
+    data->hash += HashEntry(entry->id, i->second);
+  }
+
+  // the first entry of an InterfaceMap has the smallest name
+  const int frontId = data->entries.front().id;
+  std::sort(data->entries.begin(), data->entries.end(), &InterfaceMapImpl::Less);
+  for (std::size_t i = 0; i < data->entries.size(); ++i)
+  {
+    if (data->entries[i].id == frontId) data->front = i;
+  }
+}
+
+int InterfaceMapImpl::InternInterfaceId(const std::string& interfaceId)
+{
+  return interfaceIdsPrivate()->Intern(interfaceId);
+}
+
+int InterfaceMapImpl::FindInterfaceId(const std::string& interfaceId)
+{
+  return interfaceIdsPrivate()->Find(interfaceId);
+}
+
+bool InterfaceMapImpl::Empty() const
+{
+  return !d;
+}
+
+std::size_t InterfaceMapImpl::Size() const
+{
+  return d ? d->entries.size() : 0;
+}
+
+bool InterfaceMapImpl::Contains(int interfaceId) const
+{
+  if (!d || interfaceId < 0) return false;
+  for (std::vector<Entry>::const_iterator i = d->entries.begin(); i != d->entries.end(); ++i)
+  {
+    if (i->id == interfaceId) return true;
+  }
+  return false;
+}
+
+bool InterfaceMapImpl::Contains(const std::string& interfaceId) const
+{
+  return d && Contains(FindInterfaceId(interfaceId));
+}
+
+void* InterfaceMapImpl::Find(int interfaceId) const
+{
+  if (!d || interfaceId < 0) return NULL;
+  // the maps are small, a linear search is faster than a binary search
+  for (std::vector<Entry>::const_iterator i = d->entries.begin(); i != d->entries.end(); ++i)
+  {
+    if (i->id == interfaceId) return i->pointer;
+  }
+  return NULL;
+}
+
+void* InterfaceMapImpl::Find(const std::string& interfaceId) const
+{
+  return d ? Find(FindInterfaceId(interfaceId)) : NULL;
+}
+
+void* InterfaceMapImpl::Front() const
+{
+  return d ? d->entries[d->front].pointer : NULL;
+}
+
+std::size_t InterfaceMapImpl::Hash() const
+{
+  return d ? d->hash : 0;
+}
+
+InterfaceMap InterfaceMapImpl::ToInterfaceMap() const
+{
+  InterfaceMap map;
+  if (!d) return map;
+  const InterfaceIdsPrivate* interfaceIds = interfaceIdsPrivate();
+  for (std::vector<Entry>::const_iterator i = d->entries.begin(); i != d->entries.end(); ++i)
+  {
+    map.insert(std::make_pair(interfaceIds->GetString(i->id), i->pointer));
+  }
+  return map;
+}
+
+bool InterfaceMapImpl::operator==(const InterfaceMapImpl& other) const
+{
+  return Compare(other) == 0;
+}
+
+bool InterfaceMapImpl::operator!=(const InterfaceMapImpl& other) const
+{
+  return Compare(other) != 0;
+}
+
+bool InterfaceMapImpl::operator<(const InterfaceMapImpl& other) const
+{
+  return Compare(other) < 0;
+}
+
+bool InterfaceMapImpl::Less(const Entry& e1, const Entry& e2)
+{
+  return e1.id < e2.id;
+}
+
+int InterfaceMapImpl::Compare(const InterfaceMapImpl& other) const
+{
+  if (d == other.d) return 0;
+  if (!d) return -1;
+  if (!other.d) return 1;
+  if (d->hash != other.d->hash) return d->hash < other.d->hash ? -1 : 1;
+  if (d->entries.size() != other.d->entries.size())
+  {
+    return d->entries.size() < other.d->entries.size() ? -1 : 1;
+  }
+
+  for (std::size_t i = 0; i < d->entries.size(); ++i)
+  {
+    const Entry& e1 = d->entries[i];
+    const Entry& e2 = other.d->entries[i];
+    if (e1.pointer != e2.pointer) return e1.pointer < e2.pointer ? -1 : 1;
+    if (e1.id != e2.id) return e1.id < e2.id ? -1 : 1;
+  }
+  return 0;
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,131 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USINTERFACEMAPIMPL_P_H
+#define USINTERFACEMAPIMPL_P_H
+
+#include "usServiceInterface.h"
+#include "usSharedData.h"
+
+#include <vector>
+
+US_BEGIN_NAMESPACE
+
+/**
+ * An immutable, compact representation of an InterfaceMap.
+ *
+ * The entries are kept in a small vector sorted by the interned id of
+ * the interface name, together with a precomputed hash. The names are
+ * only stored once, in a process wide StringTable. Copying an
+ * InterfaceMapImpl object only increments a reference count, and lookups
+ * and comparisons only compare ids.
+ */
+class InterfaceMapImpl
+{
+
+public:
+
+  /**
+   * Creates an empty map.
+   */
+  InterfaceMapImpl();
+
+  explicit InterfaceMapImpl(const InterfaceMap& map);
+
+  bool Empty() const;
+
+  std::size_t Size() const;
+
+  /**
+   * Returns the id of \c interfaceId, adding it to the interface id table
+   * if necessary. Callers which look up the same interface repeatedly
+   * intern it once and use the id based lookups.
+   */
+  static int InternInterfaceId(const std::string& interfaceId);
+
+  /**
+   * @return The id of \c interfaceId, or -1 if no map contains it.
+   */
+  static int FindInterfaceId(const std::string& interfaceId);
+
+  bool Contains(int interfaceId) const;
+  bool Contains(const std::string& interfaceId) const;
+
+  /**
+   * @return The pointer for \c interfaceId or NULL if there is no such entry.
+   */
+  void* Find(int interfaceId) const;
+  void* Find(const std::string& interfaceId) const;
+
+  /**
+   * @return The pointer of the entry with the lexicographically smallest
+   *         interface name, which is the first entry of the corresponding
+   *         InterfaceMap, or NULL if the map is empty.
+   */
+  void* Front() const;
+
+  std::size_t Hash() const;
+
+  InterfaceMap ToInterfaceMap() const;
+
+  bool operator==(const InterfaceMapImpl& other) const;
+  bool operator!=(const InterfaceMapImpl& other) const;
+
+  /**
+   * An arbitrary strict weak ordering, consistent with operator==.
+   */
+  bool operator<(const InterfaceMapImpl& other) const;
+
+private:
+
+  struct Entry
+  {
+    int id;
+    void* pointer;
+  };
+
+  struct Data : public SharedData
+  {
+    Data() : hash(0), front(0) {}
+
+    std::vector<Entry> entries;
+    std::size_t hash;
+    std::size_t front;
+  };
+
+  static bool Less(const Entry& e1, const Entry& e2);
+
+  int Compare(const InterfaceMapImpl& other) const;
+
+  // NULL for the empty map
+  ExplicitlySharedDataPointer<const Data> d;
+
+};
+
+US_END_NAMESPACE
+
+US_HASH_FUNCTION_NAMESPACE_BEGIN
+US_HASH_FUNCTION_BEGIN(US_PREPEND_NAMESPACE(InterfaceMapImpl))
+  return arg.Hash();
+US_HASH_FUNCTION_END
+US_HASH_FUNCTION_NAMESPACE_END
+
+#endif // USINTERFACEMAPIMPL_P_H
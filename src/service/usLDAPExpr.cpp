@@ -23,6 +23,7 @@
 
 #include "usAny.h"
 #include "usServicePropertiesImpl_p.h"
+#include "usPropertyKeys_p.h"
 
 #include <limits>
 #include <iterator>
@@ -58,6 +59,106 @@ bool stricomp(const std::string::value_type& v1, const std::string::value_type&
   return ::tolower(v1) == ::tolower(v2);
 }
 
+namespace {
+
+// Kinds of typed values which can be compared directly, without
+// converting them to and from their string representation.
+enum TypedKind
+{
+  TYPED_NONE,
+  TYPED_BOOL,
+  TYPED_SIGNED,
+  TYPED_UNSIGNED,
+  TYPED_FLOAT,
+  TYPED_DOUBLE
+};
+
+struct TypedValue
+{
+  TypedValue() : kind(TYPED_NONE), i(0), u(0), f(0.0) {}
+
+  TypedKind kind;
+  long long int i;
+  unsigned long long int u;
+  double f;
+};
+
+template<typename T>
+void SetSigned(TypedValue& v, const Any& any)
+{
+  v.kind = TYPED_SIGNED;
+  v.i = static_cast<long long int>(ref_any_cast<T>(any));
+}
+
+template<typename T>
+void SetUnsigned(TypedValue& v, const Any& any)
+{
+  v.kind = TYPED_UNSIGNED;
+  v.u = static_cast<unsigned long long int>(ref_any_cast<T>(any));
+}
+
+// Supports the same set of types as LDAPExpr::Compare
+TypedValue ToTypedValue(const Any& any)
+{
+  TypedValue v;
+  switch (any.TypeTag())
+  {
+  case ANY_TYPE_BOOL:
+    v.kind = TYPED_BOOL;
+    v.i = ref_any_cast<bool>(any) ? 1 : 0;
+    break;
+  case ANY_TYPE_SHORT: SetSigned<short>(v, any); break;
+  case ANY_TYPE_INT: SetSigned<int>(v, any); break;
+  case ANY_TYPE_LONG: SetSigned<long int>(v, any); break;
+  case ANY_TYPE_LONG_LONG: SetSigned<long long int>(v, any); break;
+  case ANY_TYPE_UNSIGNED_CHAR: SetUnsigned<unsigned char>(v, any); break;
+  case ANY_TYPE_UNSIGNED_SHORT: SetUnsigned<unsigned short>(v, any); break;
+  case ANY_TYPE_UNSIGNED_INT: SetUnsigned<unsigned int>(v, any); break;
+  case ANY_TYPE_UNSIGNED_LONG: SetUnsigned<unsigned long int>(v, any); break;
+  case ANY_TYPE_UNSIGNED_LONG_LONG: SetUnsigned<unsigned long long int>(v, any); break;
+  case ANY_TYPE_FLOAT:
+    v.kind = TYPED_FLOAT;
+    v.f = static_cast<double>(ref_any_cast<float>(any));
+    break;
+  case ANY_TYPE_DOUBLE:
+    v.kind = TYPED_DOUBLE;
+    v.f = ref_any_cast<double>(any);
+    break;
+  default:
+    break;
+  }
+  return v;
+}
+
+double ToDouble(const TypedValue& v)
+{
+  switch (v.kind)
+  {
+  case TYPED_SIGNED: return static_cast<double>(v.i);
+  case TYPED_UNSIGNED: return static_cast<double>(v.u);
+  default: return v.f;
+  }
+}
+
+// Three-way comparison of two integral values, taking care of
+// mixed signed and unsigned operands.
+int CompareIntegral(const TypedValue& v1, const TypedValue& v2)
+{
+  if (v1.kind == TYPED_SIGNED && v2.kind == TYPED_SIGNED)
+  {
+    return v1.i < v2.i ? -1 : (v1.i > v2.i ? 1 : 0);
+  }
+  if (v1.kind == TYPED_SIGNED && v1.i < 0) return -1;
+  if (v2.kind == TYPED_SIGNED && v2.i < 0) return 1;
+
+  const unsigned long long int u1 = v1.kind == TYPED_SIGNED ? static_cast<unsigned long long int>(v1.i) : v1.u;
+  const unsigned long long int u2 = v2.kind == TYPED_SIGNED ? static_cast<unsigned long long int>(v2.i) : v2.u;
+  return u1 < u2 ? -1 : (u1 > u2 ? 1 : 0);
+}
+
+}
+
+
 //! Contains the current parser position and parsing utility methods.
 class LDAPExpr::ParseState
 {
@@ -105,26 +206,34 @@ class LDAPExprData : public SharedData
 public:
 
   LDAPExprData( int op, const std::vector<LDAPExpr>& args )
-    : m_operator(op), m_args(args), m_attrName(), m_attrValue()
+    : m_operator(op), m_args(args), m_attrName(), m_attrId(-1), m_attrValue()
   {
   }
 
   LDAPExprData( int op, std::string attrName, const std::string& attrValue )
-    : m_operator(op), m_args(), m_attrName(attrName), m_attrValue(attrValue)
+    : m_operator(op), m_args(), m_attrName(attrName),
+    m_attrId(PropertyKeys::Find(attrName)), m_attrValue(attrValue)
   {
   }
 
   LDAPExprData( const LDAPExprData& other )
     : SharedData(other), m_operator(other.m_operator),
-    m_args(other.m_args), m_attrName(other.m_attrName),
-    m_attrValue(other.m_attrValue)
+    m_args(other.m_args), m_attrName(other.m_attrName), m_attrId(other.m_attrId),
+    m_attrValue(other.m_attrValue), m_attrTyped(other.m_attrTyped)
   {
   }
 
   int m_operator;
   std::vector<LDAPExpr> m_args;
   std::string m_attrName;
+  // Id of m_attrName if it was interned when the expression was created,
+  // otherwise -1. Filters do not intern keys, since they may be parsed
+  // from arbitrary input for a single call.
+  int m_attrId;
   std::string m_attrValue;
+
+  // Only set for expressions created by MakeSimple with a typed value
+  TypedValue m_attrTyped;
 };
 
 LDAPExpr::LDAPExpr() : d()
@@ -176,6 +285,63 @@ LDAPExpr::~LDAPExpr()
 {
 }
 
+LDAPExpr LDAPExpr::MakeSimple(int op, const std::string& attrName, const std::string& attrValue)
+{
+  if (op != EQ && op != LE && op != GE && op != APPROX)
+  {
+    throw std::invalid_argument(OPERATOR);
+  }
+  const std::string name = Trim(attrName);
+  if (name.empty())
+  {
+    throw std::invalid_argument(MALFORMED);
+  }
+
+  // Same value handling as ParseState::getAttributeValue()
+  std::string value;
+  value.reserve(attrValue.size());
+  for (std::size_t i = 0; i < attrValue.size(); ++i)
+  {
+    char c = attrValue[i];
+    if (c == '*')
+    {
+      c = WILDCARD;
+    }
+    else if (c == '\\' && i + 1 < attrValue.size())
+    {
+      c = attrValue[++i];
+    }
+    value.append(1, c);
+  }
+  return LDAPExpr(op, name, value);
+}
+
+LDAPExpr LDAPExpr::MakeSimple(int op, const std::string& attrName, const Any& attrValue)
+{
+  const TypedValue typed = ToTypedValue(attrValue);
+  if (typed.kind == TYPED_NONE)
+  {
+    return MakeSimple(op, attrName,
+                      attrValue.Type() == typeid(std::string) ? ref_any_cast<std::string>(attrValue)
+                                                              : attrValue.ToString());
+  }
+
+  std::string value;
+  if (typed.kind == TYPED_BOOL)
+  {
+    // use the spelling which Compare() accepts for boolean properties
+    value = typed.i ? "true" : "false";
+  }
+  else
+  {
+    value = attrValue.ToString();
+  }
+
+  LDAPExpr expr = MakeSimple(op, attrName, value);
+  expr.d->m_attrTyped = typed;
+  return expr;
+}
+
 std::string LDAPExpr::Trim(std::string str)
 {
   str.erase(0, str.find_first_not_of(' '));
@@ -310,10 +476,12 @@ bool LDAPExpr::Evaluate( const ServicePropertiesImpl& p, bool matchCase ) const
 {
   if ((d->m_operator & SIMPLE) != 0)
   {
-    // try case sensitive match first
-    int index = p.FindCaseSensitive(d->m_attrName);
-    if (index < 0 && !matchCase) index = p.Find(d->m_attrName);
-    return index < 0 ? false : Compare(p.Value(index), d->m_operator, d->m_attrValue);
+    // the key may have been registered after the filter was parsed
+    const int attrId = d->m_attrId < 0 ? PropertyKeys::Find(d->m_attrName) : d->m_attrId;
+    const int index = p.Find(attrId, d->m_attrName);
+    if (index < 0 || (matchCase && p.Keys()[index] != d->m_attrName)) return false;
+    return d->m_attrTyped.kind == TYPED_NONE ? Compare(p.Value(index), d->m_operator, d->m_attrValue)
+                                             : CompareTyped(p.Value(index));
   }
   else
   { // (d->m_operator & COMPLEX) != 0
@@ -350,12 +518,11 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
 
   try
   {
-    const std::type_info& objType = obj.Type();
-    if (objType == typeid(std::string))
+    switch (obj.TypeTag())
     {
+    case ANY_TYPE_STRING:
       return CompareString(ref_any_cast<std::string>(obj), op, s);
-    }
-    else if (objType == typeid(std::vector<std::string>))
+    case ANY_TYPE_STRING_VECTOR:
     {
       const std::vector<std::string>& list = ref_any_cast<std::vector<std::string> >(obj);
       for (std::size_t it = 0; it != list.size(); it++)
@@ -363,8 +530,9 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
          if (CompareString(list[it], op, s))
            return true;
       }
+      break;
     }
-    else if (objType == typeid(std::list<std::string>))
+    case ANY_TYPE_STRING_LIST:
     {
       const std::list<std::string>& list = ref_any_cast<std::list<std::string> >(obj);
       for (std::list<std::string>::const_iterator it = list.begin();
@@ -373,12 +541,11 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
          if (CompareString(*it, op, s))
            return true;
       }
+      break;
     }
-    else if (objType == typeid(char))
-    {
+    case ANY_TYPE_CHAR:
       return CompareString(std::string(1, ref_any_cast<char>(obj)), op, s);
-    }
-    else if (objType == typeid(bool))
+    case ANY_TYPE_BOOL:
     {
       if (op==LE || op==GE)
         return false;
@@ -386,43 +553,25 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
       std::string boolVal = any_cast<bool>(obj) ? "true" : "false";
       return std::equal(s.begin(), s.end(), boolVal.begin(), stricomp);
     }
-    else if (objType == typeid(short))
-    {
+    case ANY_TYPE_SHORT:
       return CompareIntegralType<short>(obj, op, s);
-    }
-    else if (objType == typeid(int))
-    {
+    case ANY_TYPE_INT:
       return CompareIntegralType<int>(obj, op, s);
-    }
-    else if (objType == typeid(long int))
-    {
+    case ANY_TYPE_LONG:
       return CompareIntegralType<long int>(obj, op, s);
-    }
-    else if (objType == typeid(long long int))
-    {
+    case ANY_TYPE_LONG_LONG:
       return CompareIntegralType<long long int>(obj, op, s);
-    }
-    else if (objType == typeid(unsigned char))
-    {
+    case ANY_TYPE_UNSIGNED_CHAR:
       return CompareIntegralType<unsigned char>(obj, op, s);
-    }
-    else if (objType == typeid(unsigned short))
-    {
+    case ANY_TYPE_UNSIGNED_SHORT:
       return CompareIntegralType<unsigned short>(obj, op, s);
-    }
-    else if (objType == typeid(unsigned int))
-    {
+    case ANY_TYPE_UNSIGNED_INT:
       return CompareIntegralType<unsigned int>(obj, op, s);
-    }
-    else if (objType == typeid(unsigned long int))
-    {
+    case ANY_TYPE_UNSIGNED_LONG:
       return CompareIntegralType<unsigned long int>(obj, op, s);
-    }
-    else if (objType == typeid(unsigned long long int))
-    {
+    case ANY_TYPE_UNSIGNED_LONG_LONG:
       return CompareIntegralType<unsigned long long int>(obj, op, s);
-    }
-    else if (objType == typeid(float))
+    case ANY_TYPE_FLOAT:
     {
       errno = 0;
       char* endptr = 0;
@@ -446,7 +595,7 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
         return (diff < std::numeric_limits<float>::epsilon()) && (diff > -std::numeric_limits<float>::epsilon());
       }
     }
-    else if (objType == typeid(double))
+    case ANY_TYPE_DOUBLE:
     {
       errno = 0;
       char* endptr = 0;
@@ -470,7 +619,7 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
         return (diff < std::numeric_limits<double>::epsilon()) && (diff > -std::numeric_limits<double>::epsilon());
       }
     }
-    else if (objType == typeid(std::vector<Any>))
+    case ANY_TYPE_ANY_VECTOR:
     {
       const std::vector<Any>& list = ref_any_cast<std::vector<Any> >(obj);
       for (std::size_t it = 0; it != list.size(); it++)
@@ -478,6 +627,10 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
          if (Compare(list[it], op, s))
            return true;
       }
+      break;
+    }
+    default:
+      break;
     }
   }
   catch (...)
@@ -488,6 +641,67 @@ bool LDAPExpr::Compare( const Any& obj, int op, const std::string& s ) const
   return false;
 }
 
+bool LDAPExpr::CompareTyped(const Any& obj) const
+{
+  if (obj.Empty())
+    return false;
+
+  if (obj.TypeTag() == ANY_TYPE_ANY_VECTOR)
+  {
+    const std::vector<Any>& list = ref_any_cast<std::vector<Any> >(obj);
+    for (std::size_t it = 0; it != list.size(); it++)
+    {
+      if (CompareTyped(list[it]))
+        return true;
+    }
+    return false;
+  }
+
+  const TypedValue& s = d->m_attrTyped;
+  const TypedValue v = ToTypedValue(obj);
+  if (v.kind == TYPED_NONE || (v.kind == TYPED_BOOL) != (s.kind == TYPED_BOOL))
+  {
+    // No direct comparison possible, use the string representation
+    return Compare(obj, d->m_operator, d->m_attrValue);
+  }
+
+  const int op = d->m_operator;
+  if (v.kind == TYPED_BOOL)
+  {
+    return (op == EQ || op == APPROX) && v.i == s.i;
+  }
+
+  if (v.kind == TYPED_FLOAT || v.kind == TYPED_DOUBLE ||
+      s.kind == TYPED_FLOAT || s.kind == TYPED_DOUBLE)
+  {
+    const double val = ToDouble(v);
+    const double sVal = ToDouble(s);
+    switch(op)
+    {
+    case LE:
+      return val <= sVal;
+    case GE:
+      return val >= sVal;
+    default: /*APPROX and EQ*/
+      const double epsilon = v.kind == TYPED_FLOAT ? std::numeric_limits<float>::epsilon()
+                                                   : std::numeric_limits<double>::epsilon();
+      const double diff = val - sVal;
+      return (diff < epsilon) && (diff > -epsilon);
+    }
+  }
+
+  const int cmp = CompareIntegral(v, s);
+  switch(op)
+  {
+  case LE:
+    return cmp <= 0;
+  case GE:
+    return cmp >= 0;
+  default: /*APPROX and EQ*/
+    return cmp == 0;
+  }
+}
+
 template<typename T>
 bool LDAPExpr::CompareIntegralType(const Any& obj, const int op, const std::string& s) const
 {
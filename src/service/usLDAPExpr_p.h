@@ -68,12 +68,40 @@ public:
 
   LDAPExpr(const std::string& filter);
 
+  /**
+   * Creates a complex expression (AND, OR or NOT) from already compiled
+   * sub-expressions, without going through the filter string parser.
+   */
+  LDAPExpr(int op, const std::vector<LDAPExpr>& args);
+
   LDAPExpr(const LDAPExpr& other);
 
   LDAPExpr& operator=(const LDAPExpr& other);
 
   ~LDAPExpr();
 
+  /**
+   * Creates a simple expression (EQ, LE, GE or APPROX) without going
+   * through the filter string parser. The value is interpreted the same
+   * way as in a filter string, i.e. '*' denotes a wildcard and '\' escapes
+   * the next character.
+   *
+   * @throws std::invalid_argument If \c op is not a simple operator or
+   *         \c attrName is empty.
+   */
+  static LDAPExpr MakeSimple(int op, const std::string& attrName, const std::string& attrValue);
+
+  /**
+   * Creates a simple expression with a typed value. Boolean and numeric
+   * values are kept as such and compared with boolean and numeric
+   * property values without any string conversion. Other types are
+   * converted to their string representation.
+   *
+   * @throws std::invalid_argument If \c op is not a simple operator or
+   *         \c attrName is empty.
+   */
+  static LDAPExpr MakeSimple(int op, const std::string& attrName, const Any& attrValue);
+
   /**
    * Get object class set matched by this LDAP expression. This will not work
    * with wildcards and NOT expressions. If a set can not be determined return <code>false</code>.
@@ -133,9 +161,6 @@ private:
 
   class ParseState;
 
-  //!
-  LDAPExpr(int op, const std::vector<LDAPExpr>& args);
-
   //!
   LDAPExpr(int op, const std::string& attrName, const std::string& attrValue);
 
@@ -152,6 +177,9 @@ private:
   //!
   bool Compare(const Any& obj, int op, const std::string& s) const;
 
+  //! Compare against the typed value of a programmatically created expression
+  bool CompareTyped(const Any& obj) const;
+
   //!
   template<typename T>
   bool CompareIntegralType(const Any& obj, const int op, const std::string& s) const;
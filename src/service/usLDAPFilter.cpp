@@ -20,7 +20,8 @@
 =============================================================================*/
 
 #include "usLDAPFilter.h"
-#include "usLDAPExpr_p.h"
+#include "usLDAPFilter_p.h"
+#include "usLDAPProp.h"
 #include "usServicePropertiesImpl_p.h"
 #include "usServiceReference.h"
 #include "usServiceReferenceBasePrivate.h"
@@ -29,24 +30,6 @@
 
 US_BEGIN_NAMESPACE
 
-class LDAPFilterData : public SharedData
-{
-public:
-
-  LDAPFilterData() : ldapExpr()
-  {}
-
-  LDAPFilterData(const std::string& filter)
-    : ldapExpr(filter)
-  {}
-
-  LDAPFilterData(const LDAPFilterData& other)
-    : SharedData(other), ldapExpr(other.ldapExpr)
-  {}
-
-  LDAPExpr ldapExpr;
-};
-
 LDAPFilter::LDAPFilter()
   : d(0)
 {
@@ -65,6 +48,16 @@ LDAPFilter::LDAPFilter(const std::string& filter)
   }
 }
 
+LDAPFilter::LDAPFilter(const LDAPPropExpr& expr)
+  : d(0)
+{
+  if (expr.IsNull())
+  {
+    throw std::invalid_argument("Null query");
+  }
+  d = new LDAPFilterData(expr.GetExpr());
+}
+
 LDAPFilter::LDAPFilter(const LDAPFilter& other)
   : d(other.d)
 {
@@ -34,6 +34,7 @@
 US_BEGIN_NAMESPACE
 
 class LDAPFilterData;
+class LDAPPropExpr;
 class ServiceReferenceBase;
 
 /**
@@ -91,6 +92,18 @@ public:
    */
   LDAPFilter(const std::string& filter);
 
+  /**
+   * Creates a <code>LDAPFilter</code> object from an expression built with
+   * the LDAPProp fluent API.
+   * <p>
+   * The expression is already compiled, so no filter string is formatted
+   * or parsed. Typed values in the expression, like the integer in
+   * <code>LDAPProp("port") >= 8080</code>, are kept.
+   * @param expr The LDAPProp expression.
+   * @throws std::invalid_argument If <code>expr</code> is a null expression.
+   */
+  explicit LDAPFilter(const LDAPPropExpr& expr);
+
   LDAPFilter(const LDAPFilter& other);
 
   ~LDAPFilter();
@@ -162,6 +175,8 @@ public:
 
 protected:
 
+  friend class ModuleContext;
+
   SharedDataPointer<LDAPFilterData> d;
 
 };
@@ -0,0 +1,54 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USLDAPFILTER_P_H
+#define USLDAPFILTER_P_H
+
+#include "usLDAPFilter.h"
+#include "usLDAPExpr_p.h"
+
+US_BEGIN_NAMESPACE
+
+class LDAPFilterData : public SharedData
+{
+public:
+
+  LDAPFilterData() : ldapExpr()
+  {}
+
+  LDAPFilterData(const std::string& filter)
+    : ldapExpr(filter)
+  {}
+
+  LDAPFilterData(const LDAPExpr& expr)
+    : ldapExpr(expr)
+  {}
+
+  LDAPFilterData(const LDAPFilterData& other)
+    : SharedData(other), ldapExpr(other.ldapExpr)
+  {}
+
+  LDAPExpr ldapExpr;
+};
+
+US_END_NAMESPACE
+
+#endif // USLDAPFILTER_P_H
@@ -0,0 +1,390 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usMultiServiceTracker.h"
+
+#include "usServiceEvent.h"
+#include "usServiceException.h"
+#include "usAtomicInt_p.h"
+#include "usThreads_p.h"
+#include "usLog_p.h"
+
+#include <map>
+#include <stdexcept>
+
+US_BEGIN_NAMESPACE
+
+namespace {
+
+// Sort key of a tracked service, the highest ranking
+// and then the lowest id orders first
+struct RankingKey
+{
+  RankingKey(const ServiceReferenceBase& reference)
+    : ranking(0), id(0)
+  {
+    Any rankingAny = reference.GetProperty(ServiceConstants::SERVICE_RANKING());
+    if (rankingAny.Type() == typeid(int)) ranking = any_cast<int>(rankingAny);
+    Any idAny = reference.GetProperty(ServiceConstants::SERVICE_ID());
+    if (idAny.Type() == typeid(long int)) id = any_cast<long int>(idAny);
+  }
+
+  RankingKey(int ranking, long int id)
+    : ranking(ranking), id(id)
+  {}
+
+  bool operator<(const RankingKey& other) const
+  {
+    if (ranking != other.ranking) return ranking > other.ranking;
+    return id < other.id;
+  }
+
+  int ranking;
+  long int id;
+};
+
+struct Dependency
+{
+  Dependency(const std::string& interfaceId, const LDAPFilter& filter)
+    : interfaceId(interfaceId), filter(filter)
+  {}
+
+  bool Matches(const ServiceReferenceBase& reference) const
+  {
+    return reference.IsConvertibleTo(interfaceId) && (!filter || filter.Match(reference));
+  }
+
+  // Returns true if the tracked services changed
+  bool Add(const ServiceReferenceU& reference, const RankingKey& key)
+  {
+    std::map<long int, int>::iterator iter = rankings.find(key.id);
+    if (iter != rankings.end())
+    {
+      if (iter->second == key.ranking) return false;
+      ranked.erase(RankingKey(iter->second, key.id));
+      iter->second = key.ranking;
+    }
+    else
+    {
+      rankings.insert(std::make_pair(key.id, key.ranking));
+    }
+    ranked.insert(std::make_pair(key, reference));
+    return true;
+  }
+
+  // Returns true if the tracked services changed
+  bool Remove(long int id)
+  {
+    std::map<long int, int>::iterator iter = rankings.find(id);
+    if (iter == rankings.end()) return false;
+    ranked.erase(RankingKey(iter->second, id));
+    rankings.erase(iter);
+    return true;
+  }
+
+  void Clear()
+  {
+    ranked.clear();
+    rankings.clear();
+  }
+
+  std::string interfaceId;
+  LDAPFilter filter;
+
+  // tracked services, the highest ranked first
+  std::map<RankingKey, ServiceReferenceU> ranked;
+  // service id -> ranking the service was inserted with
+  std::map<long int, int> rankings;
+};
+
+}
+
+class MultiServiceTrackerPrivate : public MultiThreaded<SharedMutexLockingStrategy>
+{
+
+public:
+
+  MultiServiceTrackerPrivate(ModuleContext* context, MultiServiceTrackerListener* listener)
+    : context(context), listener(listener), open(false), notifiedSatisfied(false)
+  {
+    this->SetLockName("MultiServiceTracker");
+  }
+
+  const Dependency& GetDependency(const std::string& interfaceId) const
+  {
+    std::map<std::string, Dependency>::const_iterator iter = dependencies.find(interfaceId);
+    if (iter == dependencies.end())
+    {
+      throw std::invalid_argument("No dependency on " + interfaceId);
+    }
+    return iter->second;
+  }
+
+  bool IsSatisfied_unlocked() const
+  {
+    if (!open) return false;
+    for (std::map<std::string, Dependency>::const_iterator iter = dependencies.begin();
+         iter != dependencies.end(); ++iter)
+    {
+      if (iter->second.ranked.empty()) return false;
+    }
+    return true;
+  }
+
+  void ServiceChanged(const ServiceEvent event)
+  {
+    ServiceReferenceU reference = event.GetServiceReference();
+    if (!reference) return;
+
+    const bool matching = event.GetType() == ServiceEvent::REGISTERED ||
+                          event.GetType() == ServiceEvent::MODIFIED;
+    const RankingKey key(reference);
+    {
+      Lock lock(this); US_UNUSED(lock);
+      if (!open) return;
+
+      // demultiplex the event to the dependencies
+      bool modified = false;
+      for (std::map<std::string, Dependency>::iterator iter = dependencies.begin();
+           iter != dependencies.end(); ++iter)
+      {
+        if (matching && iter->second.Matches(reference))
+        {
+          modified = iter->second.Add(reference, key) || modified;
+        }
+        else
+        {
+          modified = iter->second.Remove(key.id) || modified;
+        }
+      }
+      if (!modified) return;
+      trackingCount.Ref();
+    }
+    NotifyListener();
+  }
+
+  // Notifies the listener if the satisfied state changed since the last
+  // notification. Must not be called while holding the tracker lock.
+  void NotifyListener()
+  {
+    if (listener == NULL) return;
+
+    MutexLock notifyLock(notifyMutex);
+    bool satisfied = false;
+    {
+      SharedLock lock(this); US_UNUSED(lock);
+      satisfied = IsSatisfied_unlocked();
+    }
+    if (satisfied == notifiedSatisfied) return;
+    notifiedSatisfied = satisfied;
+    try
+    {
+      if (satisfied)
+      {
+        listener->DependenciesSatisfied();
+      }
+      else
+      {
+        listener->DependenciesUnsatisfied();
+      }
+    }
+    catch (const std::exception& e)
+    {
+      US_WARN << "MultiServiceTrackerListener threw an exception: " << e.what();
+    }
+  }
+
+  ModuleContext* const context;
+  MultiServiceTrackerListener* const listener;
+
+  /**
+   * The dependencies by interface id.
+   */
+  std::map<std::string, Dependency> dependencies;
+
+  /**
+   * The filter of the service listener, matching the services of
+   * all dependencies.
+   */
+  std::string listenerFilter;
+
+  bool open;
+
+  AtomicInt trackingCount;
+
+  /**
+   * Serializes listener notifications, notifiedSatisfied is
+   * guarded by it.
+   */
+  Mutex notifyMutex;
+  bool notifiedSatisfied;
+};
+
+MultiServiceTracker::MultiServiceTracker(ModuleContext* context, MultiServiceTrackerListener* listener)
+  : d(new MultiServiceTrackerPrivate(context, listener))
+{
+  if (context == NULL)
+  {
+    delete d;
+    throw std::invalid_argument("The module context must not be null");
+  }
+}
+
+MultiServiceTracker::~MultiServiceTracker()
+{
+  Close();
+  delete d;
+}
+
+void MultiServiceTracker::AddDependency(const std::string& interfaceId, const LDAPFilter& filter)
+{
+  if (interfaceId.empty())
+  {
+    throw std::invalid_argument("The interface id must not be empty");
+  }
+
+  MultiServiceTrackerPrivate::Lock lock(d); US_UNUSED(lock);
+  if (d->open)
+  {
+    throw std::logic_error("Dependencies must be added before the tracker is opened");
+  }
+  if (!d->dependencies.insert(std::make_pair(interfaceId, Dependency(interfaceId, filter))).second)
+  {
+    throw std::invalid_argument("Duplicate dependency on " + interfaceId);
+  }
+
+  std::string filterString = "(" + ServiceConstants::OBJECTCLASS() + "=" + interfaceId + ")";
+  if (filter)
+  {
+    filterString = "(&" + filterString + filter.ToString() + ")";
+  }
+  d->listenerFilter += filterString;
+}
+
+void MultiServiceTracker::Open()
+{
+  {
+    MultiServiceTrackerPrivate::Lock lock(d); US_UNUSED(lock);
+    if (d->open) return;
+    d->open = true;
+
+    if (!d->dependencies.empty())
+    {
+      try
+      {
+        // events arriving while the initial services are added wait
+        // for the lock, so they are applied after the initial state
+        d->context->AddServiceListener(d, &MultiServiceTrackerPrivate::ServiceChanged,
+                                       "(|" + d->listenerFilter + ")");
+        for (std::map<std::string, Dependency>::iterator iter = d->dependencies.begin();
+             iter != d->dependencies.end(); ++iter)
+        {
+          std::vector<ServiceReferenceU> references =
+              d->context->GetServiceReferences(iter->first, iter->second.filter);
+          for (std::vector<ServiceReferenceU>::const_iterator ref = references.begin();
+               ref != references.end(); ++ref)
+          {
+            iter->second.Add(*ref, RankingKey(*ref));
+          }
+        }
+      }
+      catch (...)
+      {
+        d->open = false;
+        for (std::map<std::string, Dependency>::iterator iter = d->dependencies.begin();
+             iter != d->dependencies.end(); ++iter)
+        {
+          iter->second.Clear();
+        }
+        throw;
+      }
+    }
+    d->trackingCount.Ref();
+  }
+  d->NotifyListener();
+}
+
+void MultiServiceTracker::Close()
+{
+  {
+    MultiServiceTrackerPrivate::Lock lock(d); US_UNUSED(lock);
+    if (!d->open) return;
+    d->open = false;
+    for (std::map<std::string, Dependency>::iterator iter = d->dependencies.begin();
+         iter != d->dependencies.end(); ++iter)
+    {
+      iter->second.Clear();
+    }
+    d->trackingCount.Ref();
+  }
+
+  if (!d->dependencies.empty())
+  {
+    try
+    {
+      d->context->RemoveServiceListener(d, &MultiServiceTrackerPrivate::ServiceChanged);
+    }
+    catch (const std::logic_error& /*e*/)
+    {
+      /* In case the context was stopped. */
+    }
+  }
+  d->NotifyListener();
+}
+
+bool MultiServiceTracker::IsSatisfied() const
+{
+  MultiServiceTrackerPrivate::SharedLock lock(d); US_UNUSED(lock);
+  return d->IsSatisfied_unlocked();
+}
+
+ServiceReferenceU MultiServiceTracker::GetServiceReference(const std::string& interfaceId) const
+{
+  MultiServiceTrackerPrivate::SharedLock lock(d); US_UNUSED(lock);
+  const Dependency& dependency = d->GetDependency(interfaceId);
+  if (dependency.ranked.empty()) return ServiceReferenceU();
+  return dependency.ranked.begin()->second;
+}
+
+std::vector<ServiceReferenceU> MultiServiceTracker::GetServiceReferences(const std::string& interfaceId) const
+{
+  std::vector<ServiceReferenceU> references;
+  MultiServiceTrackerPrivate::SharedLock lock(d); US_UNUSED(lock);
+  const Dependency& dependency = d->GetDependency(interfaceId);
+  for (std::map<RankingKey, ServiceReferenceU>::const_iterator iter = dependency.ranked.begin();
+       iter != dependency.ranked.end(); ++iter)
+  {
+    references.push_back(iter->second);
+  }
+  return references;
+}
+
+int MultiServiceTracker::GetTrackingCount() const
+{
+  return d->trackingCount;
+}
+
+ModuleContext* MultiServiceTracker::GetModuleContext() const
+{
+  return d->context;
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,222 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USMULTISERVICETRACKER_H
+#define USMULTISERVICETRACKER_H
+
+#include <usConfig.h>
+
+#include <usLDAPFilter.h>
+#include <usModuleContext.h>
+#include <usServiceHandle.h>
+#include <usServiceInterface.h>
+#include <usServiceReference.h>
+
+#include <string>
+#include <vector>
+
+US_BEGIN_NAMESPACE
+
+class MultiServiceTrackerPrivate;
+
+/**
+ * \ingroup MicroServices
+ *
+ * The <code>MultiServiceTrackerListener</code> interface is notified by a
+ * <code>MultiServiceTracker</code> when all of its dependencies become
+ * satisfied, and when one of them is no longer satisfied.
+ *
+ * <p>
+ * Notifications alternate, starting with DependenciesSatisfied(). They are
+ * delivered without holding any lock of the <code>MultiServiceTracker</code>,
+ * but are serialized, so implementations must not wait for another thread
+ * which modifies services tracked by the same <code>MultiServiceTracker</code>.
+ *
+ * \remarks Implementations must be thread-safe.
+ */
+struct MultiServiceTrackerListener
+{
+  virtual ~MultiServiceTrackerListener() {}
+
+  /**
+   * Every dependency of the <code>MultiServiceTracker</code> is satisfied
+   * by at least one tracked service.
+   */
+  virtual void DependenciesSatisfied() = 0;
+
+  /**
+   * A dependency of the <code>MultiServiceTracker</code> is no longer
+   * satisfied, or the <code>MultiServiceTracker</code> was closed.
+   */
+  virtual void DependenciesUnsatisfied() = 0;
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Tracks the services of several interfaces through a single service listener.
+ *
+ * <p>
+ * A component depending on many interfaces would otherwise use one
+ * <code>ServiceTracker</code> per interface, each adding its own service
+ * listener. A <code>MultiServiceTracker</code> adds one listener whose
+ * filter combines all dependencies and demultiplexes the service events
+ * internally, so every service event is matched against a single filter.
+ *
+ * <p>
+ * Dependencies are added before the tracker is opened. For every dependency,
+ * the tracker keeps the matching service references ordered by service
+ * ranking and service id. It does not get the service objects, use
+ * GetServiceHandle() to pin the best service of a dependency.
+ *
+ * \remarks This class is thread safe.
+ */
+class US_EXPORT MultiServiceTracker
+{
+
+public:
+
+  /**
+   * Create a <code>MultiServiceTracker</code> without dependencies.
+   *
+   * @param context The <code>ModuleContext</code> against which the tracking
+   *        is done.
+   * @param listener The listener to notify when the dependencies become
+   *        satisfied or unsatisfied, or null. It is not owned by this
+   *        <code>MultiServiceTracker</code>.
+   */
+  MultiServiceTracker(ModuleContext* context, MultiServiceTrackerListener* listener = 0);
+
+  /**
+   * Closes this <code>MultiServiceTracker</code>.
+   */
+  ~MultiServiceTracker();
+
+  /**
+   * Add a dependency on services registered under <code>interfaceId</code>
+   * which also match <code>filter</code>.
+   *
+   * @param interfaceId The interface id of the dependency.
+   * @param filter An additional filter for the services, or an empty filter.
+   * @throws std::invalid_argument If <code>interfaceId</code> is empty or a
+   *         dependency on <code>interfaceId</code> was already added.
+   * @throws std::logic_error If this tracker is open.
+   */
+  void AddDependency(const std::string& interfaceId, const LDAPFilter& filter = LDAPFilter());
+
+  /**
+   * Add a dependency on services registered under the interface \c S.
+   *
+   * @tparam S The interface of the dependency.
+   * @param filter An additional filter for the services, or an empty filter.
+   * @see AddDependency(const std::string&, const LDAPFilter&)
+   */
+  template<class S>
+  void AddDependency(const LDAPFilter& filter = LDAPFilter())
+  {
+    AddDependency(us_service_interface_iid<S>(), filter);
+  }
+
+  /**
+   * Open this <code>MultiServiceTracker</code> and begin tracking services.
+   *
+   * @throws std::logic_error If the <code>ModuleContext</code> with which
+   *         this tracker was created is no longer valid.
+   */
+  void Open();
+
+  /**
+   * Close this <code>MultiServiceTracker</code> and stop tracking services.
+   * If the dependencies were satisfied, the listener is notified that they
+   * no longer are.
+   */
+  void Close();
+
+  /**
+   * @return \c true if every dependency is satisfied by at least one
+   *         tracked service.
+   */
+  bool IsSatisfied() const;
+
+  /**
+   * Returns the highest ranked service reference tracked for a dependency.
+   * If more than one service has the highest ranking, the one with the
+   * lowest service id is returned.
+   *
+   * @param interfaceId The interface id of the dependency.
+   * @return The service reference, or an invalid reference if no service is
+   *         tracked for the dependency.
+   * @throws std::invalid_argument If there is no dependency on
+   *         <code>interfaceId</code>.
+   */
+  ServiceReferenceU GetServiceReference(const std::string& interfaceId) const;
+
+  template<class S>
+  ServiceReference<S> GetServiceReference() const
+  {
+    return ServiceReference<S>(GetServiceReference(us_service_interface_iid<S>()));
+  }
+
+  /**
+   * Returns the service references tracked for a dependency, the highest
+   * ranked first.
+   *
+   * @param interfaceId The interface id of the dependency.
+   * @throws std::invalid_argument If there is no dependency on
+   *         <code>interfaceId</code>.
+   */
+  std::vector<ServiceReferenceU> GetServiceReferences(const std::string& interfaceId) const;
+
+  /**
+   * Pins the highest ranked service tracked for the dependency on \c S.
+   *
+   * @tparam S The interface of the dependency.
+   * @return A handle for the service, or an invalid handle if no service
+   *         is tracked for the dependency.
+   */
+  template<class S>
+  ServiceHandle<S> GetServiceHandle() const
+  {
+    ServiceReference<S> reference = GetServiceReference<S>();
+    if (!reference) return ServiceHandle<S>();
+    return GetModuleContext()->GetServiceHandle(reference);
+  }
+
+  /**
+   * @return The number of modifications of the tracked services.
+   */
+  int GetTrackingCount() const;
+
+private:
+
+  ModuleContext* GetModuleContext() const;
+
+  MultiServiceTrackerPrivate* d;
+
+  // purposely not implemented
+  MultiServiceTracker(const MultiServiceTracker&);
+  MultiServiceTracker& operator=(const MultiServiceTracker&);
+
+};
+
+US_END_NAMESPACE
+
+#endif // USMULTISERVICETRACKER_H
@@ -0,0 +1,87 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usPropertyKeys_p.h"
+
+#include "usServiceProperties.h"
+#include "usStaticInit_p.h"
+#include "usStringTable_p.h"
+
+#include <cctype>
+
+US_BEGIN_NAMESPACE
+
+namespace {
+
+bool EqualsIgnoreCase(const std::string& s1, const std::string& s2)
+{
+  if (s1.size() != s2.size()) return false;
+  for (std::size_t i = 0; i < s1.size(); ++i)
+  {
+    if (std::tolower(static_cast<unsigned char>(s1[i])) != std::tolower(static_cast<unsigned char>(s2[i])))
+      return false;
+  }
+  return true;
+}
+
+int FindWellKnownKey(const std::string& key)
+{
+  if (EqualsIgnoreCase(key, ServiceConstants::OBJECTCLASS())) return PropertyKeys::KEY_OBJECTCLASS;
+  if (EqualsIgnoreCase(key, ServiceConstants::SERVICE_ID())) return PropertyKeys::KEY_SERVICE_ID;
+  if (EqualsIgnoreCase(key, ServiceConstants::SERVICE_RANKING())) return PropertyKeys::KEY_SERVICE_RANKING;
+  if (EqualsIgnoreCase(key, ServiceConstants::SERVICE_SCOPE())) return PropertyKeys::KEY_SERVICE_SCOPE;
+  return -1;
+}
+
+}
+
+struct PropertyKeysPrivate : public StringTable
+{
+  PropertyKeysPrivate()
+    : StringTable(true)
+  {}
+};
+
+US_GLOBAL_STATIC(PropertyKeysPrivate, propertyKeysPrivate)
+
+int PropertyKeys::Intern(const std::string& key)
+{
+  // The well-known keys do not need the table
+  const int wellKnownKey = FindWellKnownKey(key);
+  if (wellKnownKey > -1) return wellKnownKey;
+
+  PropertyKeysPrivate* keys = propertyKeysPrivate();
+  if (keys == NULL) return -1;
+  return WELL_KNOWN_KEY_COUNT + keys->Intern(key);
+}
+
+int PropertyKeys::Find(const std::string& key)
+{
+  const int wellKnownKey = FindWellKnownKey(key);
+  if (wellKnownKey > -1) return wellKnownKey;
+
+  PropertyKeysPrivate* keys = propertyKeysPrivate();
+  if (keys == NULL) return -1;
+  const int id = keys->Find(key);
+  return id > -1 ? WELL_KNOWN_KEY_COUNT + id : -1;
+}
+
+US_END_NAMESPACE
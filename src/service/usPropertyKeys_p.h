@@ -0,0 +1,83 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USPROPERTYKEYS_P_H
+#define USPROPERTYKEYS_P_H
+
+#include <usConfig.h>
+
+#include <string>
+
+US_BEGIN_NAMESPACE
+
+/**
+ * This class is not part of the public API.
+ *
+ * A process wide table of interned service property keys. Keys
+ * differing only in case share the same id, matching the case
+ * insensitive key semantics of service properties. The well-known
+ * keys from ServiceConstants have fixed ids.
+ *
+ * Keys are only interned for registered services and compiled filters.
+ * Transient property sets only look up the ids of known keys, which
+ * neither locks nor allocates.
+ */
+class PropertyKeys
+{
+
+public:
+
+  enum WellKnownKey
+  {
+    KEY_OBJECTCLASS = 0,
+    KEY_SERVICE_ID,
+    KEY_SERVICE_RANKING,
+    KEY_SERVICE_SCOPE,
+    WELL_KNOWN_KEY_COUNT
+  };
+
+  /**
+   * Returns the id of \c key, adding the key to the table if necessary.
+   *
+   * @return The key id or -1 if no id is available, which can only
+   *         happen for keys other than the well-known keys during static
+   *         deinitialization.
+   */
+  static int Intern(const std::string& key);
+
+  /**
+   * Returns the id of \c key without adding it to the table.
+   *
+   * @return The key id or -1 if \c key was not interned.
+   */
+  static int Find(const std::string& key);
+
+private:
+
+  // purposely not implemented
+  PropertyKeys();
+  PropertyKeys(const PropertyKeys&);
+  PropertyKeys& operator=(const PropertyKeys&);
+};
+
+US_END_NAMESPACE
+
+#endif // USPROPERTYKEYS_P_H
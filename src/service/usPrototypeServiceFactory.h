@@ -95,6 +95,28 @@ struct PrototypeServiceFactory : public ServiceFactory
   virtual void UngetService(Module* module, const ServiceRegistrationBase& registration,
                             const InterfaceMap& service) = 0;
 
+  /**
+   * Resets a released service object for reuse.
+   *
+   * The framework invokes this method instead of UngetService() when a service object
+   * is released and the service has an instance pool with free capacity, see
+   * ServiceConstants::SERVICE_POOL_SIZE(). The factory should restore the initial
+   * state of the service object. If this method returns \c false or throws an
+   * exception, the service object is not pooled and UngetService() is called instead.
+   *
+   * The default implementation returns \c true, reusing service objects as they are.
+   *
+   * @param module The module releasing the service.
+   * @param registration The ServiceRegistrationBase object for the service being released.
+   * @param service The service object returned by a previous call to the GetService method.
+   * @return \c true if the service object can be handed out again, \c false otherwise.
+   */
+  virtual bool ResetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/,
+                            const InterfaceMap& /*service*/)
+  {
+    return true;
+  }
+
 };
 
 US_END_NAMESPACE
@@ -0,0 +1,72 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+
+#ifndef USSERVICEAVAILABLECALLBACK_H
+#define USSERVICEAVAILABLECALLBACK_H
+
+#include "usServiceReference.h"
+
+US_BEGIN_NAMESPACE
+
+/**
+ * \ingroup MicroServices
+ *
+ * The <code>ServiceAvailableCallback</code> interface is notified by a
+ * <code>ServiceTracker</code> when a service becomes available.
+ *
+ * <p>
+ * A callback is registered with <code>ServiceTracker::WhenAvailable</code>
+ * and is called exactly once: either when the tracker tracks a service,
+ * or with an invalid reference when the tracker is closed. The callback
+ * is called from the thread which caused the service to become tracked,
+ * usually the thread delivering a <code>ServiceEvent</code>, and the
+ * <code>ServiceTracker</code> does not hold any locks while calling it.
+ *
+ * \tparam S The type of the service being tracked
+ * \tparam T The type of the tracked object.
+ * \remarks Implementations must be thread-safe.
+ * @see ServiceTracker::WhenAvailable
+ */
+template<class S, class T = S*>
+struct ServiceAvailableCallback {
+
+  typedef S ServiceType;
+  typedef T TrackedType;
+  typedef ServiceReference<ServiceType> ServiceReferenceType;
+
+  virtual ~ServiceAvailableCallback() {}
+
+  /**
+   * A service is available from the <code>ServiceTracker</code>.
+   *
+   * @param reference The reference to the available service, or an invalid
+   *        reference if the <code>ServiceTracker</code> was closed.
+   * @param service The tracked object for the specified referenced service,
+   *        or a default constructed object if the <code>ServiceTracker</code>
+   *        was closed.
+   */
+  virtual void ServiceAvailable(const ServiceReferenceType& reference, TrackedType service) = 0;
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICEAVAILABLECALLBACK_H
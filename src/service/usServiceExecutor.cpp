@@ -0,0 +1,104 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceExecutor_p.h"
+#include "usUtils_p.h"
+
+US_BEGIN_NAMESPACE
+
+ServiceFuturePrivate::ServiceFuturePrivate(std::size_t pending)
+  : ref(1), pending(pending)
+{
+}
+
+void ServiceFuturePrivate::Done()
+{
+  Lock lock(this);
+  US_UNUSED(lock);
+  if (--pending == 0)
+  {
+    this->NotifyAll();
+  }
+}
+
+ServiceFuture::ServiceFuture()
+  : d(NULL)
+{
+}
+
+ServiceFuture::ServiceFuture(ServiceFuturePrivate* d)
+  : d(d)
+{
+}
+
+ServiceFuture::ServiceFuture(const ServiceFuture& other)
+  : d(other.d)
+{
+  if (d) d->ref.Ref();
+}
+
+ServiceFuture::~ServiceFuture()
+{
+  if (d && !d->ref.Deref())
+    delete d;
+}
+
+ServiceFuture& ServiceFuture::operator=(const ServiceFuture& other)
+{
+  ServiceFuturePrivate* curr_d = d;
+  d = other.d;
+  if (d) d->ref.Ref();
+
+  if (curr_d && !curr_d->ref.Deref())
+    delete curr_d;
+
+  return *this;
+}
+
+bool ServiceFuture::IsDone() const
+{
+  if (!d) return true;
+
+  ServiceFuturePrivate::Lock lock(d);
+  US_UNUSED(lock);
+  return d->pending == 0;
+}
+
+bool ServiceFuture::Wait(unsigned long timeout) const
+{
+  if (!d) return true;
+
+  ServiceFuturePrivate::Lock lock(d);
+  US_UNUSED(lock);
+#ifdef US_ENABLE_THREADING_SUPPORT
+  const Deadline deadline(timeout);
+  unsigned long remaining = 0;
+  while (d->pending > 0 && deadline.Remaining(remaining))
+  {
+    if (!d->Wait(remaining)) break;
+  }
+#else
+  US_UNUSED(timeout);
+#endif
+  return d->pending == 0;
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,132 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USSERVICEEXECUTOR_H
+#define USSERVICEEXECUTOR_H
+
+#include <usConfig.h>
+
+US_BEGIN_NAMESPACE
+
+class ServiceFuturePrivate;
+
+/**
+ * \ingroup MicroServices
+ *
+ * A unit of work which the framework hands to a ServiceExecutor.
+ *
+ * @see ServiceExecutor
+ */
+class ServiceTask
+{
+
+public:
+
+  virtual ~ServiceTask() {}
+
+  /**
+   * Performs the work. Exceptions thrown by the work are caught and
+   * logged by the task itself.
+   */
+  virtual void Run() = 0;
+
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Runs tasks on behalf of the framework, for example on a background
+ * thread or in a thread pool.
+ *
+ * An executor can be passed to ServiceRegistrationBase::Unregister(ServiceExecutor*)
+ * to release the service objects of an unregistered service asynchronously.
+ * The tasks handed to an executor are independent of each other and may
+ * run concurrently.
+ *
+ * @remarks Implementations must be thread safe.
+ */
+class ServiceExecutor
+{
+
+public:
+
+  virtual ~ServiceExecutor() {}
+
+  /**
+   * Schedules a task. The executor takes ownership of \c task. It must
+   * call ServiceTask::Run() exactly once and delete the task afterwards.
+   * This method must not throw.
+   *
+   * @param task The task to run.
+   */
+  virtual void Execute(ServiceTask* task) = 0;
+
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * The completion state of work the framework handed to a ServiceExecutor.
+ *
+ * Copies of a ServiceFuture object refer to the same state. A default
+ * constructed ServiceFuture is done.
+ *
+ * @remarks This class is thread safe.
+ */
+class US_EXPORT ServiceFuture
+{
+
+public:
+
+  ServiceFuture();
+  ServiceFuture(const ServiceFuture& other);
+  ~ServiceFuture();
+
+  ServiceFuture& operator=(const ServiceFuture& other);
+
+  /**
+   * @return \c true if all work has completed, \c false otherwise.
+   */
+  bool IsDone() const;
+
+  /**
+   * Blocks until all work has completed or the timeout expired.
+   *
+   * @param timeout The maximum time to wait in milliseconds, or 0 to
+   *        wait without a time limit.
+   * @return \c true if all work has completed, \c false otherwise.
+   */
+  bool Wait(unsigned long timeout = 0) const;
+
+private:
+
+  friend class ServiceRegistrationBase;
+  friend class ServiceTrackerBase;
+
+  ServiceFuture(ServiceFuturePrivate* d);
+
+  ServiceFuturePrivate* d;
+
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICEEXECUTOR_H
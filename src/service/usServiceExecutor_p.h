@@ -0,0 +1,60 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USSERVICEEXECUTOR_P_H
+#define USSERVICEEXECUTOR_P_H
+
+#include "usServiceExecutor.h"
+#include "usAtomicInt_p.h"
+#include "usThreads_p.h"
+
+US_BEGIN_NAMESPACE
+
+class ServiceFuturePrivate : public MultiThreaded<MutexLockingStrategy, WaitCondition>
+{
+
+public:
+
+  /**
+   * Creates the state for \c pending units of work.
+   */
+  ServiceFuturePrivate(std::size_t pending);
+
+  /**
+   * Marks one unit of work as completed.
+   */
+  void Done();
+
+  /**
+   * Reference count for implicitly shared private implementation.
+   */
+  AtomicInt ref;
+
+  /**
+   * The number of units of work which have not completed yet.
+   */
+  std::size_t pending;
+
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICEEXECUTOR_P_H
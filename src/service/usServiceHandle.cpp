@@ -0,0 +1,126 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceHandle.h"
+
+#include "usServiceReferenceBasePrivate.h"
+#include "usServiceRegistrationBasePrivate.h"
+
+#include <stdexcept>
+
+US_BEGIN_NAMESPACE
+
+class ServiceHandleBasePrivate
+{
+public:
+
+  AtomicInt ref;
+
+  ServiceReferenceBase m_reference;
+  Module* m_module;
+  void* m_service;
+
+  // The registration generation at the time the service was pinned
+  int m_generation;
+
+  ServiceHandleBasePrivate(ModuleContext* context, const ServiceReferenceBase& reference)
+    : m_reference(reference)
+    , m_module(context->GetModule())
+    , m_service(NULL)
+    , m_generation(reference.d->registration->generation)
+  {
+    // read the generation first, so an unregistration while
+    // getting the service invalidates this handle
+    m_service = context->GetService(reference);
+  }
+
+  ~ServiceHandleBasePrivate()
+  {
+    if (m_service)
+    {
+      m_reference.d->UngetService(m_module, true);
+    }
+  }
+
+  bool IsValid() const
+  {
+    return m_service && m_reference.d->registration->generation == m_generation;
+  }
+};
+
+ServiceHandleBase::ServiceHandleBase()
+  : d(NULL)
+{
+}
+
+ServiceHandleBase::ServiceHandleBase(ModuleContext* context, const ServiceReferenceBase& reference)
+  : d(NULL)
+{
+  if (!reference)
+  {
+    throw std::invalid_argument("The service reference is invalid");
+  }
+  d = new ServiceHandleBasePrivate(context, reference);
+  d->ref.Ref();
+}
+
+ServiceHandleBase::ServiceHandleBase(const ServiceHandleBase& other)
+  : d(other.d)
+{
+  if (d) d->ref.Ref();
+}
+
+ServiceHandleBase::~ServiceHandleBase()
+{
+  if (d && !d->ref.Deref())
+  {
+    delete d;
+  }
+}
+
+ServiceHandleBase& ServiceHandleBase::operator=(const ServiceHandleBase& other)
+{
+  ServiceHandleBasePrivate* curr_d = d;
+  d = other.d;
+  if (d) d->ref.Ref();
+
+  if (curr_d && !curr_d->ref.Deref())
+    delete curr_d;
+
+  return *this;
+}
+
+ServiceHandleBase::operator bool_type() const
+{
+  return d && d->IsValid() ? &ServiceHandleBase::d : NULL;
+}
+
+void* ServiceHandleBase::Get() const
+{
+  return d && d->IsValid() ? d->m_service : NULL;
+}
+
+ServiceReferenceBase ServiceHandleBase::GetReference() const
+{
+  return d ? d->m_reference : ServiceReferenceBase();
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,143 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USSERVICEHANDLE_H
+#define USSERVICEHANDLE_H
+
+#include <usConfig.h>
+
+#include <usModuleContext.h>
+#include <usServiceReference.h>
+
+US_BEGIN_NAMESPACE
+
+class ServiceHandleBasePrivate;
+
+class US_EXPORT ServiceHandleBase
+{
+
+private:
+
+  ServiceHandleBasePrivate* d;
+
+protected:
+
+  typedef ServiceHandleBasePrivate* ServiceHandleBase::*bool_type;
+
+  ServiceHandleBase();
+
+  ServiceHandleBase(ModuleContext* context, const ServiceReferenceBase& reference);
+
+  ServiceHandleBase(const ServiceHandleBase& other);
+
+  ~ServiceHandleBase();
+
+  ServiceHandleBase& operator=(const ServiceHandleBase& other);
+
+  operator bool_type() const;
+
+  void* Get() const;
+
+  ServiceReferenceBase GetReference() const;
+
+};
+
+/**
+ * @ingroup MicroServices
+ *
+ * A pinned service object.
+ *
+ * A ServiceHandle holds one use count of the service it was created for
+ * and caches the service object, so repeated access to the service does
+ * not involve any locking or map lookups. The use count is released when
+ * the last copy of the handle is destroyed.
+ *
+ * When the service is unregistered, the handle is invalidated through a
+ * generation counter of the service registration. Get() then returns
+ * \c NULL. Checking the generation is a single atomic load, so a handle
+ * can be dereferenced on every access instead of caching the raw service
+ * pointer, which is unsafe across unregistration.
+ *
+ * The cached pointer is never modified after the handle is created. Copies
+ * of a handle share the use count, so each thread can keep its own copy
+ * without any synchronization.
+ *
+ * @tparam S Type of Service.
+ *
+ * @see ModuleContext::GetServiceHandle()
+ * @see ServiceTracker::GetServiceHandle()
+ */
+template<class S>
+class ServiceHandle : private ServiceHandleBase
+{
+
+public:
+
+  /**
+   * Creates an invalid ServiceHandle object.
+   */
+  ServiceHandle() {}
+
+  /**
+   * Returns the pinned service object.
+   *
+   * @return The service object or \c NULL if this handle is invalid or
+   *         the service has been unregistered.
+   */
+  S* Get() const
+  {
+    return reinterpret_cast<S*>(this->ServiceHandleBase::Get());
+  }
+
+  S* operator->() const
+  {
+    return Get();
+  }
+
+  /**
+   * Converts this handle to a boolean value, which is \c true if the
+   * handle pins a service which is still registered.
+   */
+  using ServiceHandleBase::operator bool_type;
+
+  /**
+   * Returns the ServiceReference for the pinned service.
+   *
+   * @return The ServiceReference for this ServiceHandle object.
+   */
+  ServiceReference<S> GetServiceReference() const
+  {
+    return this->ServiceHandleBase::GetReference();
+  }
+
+private:
+
+  friend class ModuleContext;
+
+  ServiceHandle(ModuleContext* context, const ServiceReference<S>& reference)
+    : ServiceHandleBase(context, reference)
+  {}
+
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICEHANDLE_H
@@ -25,6 +25,7 @@
 #include "usCoreModuleContext_p.h"
 #include "usServiceEventListenerHook.h"
 #include "usServiceFindHook.h"
+#include "usLDAPExpr_p.h"
 #include "usServiceListenerHook.h"
 #include "usServiceReferenceBasePrivate.h"
 
@@ -99,12 +100,14 @@ bool ServiceHooks::IsOpen() const
 }
 
 void ServiceHooks::FilterServiceReferences(ModuleContext* mc, const std::string& service,
-                                           const std::string& filter, std::vector<ServiceReferenceBase>& refs)
+                                           const LDAPExpr& ldap, std::vector<ServiceReferenceBase>& refs)
 {
   std::vector<ServiceRegistrationBase> srl;
   coreCtx->services.Get_unlocked(us_service_interface_iid<ServiceFindHook>(), srl);
   if (!srl.empty())
   {
+    // only create the filter string if there is a find hook to receive it
+    const std::string filter = ldap.IsNull() ? std::string() : ldap.ToString();
     ShrinkableVector<ServiceReferenceBase> filtered(refs);
 
     std::sort(srl.begin(), srl.end());
@@ -27,6 +27,7 @@
 
 US_BEGIN_NAMESPACE
 
+class LDAPExpr;
 struct ServiceListenerHook;
 
 class ServiceHooks : private MultiThreaded<>, private ServiceTrackerCustomizer<ServiceListenerHook>
@@ -55,7 +56,7 @@ public:
   bool IsOpen() const;
 
   void FilterServiceReferences(ModuleContext* mc, const std::string& service,
-                               const std::string& filter, std::vector<ServiceReferenceBase>& refs);
+                               const LDAPExpr& filter, std::vector<ServiceReferenceBase>& refs);
 
   void FilterServiceEventReceivers(const ServiceEvent& evt,
                                    ServiceListeners::ServiceListenerEntries& receivers);
@@ -0,0 +1,113 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceLease.h"
+
+#include "usServiceSelectionPolicy.h"
+#include "usUtils_p.h"
+
+US_BEGIN_NAMESPACE
+
+class ServiceLeaseBasePrivate
+{
+public:
+
+  AtomicInt ref;
+
+  ExplicitlySharedDataPointer<ServiceLoad> m_load;
+  long long m_start;
+  AtomicCounter m_released;
+
+  ServiceLeaseBasePrivate(ServiceLoad* load)
+    : m_load(load)
+    , m_start(0)
+  {
+    m_load->CallStarted();
+    m_start = GetMonotonicTime();
+  }
+
+  ~ServiceLeaseBasePrivate()
+  {
+    Release();
+  }
+
+  void Release()
+  {
+    // only the first release of any copy ends the call
+    if (m_released.AtomicIncrement() == 1)
+    {
+      m_load->CallEnded(GetMonotonicTime() - m_start);
+    }
+  }
+};
+
+ServiceLeaseBase::ServiceLeaseBase()
+  : d(NULL)
+{
+}
+
+ServiceLeaseBase::ServiceLeaseBase(ServiceLoad* load)
+  : d(NULL)
+{
+  if (load != NULL)
+  {
+    d = new ServiceLeaseBasePrivate(load);
+    d->ref.Ref();
+  }
+}
+
+ServiceLeaseBase::ServiceLeaseBase(const ServiceLeaseBase& other)
+  : d(other.d)
+{
+  if (d) d->ref.Ref();
+}
+
+ServiceLeaseBase::~ServiceLeaseBase()
+{
+  if (d && !d->ref.Deref())
+  {
+    delete d;
+  }
+}
+
+ServiceLeaseBase& ServiceLeaseBase::operator=(const ServiceLeaseBase& other)
+{
+  ServiceLeaseBasePrivate* curr_d = d;
+  d = other.d;
+  if (d) d->ref.Ref();
+
+  if (curr_d && !curr_d->ref.Deref())
+    delete curr_d;
+
+  return *this;
+}
+
+ServiceLeaseBase::operator bool_type() const
+{
+  return d ? &ServiceLeaseBase::d : NULL;
+}
+
+void ServiceLeaseBase::Release()
+{
+  if (d) d->Release();
+}
+
+US_END_NAMESPACE
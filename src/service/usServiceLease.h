@@ -0,0 +1,144 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+
+#ifndef USSERVICELEASE_H
+#define USSERVICELEASE_H
+
+#include <usConfig.h>
+
+#include "usServiceReference.h"
+
+US_BEGIN_NAMESPACE
+
+class ServiceLeaseBasePrivate;
+class ServiceLoad;
+template<class S, class TTT> class ServiceTracker;
+
+class US_EXPORT ServiceLeaseBase
+{
+
+private:
+
+  ServiceLeaseBasePrivate* d;
+
+protected:
+
+  typedef ServiceLeaseBasePrivate* ServiceLeaseBase::*bool_type;
+
+  ServiceLeaseBase();
+
+  ServiceLeaseBase(ServiceLoad* load);
+
+  ServiceLeaseBase(const ServiceLeaseBase& other);
+
+  ~ServiceLeaseBase();
+
+  ServiceLeaseBase& operator=(const ServiceLeaseBase& other);
+
+  operator bool_type() const;
+
+  void Release();
+
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * A service selected by <code>ServiceTracker::SelectService()</code> for
+ * one call.
+ *
+ * <p>
+ * The call to the service starts when the lease is created and ends when
+ * Release() is called on any copy of the lease, or when the last copy is
+ * destroyed. The tracker uses the number of calls in flight and their
+ * duration to select services for later calls.
+ *
+ * <p>
+ * A lease does not pin the service. It holds the tracked object, which is
+ * valid for as long as the service is tracked.
+ *
+ * \tparam S The type of the service.
+ * \tparam T The type of the tracked object.
+ * @see ServiceTracker::SelectService
+ */
+template<class S, class T = S*>
+class ServiceLease : private ServiceLeaseBase
+{
+
+public:
+
+  /**
+   * Creates an invalid ServiceLease object.
+   */
+  ServiceLease()
+    : service()
+  {}
+
+  /**
+   * Returns the tracked object of the selected service.
+   *
+   * @return The tracked object or a default constructed object if this
+   *         lease is invalid.
+   */
+  T Get() const
+  {
+    return service;
+  }
+
+  /**
+   * Returns the ServiceReference for the selected service.
+   *
+   * @return The ServiceReference, which is invalid if this lease is invalid.
+   */
+  ServiceReference<S> GetServiceReference() const
+  {
+    return reference;
+  }
+
+  /**
+   * Converts this lease to a boolean value, which is \c true if a service
+   * was selected.
+   */
+  using ServiceLeaseBase::operator bool_type;
+
+  /**
+   * Ends the call to the selected service. Calling this method more than
+   * once has no effect.
+   */
+  using ServiceLeaseBase::Release;
+
+private:
+
+  template<class S2, class TTT> friend class ServiceTracker;
+
+  ServiceLease(const ServiceReference<S>& reference, const T& service, ServiceLoad* load)
+    : ServiceLeaseBase(load), reference(reference), service(service)
+  {}
+
+  ServiceReference<S> reference;
+  T service;
+
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICELEASE_H
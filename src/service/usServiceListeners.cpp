@@ -23,6 +23,7 @@
 
 #include "usServiceListeners_p.h"
 #include "usServiceReferenceBasePrivate.h"
+#include "usServicePropertiesImpl_p.h"
 
 #include "usCoreModuleContext_p.h"
 #include "usModule.h"
@@ -39,37 +40,58 @@ ServiceListeners::ServiceListeners(CoreModuleContext* coreCtx)
 {
   hashedServiceKeys.push_back(ServiceConstants::OBJECTCLASS());
   hashedServiceKeys.push_back(ServiceConstants::SERVICE_ID());
+  SetLockName("ServiceListeners");
+  moduleListenerMapMutex.SetName("ServiceListeners::moduleListenerMapMutex");
 }
 
 void ServiceListeners::AddServiceListener(ModuleContext* mc, const ServiceListenerEntry::ServiceListener& listener,
                                           void* data, const std::string& filter)
 {
-  US_UNUSED(Lock(this));
-
   ServiceListenerEntry sle(mc, listener, data, filter);
-  RemoveServiceListener_unlocked(sle);
+  std::vector<ServiceListenerEntry> removed;
+
+  {
+    Lock lock(this); US_UNUSED(lock);
+    RemoveServiceListener_unlocked(sle, removed);
+
+    serviceSet.insert(sle);
+    CheckSimple(sle);
+  }
 
-  serviceSet.insert(sle);
+  // Hooks are called without holding the lock, they may call back
+  // into the listener registry.
+  if (!removed.empty())
+  {
+    coreCtx->serviceHooks.HandleServiceListenerUnreg(removed);
+  }
   coreCtx->serviceHooks.HandleServiceListenerReg(sle);
-  CheckSimple(sle);
 }
 
 void ServiceListeners::RemoveServiceListener(ModuleContext* mc, const ServiceListenerEntry::ServiceListener& listener,
                                              void* data)
 {
   ServiceListenerEntry entryToRemove(mc, listener, data);
+  std::vector<ServiceListenerEntry> removed;
+
+  {
+    Lock lock(this); US_UNUSED(lock);
+    RemoveServiceListener_unlocked(entryToRemove, removed);
+  }
 
-  US_UNUSED(Lock(this));
-  RemoveServiceListener_unlocked(entryToRemove);
+  if (!removed.empty())
+  {
+    coreCtx->serviceHooks.HandleServiceListenerUnreg(removed);
+  }
 }
 
-void ServiceListeners::RemoveServiceListener_unlocked(const ServiceListenerEntry& entryToRemove)
+void ServiceListeners::RemoveServiceListener_unlocked(const ServiceListenerEntry& entryToRemove,
+                                                      std::vector<ServiceListenerEntry>& removed)
 {
   ServiceListenerEntries::const_iterator it = serviceSet.find(entryToRemove);
   if (it != serviceSet.end())
   {
     it->SetRemoved(true);
-    coreCtx->serviceHooks.HandleServiceListenerUnreg(*it);
+    removed.push_back(*it);
     RemoveFromCache(*it);
     serviceSet.erase(it);
   }
@@ -110,7 +132,7 @@ void ServiceListeners::ModuleChanged(const ModuleEvent& evt)
 void ServiceListeners::RemoveAllListeners(ModuleContext* mc)
 {
   {
-    US_UNUSED(Lock(this));
+    Lock lock(this); US_UNUSED(lock);
     for (ServiceListenerEntries::iterator it = serviceSet.begin();
          it != serviceSet.end(); )
     {
@@ -135,14 +157,16 @@ void ServiceListeners::RemoveAllListeners(ModuleContext* mc)
 
 void ServiceListeners::HooksModuleStopped(ModuleContext* mc)
 {
-  US_UNUSED(Lock(this));
   std::vector<ServiceListenerEntry> entries;
-  for (ServiceListenerEntries::iterator it = serviceSet.begin();
-       it != serviceSet.end(); )
   {
-    if (it->GetModuleContext() == mc)
+    SharedLock lock(this); US_UNUSED(lock);
+    for (ServiceListenerEntries::const_iterator it = serviceSet.begin();
+         it != serviceSet.end(); ++it)
     {
-      entries.push_back(*it);
+      if (it->GetModuleContext() == mc)
+      {
+        entries.push_back(*it);
+      }
     }
   }
   coreCtx->serviceHooks.HandleServiceListenerUnreg(entries);
@@ -194,15 +218,23 @@ void ServiceListeners::ServiceChanged(ServiceListenerEntries& receivers,
   //US_DEBUG << "Notified " << n << " listeners";
 }
 
-void ServiceListeners::GetMatchingServiceListeners(const ServiceEvent& evt, ServiceListenerEntries& set,
-                                                   bool lockProps)
+void ServiceListeners::GetMatchingServiceListeners(const ServiceEvent& evt, ServiceListenerEntries& set)
 {
-  US_UNUSED(Lock(this));
+  // Evaluate all filters against the same version of the properties
+  const ServicePropertiesImpl props = evt.GetServiceReference().d->GetProperties();
 
-  // Filter the original set of listeners
-  ServiceListenerEntries receivers = serviceSet;
+  // Filter the original set of listeners. The hooks are called without
+  // holding the lock, they may call back into the listener registry.
+  ServiceListenerEntries receivers;
+  {
+    SharedLock lock(this); US_UNUSED(lock);
+    receivers = serviceSet;
+  }
   coreCtx->serviceHooks.FilterServiceEventReceivers(evt, receivers);
 
+  // Concurrent events only read the listener caches
+  SharedLock lock(this); US_UNUSED(lock);
+
   // Check complicated or empty listener filters
   for (std::list<ServiceListenerEntry>::const_iterator sse = complicatedListeners.begin();
        sse != complicatedListeners.end(); ++sse)
@@ -210,7 +242,7 @@ void ServiceListeners::GetMatchingServiceListeners(const ServiceEvent& evt, Serv
     if (receivers.count(*sse) == 0) continue;
     const LDAPExpr& ldapExpr = sse->GetLDAPExpr();
     if (ldapExpr.IsNull() ||
-        ldapExpr.Evaluate(evt.GetServiceReference().d->GetProperties(), false))
+        ldapExpr.Evaluate(props, false))
     {
       set.insert(*sse);
     }
@@ -220,15 +252,15 @@ void ServiceListeners::GetMatchingServiceListeners(const ServiceEvent& evt, Serv
   //         << " listeners with complicated filters";
 
   // Check the cache
-  const std::vector<std::string> c(any_cast<std::vector<std::string> >
-                                 (evt.GetServiceReference().d->GetProperty(ServiceConstants::OBJECTCLASS(), lockProps)));
+  const std::vector<std::string>& c =
+      ref_any_cast<std::vector<std::string> >(props.Value(PropertyKeys::KEY_OBJECTCLASS));
   for (std::vector<std::string>::const_iterator objClass = c.begin();
        objClass != c.end(); ++objClass)
   {
     AddToSet(set, receivers, OBJECTCLASS_IX, *objClass);
   }
 
-  long service_id = any_cast<long>(evt.GetServiceReference().d->GetProperty(ServiceConstants::SERVICE_ID(), lockProps));
+  long service_id = any_cast<long>(props.Value(PropertyKeys::KEY_SERVICE_ID));
   std::stringstream ss;
   ss << service_id;
   AddToSet(set, receivers, SERVICE_ID_IX, ss.str());
@@ -236,7 +268,7 @@ void ServiceListeners::GetMatchingServiceListeners(const ServiceEvent& evt, Serv
 
 std::vector<ServiceListenerHook::ListenerInfo> ServiceListeners::GetListenerInfoCollection() const
 {
-  US_UNUSED(Lock(this));
+  SharedLock lock(this); US_UNUSED(lock);
   std::vector<ServiceListenerHook::ListenerInfo> result;
   result.reserve(serviceSet.size());
   for (ServiceListenerEntries::const_iterator iter = serviceSet.begin(),
@@ -304,11 +336,13 @@ void ServiceListeners::RemoveFromCache(const ServiceListenerEntry& sle)
 
 void ServiceListeners::AddToSet(ServiceListenerEntries& set,
                                 const ServiceListenerEntries& receivers,
-                                int cache_ix, const std::string& val)
+                                int cache_ix, const std::string& val) const
 {
-  std::list<ServiceListenerEntry>& l = cache[cache_ix][val];
-  if (!l.empty())
+  // Do not use operator[], the cache must not be modified by readers
+  CacheType::const_iterator iter = cache[cache_ix].find(val);
+  if (iter != cache[cache_ix].end())
   {
+    const std::list<ServiceListenerEntry>& l = iter->second;
     //US_DEBUG << hashedServiceKeys[cache_ix] << " matches " << l.size();
 
     for (std::list<ServiceListenerEntry>::const_iterator entry = l.begin();
@@ -26,6 +26,7 @@
 #include <list>
 #include <string>
 #include <set>
+#include <vector>
 
 #include <usConfig.h>
 
@@ -40,7 +41,7 @@ class ModuleContext;
  * Here we handle all listeners that modules have registered.
  *
  */
-class ServiceListeners : private MultiThreaded<>
+class ServiceListeners : private MultiThreaded<SharedMutexLockingStrategy>
 {
 
 public:
@@ -150,15 +151,20 @@ public:
    *
    *
    */
-  void GetMatchingServiceListeners(const ServiceEvent& evt, ServiceListenerEntries& listeners,
-                                   bool lockProps = true);
+  void GetMatchingServiceListeners(const ServiceEvent& evt, ServiceListenerEntries& listeners);
 
 
   std::vector<ServiceListenerHook::ListenerInfo> GetListenerInfoCollection() const;
 
 private:
 
-  void RemoveServiceListener_unlocked(const ServiceListenerEntry& entryToRemove);
+  /**
+   * Remove a service listener. The removed entry is appended to
+   * <code>removed</code>, so the caller can notify hooks after
+   * releasing the lock.
+   */
+  void RemoveServiceListener_unlocked(const ServiceListenerEntry& entryToRemove,
+                                      std::vector<ServiceListenerEntry>& removed);
 
   /**
    * Remove all references to a service listener from the service listener
@@ -172,7 +178,7 @@ private:
    */
   void CheckSimple(const ServiceListenerEntry& sle);
 
-  void AddToSet(ServiceListenerEntries& set, const ServiceListenerEntries& receivers, int cache_ix, const std::string& val);
+  void AddToSet(ServiceListenerEntries& set, const ServiceListenerEntries& receivers, int cache_ix, const std::string& val) const;
 
 };
 
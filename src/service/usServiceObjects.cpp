@@ -22,8 +22,8 @@
 #include "usServiceObjects.h"
 
 #include "usServiceReferenceBasePrivate.h"
-
-#include <set>
+#include "usServiceRegistrationBasePrivate.h"
+#include "usInterfaceMapImpl_p.h"
 
 US_BEGIN_NAMESPACE
 
@@ -36,26 +36,29 @@ public:
   ModuleContext* m_context;
   ServiceReferenceBase m_reference;
 
+  // The slots of the retrieved prototype scope service objects, or
+  // ServiceRegistrationBasePrivate::NO_SLOT for other scopes.
   // This is used by all ServiceObjects<S> instances with S != void
-  std::map<void*, InterfaceMap> m_serviceInstances;
+  US_UNORDERED_MAP_TYPE<void*, std::size_t> m_serviceInstances;
   // This is used by ServiceObjects<void>
-  std::set<InterfaceMap> m_serviceInterfaceMaps;
+  US_UNORDERED_MAP_TYPE<InterfaceMapImpl, std::size_t> m_serviceInterfaceMaps;
 
   ServiceObjectsBasePrivate(ModuleContext* context, const ServiceReferenceBase& reference)
     : m_context(context)
     , m_reference(reference)
   {}
 
-  InterfaceMap GetServiceInterfaceMap()
+  InterfaceMapImpl GetServiceInterfaceMap(std::size_t& slot)
   {
-    InterfaceMap result;
+    InterfaceMapImpl result;
+    slot = ServiceRegistrationBasePrivate::NO_SLOT;
 
     bool isPrototypeScope = m_reference.GetProperty(ServiceConstants::SERVICE_SCOPE()).ToString() ==
                             ServiceConstants::SCOPE_PROTOTYPE();
 
     if (isPrototypeScope)
     {
-      result = m_reference.d->GetPrototypeService(m_context->GetModule());
+      result = m_reference.d->GetPrototypeService(m_context->GetModule(), slot);
     }
     else
     {
@@ -84,31 +87,31 @@ void* ServiceObjectsBase::GetService() const
     return NULL;
   }
 
-  InterfaceMap im = d->GetServiceInterfaceMap();
-  void* result = im.find(d->m_reference.GetInterfaceId())->second;
+  std::size_t slot = 0;
+  void* result = d->GetServiceInterfaceMap(slot).Find(d->m_reference.GetInterfaceId());
 
   if (result)
   {
-    d->m_serviceInstances.insert(std::make_pair(result, im));
+    d->m_serviceInstances.insert(std::make_pair(result, slot));
   }
   return result;
 }
 
 InterfaceMap ServiceObjectsBase::GetServiceInterfaceMap() const
 {
-  InterfaceMap result;
   if (!d->m_reference)
   {
-    return result;
+    return InterfaceMap();
   }
 
-  result = d->GetServiceInterfaceMap();
+  std::size_t slot = 0;
+  InterfaceMapImpl result = d->GetServiceInterfaceMap(slot);
 
-  if (!result.empty())
+  if (!result.Empty())
   {
-    d->m_serviceInterfaceMaps.insert(result);
+    d->m_serviceInterfaceMaps.insert(std::make_pair(result, slot));
   }
-  return result;
+  return result.ToInterfaceMap();
 }
 
 void ServiceObjectsBase::UngetService(void* service)
@@ -118,7 +121,7 @@ void ServiceObjectsBase::UngetService(void* service)
     return;
   }
 
-  std::map<void*,InterfaceMap>::iterator serviceIter = d->m_serviceInstances.find(service);
+  US_UNORDERED_MAP_TYPE<void*, std::size_t>::iterator serviceIter = d->m_serviceInstances.find(service);
   if (serviceIter == d->m_serviceInstances.end())
   {
     throw std::invalid_argument("The provided service has not been retrieved via this ServiceObjects instance");
@@ -141,13 +144,14 @@ void ServiceObjectsBase::UngetService(const InterfaceMap& interfaceMap)
     return;
   }
 
-  std::set<InterfaceMap>::iterator serviceIter = d->m_serviceInterfaceMaps.find(interfaceMap);
+  US_UNORDERED_MAP_TYPE<InterfaceMapImpl, std::size_t>::iterator serviceIter =
+      d->m_serviceInterfaceMaps.find(InterfaceMapImpl(interfaceMap));
   if (serviceIter == d->m_serviceInterfaceMaps.end())
   {
     throw std::invalid_argument("The provided service has not been retrieved via this ServiceObjects instance");
   }
 
-  if (!d->m_reference.d->UngetPrototypeService(d->m_context->GetModule(), interfaceMap))
+  if (!d->m_reference.d->UngetPrototypeService(d->m_context->GetModule(), serviceIter->second))
   {
     US_WARN << "Ungetting service unsuccessful";
   }
@@ -68,6 +68,12 @@ const std::string& ServiceConstants::SCOPE_PROTOTYPE()
   return s;
 }
 
+const std::string& ServiceConstants::SERVICE_POOL_SIZE()
+{
+  static const std::string s("service.pool.size");
+  return s;
+}
+
 US_END_NAMESPACE
 
 US_USE_NAMESPACE
@@ -81,3 +87,4 @@ std::string tmp4 = ServiceConstants::SERVICE_SCOPE();
 std::string tmp5 = ServiceConstants::SCOPE_SINGLETON();
 std::string tmp6 = ServiceConstants::SCOPE_MODULE();
 std::string tmp7 = ServiceConstants::SCOPE_PROTOTYPE();
+std::string tmp8 = ServiceConstants::SERVICE_POOL_SIZE();
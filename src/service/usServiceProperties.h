@@ -131,6 +131,28 @@ US_EXPORT const std::string& SCOPE_MODULE(); // = "module"
  */
 US_EXPORT const std::string& SCOPE_PROTOTYPE(); // = "prototype"
 
+/**
+ * Service property enabling an instance pool for a prototype scope service.
+ *
+ * <p>
+ * This property may be supplied in the <code>ServiceProperties</code> object
+ * passed to the <code>ModuleContext::RegisterService</code> method. The value
+ * of this property must be of type <code>int</code> and is the maximum number
+ * of released service objects which are kept for reuse. Service objects
+ * released via ServiceObjects::UngetService() are reset by
+ * PrototypeServiceFactory::ResetService() and handed out again by later
+ * ServiceObjects::GetService() calls of the same module, instead of being
+ * returned to the factory.
+ *
+ * <p>
+ * If the property is missing or not of type <code>int</code>, service objects
+ * are not pooled. The property is ignored for services which are not
+ * registered with a PrototypeServiceFactory.
+ *
+ * @see ServiceRegistrationBase::GetPoolStatistics()
+ */
+US_EXPORT const std::string& SERVICE_POOL_SIZE(); // = "service.pool.size"
+
 }
 
 US_END_NAMESPACE
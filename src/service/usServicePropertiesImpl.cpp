@@ -21,6 +21,8 @@
 
 #include "usServicePropertiesImpl_p.h"
 
+#include <algorithm>
+#include <cctype>
 #include <limits>
 #include <stdexcept>
 #ifdef US_PLATFORM_WINDOWS
@@ -33,53 +35,194 @@
 
 US_BEGIN_NAMESPACE
 
+namespace {
+
+// Keys which are owned by the framework and cannot be updated
+bool IsFrameworkKey(int keyId)
+{
+  return keyId == PropertyKeys::KEY_OBJECTCLASS ||
+         keyId == PropertyKeys::KEY_SERVICE_ID ||
+         keyId == PropertyKeys::KEY_SERVICE_SCOPE;
+}
+
+}
+
 Any ServicePropertiesImpl::emptyAny;
 
-ServicePropertiesImpl::ServicePropertiesImpl(const ServiceProperties& p)
+ServicePropertiesImpl::ServicePropertiesImpl(const ServiceProperties& p, bool internKeys)
 {
-  if (p.size() > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+  ExplicitlySharedDataPointer<Data> data(new Data);
+  data->keys.reserve(p.size());
+  data->values.reserve(p.size());
+  data->hashes.reserve(p.size());
+  data->ids.reserve(p.size());
+
+  for (ServiceProperties::const_iterator iter = p.begin();
+       iter != p.end(); ++iter)
+  {
+    Append(data.Data(), iter->first, HashCaseInsensitive(iter->first),
+           internKeys ? PropertyKeys::Intern(iter->first) : PropertyKeys::Find(iter->first),
+           ValuePointer(new SharedValue(iter->second)));
+  }
+  Index(data.Data());
+  d = data;
+}
+
+ServicePropertiesImpl::ServicePropertiesImpl(const ServicePropertiesImpl& base,
+                                             const ServiceProperties& changed,
+                                             const std::vector<std::string>& removed)
+{
+  const Data* old = base.d.ConstData();
+
+  // mark the entries of base which are replaced or removed
+  std::vector<bool> dropped(old->keys.size(), false);
+  for (ServiceProperties::const_iterator iter = changed.begin();
+       iter != changed.end(); ++iter)
+  {
+    const int index = Find(old, iter->first, HashCaseInsensitive(iter->first));
+    if (index > -1 && !IsFrameworkKey(old->ids[index])) dropped[index] = true;
+  }
+  for (std::vector<std::string>::const_iterator iter = removed.begin();
+       iter != removed.end(); ++iter)
+  {
+    const int index = Find(old, *iter, HashCaseInsensitive(*iter));
+    if (index > -1 && !IsFrameworkKey(old->ids[index])) dropped[index] = true;
+  }
+
+  ExplicitlySharedDataPointer<Data> data(new Data);
+  data->keys.reserve(old->keys.size() + changed.size());
+  data->values.reserve(old->keys.size() + changed.size());
+  data->hashes.reserve(old->keys.size() + changed.size());
+  data->ids.reserve(old->keys.size() + changed.size());
+
+  for (std::size_t i = 0; i < old->keys.size(); ++i)
+  {
+    if (dropped[i]) continue;
+    // share the value with the base set
+    Append(data.Data(), old->keys[i], old->hashes[i], old->ids[i], old->values[i]);
+  }
+  for (ServiceProperties::const_iterator iter = changed.begin();
+       iter != changed.end(); ++iter)
+  {
+    const int keyId = PropertyKeys::Intern(iter->first);
+    if (IsFrameworkKey(keyId)) continue;
+    Append(data.Data(), iter->first, HashCaseInsensitive(iter->first),
+           keyId, ValuePointer(new SharedValue(iter->second)));
+  }
+  Index(data.Data());
+  d = data;
+}
+
+void ServicePropertiesImpl::Append(Data* data, const std::string& key, std::size_t hash,
+                                   int keyId, const ValuePointer& value)
+{
+  data->keys.push_back(key);
+  data->values.push_back(value);
+  data->hashes.push_back(hash);
+  data->ids.push_back(keyId);
+}
+
+void ServicePropertiesImpl::Index(Data* data)
+{
+  const std::size_t size = data->keys.size();
+  if (size > static_cast<std::size_t>(std::numeric_limits<int>::max() / 2))
   {
     throw std::runtime_error("ServiceProperties object contains too many keys");
   }
 
-  keys.reserve(p.size());
-  values.reserve(p.size());
+  std::size_t tableSize = 2;
+  while (tableSize < 2 * size) tableSize <<= 1;
+  data->table.assign(tableSize, -1);
+  const std::size_t mask = tableSize - 1;
 
-  for (ServiceProperties::const_iterator iter = p.begin();
-       iter != p.end(); ++iter)
+  std::fill(data->wellKnownKeys, data->wellKnownKeys + PropertyKeys::WELL_KNOWN_KEY_COUNT, -1);
+  data->keyIds.clear();
+  data->interned = true;
+
+  for (std::size_t i = 0; i < size; ++i)
   {
-    if (Find(iter->first) > -1)
+    const std::string& key = data->keys[i];
+    const std::size_t hash = data->hashes[i];
+    if (Find(data, key, hash) > -1)
     {
       std::string msg = "ServiceProperties object contains case variants of the key: ";
-      msg += iter->first;
+      msg += key;
       throw std::runtime_error(msg.c_str());
     }
-    keys.push_back(iter->first);
-    values.push_back(iter->second);
+
+    std::size_t slot = hash & mask;
+    while (data->table[slot] > -1) slot = (slot + 1) & mask;
+    const int index = static_cast<int>(i);
+    data->table[slot] = index;
+
+    const int keyId = data->ids[i];
+    if (keyId < 0)
+    {
+      data->interned = false;
+    }
+    else if (keyId < PropertyKeys::WELL_KNOWN_KEY_COUNT)
+    {
+      data->wellKnownKeys[keyId] = index;
+    }
+    else
+    {
+      data->keyIds.push_back(std::make_pair(keyId, index));
+    }
   }
+  std::sort(data->keyIds.begin(), data->keyIds.end());
 }
 
 const Any& ServicePropertiesImpl::Value(const std::string& key) const
 {
-  int i = Find(key);
-  if (i < 0) return emptyAny;
-  return values[i];
+  return Value(Find(key));
 }
 
 const Any& ServicePropertiesImpl::Value(int index) const
 {
-  if (index < 0 || static_cast<std::size_t>(index) >= values.size())
+  if (index < 0 || static_cast<std::size_t>(index) >= d->values.size())
     return emptyAny;
-  return values[static_cast<std::size_t>(index)];
+  return d->values[static_cast<std::size_t>(index)]->value;
+}
+
+const Any& ServicePropertiesImpl::Value(PropertyKeys::WellKnownKey key) const
+{
+  return Value(d->wellKnownKeys[key]);
+}
+
+int ServicePropertiesImpl::Find(int keyId, const std::string& key) const
+{
+  if (keyId < 0 || !d->interned)
+  {
+    return Find(key);
+  }
+  if (keyId < PropertyKeys::WELL_KNOWN_KEY_COUNT)
+  {
+    return d->wellKnownKeys[keyId];
+  }
+  std::vector<std::pair<int, int> >::const_iterator iter =
+      std::lower_bound(d->keyIds.begin(), d->keyIds.end(), std::make_pair(keyId, -1));
+  if (iter != d->keyIds.end() && iter->first == keyId)
+  {
+    return iter->second;
+  }
+  return -1;
 }
 
 int ServicePropertiesImpl::Find(const std::string& key) const
 {
-  for (std::size_t i = 0; i < keys.size(); ++i)
+  return Find(d.ConstData(), key, HashCaseInsensitive(key));
+}
+
+int ServicePropertiesImpl::Find(const Data* data, const std::string& key, std::size_t hash)
+{
+  const std::size_t mask = data->table.size() - 1;
+  for (std::size_t slot = hash & mask; data->table[slot] > -1; slot = (slot + 1) & mask)
   {
-    if (ci_compare(key.c_str(), keys[i].c_str(), key.size()) == 0)
+    const int index = data->table[slot];
+    if (data->hashes[index] == hash && data->keys[index].size() == key.size() &&
+        ci_compare(key.c_str(), data->keys[index].c_str(), key.size()) == 0)
     {
-      return static_cast<int>(i);
+      return index;
     }
   }
   return -1;
@@ -87,19 +230,31 @@ int ServicePropertiesImpl::Find(const std::string& key) const
 
 int ServicePropertiesImpl::FindCaseSensitive(const std::string& key) const
 {
-  for (std::size_t i = 0; i < keys.size(); ++i)
+  // there are no case variants, so the case insensitive
+  // match is the only candidate
+  const int index = Find(key);
+  if (index > -1 && d->keys[index] == key)
   {
-    if (key == keys[i])
-    {
-      return static_cast<int>(i);
-    }
+    return index;
   }
   return -1;
 }
 
 const std::vector<std::string>& ServicePropertiesImpl::Keys() const
 {
-  return keys;
+  return d->keys;
+}
+
+std::size_t ServicePropertiesImpl::HashCaseInsensitive(const std::string& key)
+{
+  // FNV-1a over the lower case characters
+  std::size_t hash = static_cast<std::size_t>(2166136261u);
+  for (std::string::const_iterator i = key.begin(), end = key.end(); i != end; ++i)
+  {
+    hash ^= static_cast<std::size_t>(std::tolower(static_cast<unsigned char>(*i)));
+    hash *= static_cast<std::size_t>(16777619u);
+  }
+  return hash;
 }
 
 US_END_NAMESPACE
@@ -23,28 +23,134 @@
 #define USSERVICEPROPERTIESIMPL_P_H
 
 #include "usServiceProperties.h"
+#include "usPropertyKeys_p.h"
+#include "usSharedData.h"
 
 US_BEGIN_NAMESPACE
 
+/**
+ * An immutable set of service properties.
+ *
+ * Copying a ServicePropertiesImpl object only increments a reference
+ * count. Modifications create a new set which shares the values of all
+ * unchanged keys with the set it was derived from, so holders of the
+ * old set keep a consistent snapshot.
+ */
 class ServicePropertiesImpl
 {
 
 public:
 
-  explicit ServicePropertiesImpl(const ServiceProperties& props);
+  /**
+   * Creates a property set from \c props.
+   *
+   * @param internKeys If <code>true</code>, the keys are added to the
+   *        PropertyKeys table. Otherwise only the ids of already interned
+   *        keys are used, which is appropriate for transient sets.
+   */
+  explicit ServicePropertiesImpl(const ServiceProperties& props, bool internKeys = false);
+
+  /**
+   * Creates a property set from \c base, with the properties from
+   * \c changed added or replacing existing keys (compared case
+   * insensitively) and the keys in \c removed erased. The keys of
+   * \c changed are interned. The framework
+   * keys ObjectClass, service.id and service.scope are never changed.
+   *
+   * @throws std::runtime_error If \c changed contains case variants
+   *         of the same key.
+   */
+  ServicePropertiesImpl(const ServicePropertiesImpl& base,
+                        const ServiceProperties& changed,
+                        const std::vector<std::string>& removed);
 
   const Any& Value(const std::string& key) const;
   const Any& Value(int index) const;
 
+  /**
+   * Returns the value of a well-known key from its fixed slot.
+   */
+  const Any& Value(PropertyKeys::WellKnownKey key) const;
+
+  /**
+   * Case insensitive key lookup.
+   *
+   * @return The index of \c key or -1 if there is no such key.
+   */
   int Find(const std::string& key) const;
+
+  /**
+   * Case sensitive key lookup.
+   *
+   * @return The index of \c key or -1 if there is no such key.
+   */
   int FindCaseSensitive(const std::string& key) const;
 
+  /**
+   * Case insensitive key lookup using the id of the interned key. If
+   * \c keyId is -1 or ids are not available, \c key is looked up instead.
+   *
+   * @return The index of the key or -1 if there is no such key.
+   */
+  int Find(int keyId, const std::string& key) const;
+
   const std::vector<std::string>& Keys() const;
 
 private:
 
-  std::vector<std::string> keys;
-  std::vector<Any> values;
+  /*
+   * A property value, shared between all property sets derived
+   * from the set which introduced it.
+   */
+  struct SharedValue : public SharedData
+  {
+    explicit SharedValue(const Any& v) : value(v) {}
+    const Any value;
+  };
+
+  typedef ExplicitlySharedDataPointer<SharedValue> ValuePointer;
+
+  struct Data : public SharedData
+  {
+    Data() : interned(true) {}
+
+    std::vector<std::string> keys;
+    std::vector<ValuePointer> values;
+    std::vector<std::size_t> hashes;
+    std::vector<int> ids;
+
+    /*
+     * Open addressing hash table with linear probing, keyed by the
+     * case folded key hash. Each slot contains an index into keys or -1.
+     * The size is a power of two and at least twice the number of keys,
+     * so there is always a free slot terminating the probe sequence.
+     * Since case variants of a key are rejected, a key maps to at most
+     * one entry in both lookup modes.
+     */
+    std::vector<int> table;
+
+    /*
+     * Indices of the well-known keys and the (key id, index) pairs of all
+     * other keys, sorted by key id. If a key has no id, for example in a
+     * transient set, only the well-known slots are used.
+     */
+    int wellKnownKeys[PropertyKeys::WELL_KNOWN_KEY_COUNT];
+    std::vector<std::pair<int, int> > keyIds;
+    bool interned;
+  };
+
+  static std::size_t HashCaseInsensitive(const std::string& key);
+
+  // Appends a key and its value, without indexing it
+  static void Append(Data* data, const std::string& key, std::size_t hash,
+                     int keyId, const ValuePointer& value);
+
+  // Builds the lookup structures from the keys of data
+  static void Index(Data* data);
+
+  static int Find(const Data* data, const std::string& key, std::size_t hash);
+
+  ExplicitlySharedDataPointer<const Data> d;
 
   static Any emptyAny;
 
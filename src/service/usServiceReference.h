@@ -139,4 +139,11 @@ typedef ServiceReference<void> ServiceReferenceU;
 
 US_END_NAMESPACE
 
+US_HASH_FUNCTION_NAMESPACE_BEGIN
+template<class S>
+struct hash<US_PREPEND_NAMESPACE(ServiceReference)<S> > : public hash<US_PREPEND_NAMESPACE(ServiceReferenceBase)>
+{
+};
+US_HASH_FUNCTION_NAMESPACE_END
+
 #endif // USSERVICEREFERENCE_H
@@ -29,6 +29,20 @@
 
 US_BEGIN_NAMESPACE
 
+namespace {
+
+// Reads the ranking and id from their fixed property slots
+// without copying the Any values
+void GetRankingAndId(ServiceRegistrationBasePrivate* registration, int& ranking, long int& id)
+{
+  const ServicePropertiesImpl props = registration->GetProperties();
+  const Any& anyRanking = props.Value(PropertyKeys::KEY_SERVICE_RANKING);
+  if (anyRanking.TypeTag() == ANY_TYPE_INT) ranking = ref_any_cast<int>(anyRanking);
+  id = any_cast<long int>(props.Value(PropertyKeys::KEY_SERVICE_ID));
+}
+
+}
+
 ServiceReferenceBase::ServiceReferenceBase()
   : d(new ServiceReferenceBasePrivate(0))
 {
@@ -55,6 +69,8 @@ void ServiceReferenceBase::SetInterfaceId(const std::string& interfaceId)
     d = new ServiceReferenceBasePrivate(d->registration);
   }
   d->interfaceId = interfaceId;
+  d->interfaceKey = interfaceId.empty() ? -1 : InterfaceMapImpl::InternInterfaceId(interfaceId);
+  d->cachedService.Store(NULL);
 }
 
 ServiceReferenceBase::operator bool_type() const
@@ -81,16 +97,13 @@ ServiceReferenceBase::~ServiceReferenceBase()
 
 Any ServiceReferenceBase::GetProperty(const std::string& key) const
 {
-  MutexLock lock(d->registration->propsLock);
-
-  return d->registration->properties.Value(key);
+  return d->registration->GetProperties().Value(key);
 }
 
 void ServiceReferenceBase::GetPropertyKeys(std::vector<std::string>& keys) const
 {
-  MutexLock lock(d->registration->propsLock);
-
-  const std::vector<std::string>& ks = d->registration->properties.Keys();
+  const ServicePropertiesImpl props = d->registration->GetProperties();
+  const std::vector<std::string>& ks = props.Keys();
   keys.assign(ks.begin(), ks.end());
 }
 
@@ -106,7 +119,8 @@ Module* ServiceReferenceBase::GetModule() const
 
 void ServiceReferenceBase::GetUsingModules(std::vector<Module*>& modules) const
 {
-  MutexLock lock(d->registration->propsLock);
+  ServiceRegistrationBasePrivate::PropsMutex::Lock lock(d->registration->propsLock);
+  US_UNUSED(lock);
 
   ServiceRegistrationBasePrivate::ModuleToRefsMap::const_iterator end = d->registration->dependents.end();
   for (ServiceRegistrationBasePrivate::ModuleToRefsMap::const_iterator iter = d->registration->dependents.begin();
@@ -114,6 +128,15 @@ void ServiceReferenceBase::GetUsingModules(std::vector<Module*>& modules) const
   {
     modules.push_back(iter->first);
   }
+
+  for (const ServiceRegistrationBasePrivate::ModuleUseCount* useCount = d->registration->useCounts.Load();
+       useCount; useCount = useCount->next)
+  {
+    if (ServiceRegistrationBasePrivate::UseCount(useCount) > 0)
+    {
+      modules.push_back(useCount->module);
+    }
+  }
 }
 
 bool ServiceReferenceBase::operator<(const ServiceReferenceBase& reference) const
@@ -131,10 +154,10 @@ bool ServiceReferenceBase::operator<(const ServiceReferenceBase& reference) cons
     return false;
   }
 
-  Any anyR1 = GetProperty(ServiceConstants::SERVICE_RANKING());
-  Any anyR2 = reference.GetProperty(ServiceConstants::SERVICE_RANKING());
-  if (anyR1.Type() == typeid(int)) r1 = any_cast<int>(anyR1);
-  if (anyR2.Type() == typeid(int)) r2 = any_cast<int>(anyR2);
+  long int id1 = 0;
+  long int id2 = 0;
+  GetRankingAndId(d->registration, r1, id1);
+  GetRankingAndId(reference.d->registration, r2, id2);
 
   if (r1 != r2)
   {
@@ -143,9 +166,6 @@ bool ServiceReferenceBase::operator<(const ServiceReferenceBase& reference) cons
   }
   else
   {
-    long int id1 = any_cast<long int>(GetProperty(ServiceConstants::SERVICE_ID()));
-    long int id2 = any_cast<long int>(reference.GetProperty(ServiceConstants::SERVICE_ID()));
-
     // otherwise compare using IDs,
     // is less than if it has a higher ID.
     return id2 < id1;
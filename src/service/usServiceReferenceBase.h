@@ -187,6 +187,8 @@ private:
   friend class ModuleContext;
   friend class ModuleHooks;
   friend class ServiceHooks;
+  friend class ServiceHandleBase;
+  friend class ServiceHandleBasePrivate;
   friend class ServiceObjectsBase;
   friend class ServiceObjectsBasePrivate;
   friend class ServiceRegistrationBase;
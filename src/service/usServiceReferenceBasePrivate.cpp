@@ -24,7 +24,7 @@
 
 #include "usServiceReferenceBasePrivate.h"
 
-#include "usServiceFactory.h"
+#include "usPrototypeServiceFactory.h"
 #include "usServiceException.h"
 #include "usServiceRegistry_p.h"
 #include "usServiceRegistrationBasePrivate.h"
@@ -43,7 +43,7 @@
 US_BEGIN_NAMESPACE
 
 ServiceReferenceBasePrivate::ServiceReferenceBasePrivate(ServiceRegistrationBasePrivate* reg)
-  : ref(1), registration(reg)
+  : ref(1), registration(reg), interfaceKey(-1), cachedService()
 {
   if(registration) registration->ref.Ref();
 }
@@ -54,23 +54,23 @@ ServiceReferenceBasePrivate::~ServiceReferenceBasePrivate()
     delete registration;
 }
 
-InterfaceMap ServiceReferenceBasePrivate::GetServiceFromFactory(Module* module,
-                                                                ServiceFactory* factory,
-                                                                bool isModuleScope)
+InterfaceMapImpl ServiceReferenceBasePrivate::GetServiceFromFactory(Module* module,
+                                                                    ServiceFactory* factory)
 {
   assert(factory && "Factory service pointer is NULL");
-  InterfaceMap s;
+  InterfaceMapImpl s;
   try
   {
-    InterfaceMap smap = factory->GetService(module,
-                                            ServiceRegistrationBase(registration));
+    const InterfaceMap smap = factory->GetService(module,
+                                                  ServiceRegistrationBase(registration));
     if (smap.empty())
     {
       US_WARN << "ServiceFactory produced null";
-      return smap;
+      return s;
     }
+    const ServicePropertiesImpl props = registration->GetProperties();
     const std::vector<std::string>& classes =
-        ref_any_cast<std::vector<std::string> >(registration->properties.Value(ServiceConstants::OBJECTCLASS()));
+        ref_any_cast<std::vector<std::string> >(props.Value(PropertyKeys::KEY_OBJECTCLASS));
     for (std::vector<std::string>::const_iterator i = classes.begin();
          i != classes.end(); ++i)
     {
@@ -78,245 +78,340 @@ InterfaceMap ServiceReferenceBasePrivate::GetServiceFromFactory(Module* module,
       {
         US_WARN << "ServiceFactory produced an object "
                    "that did not implement: " << (*i);
-        smap.clear();
-        return smap;
+        return s;
       }
     }
-    s = smap;
-
-    if (isModuleScope)
-    {
-      registration->moduleServiceInstance.insert(std::make_pair(module, smap));
-    }
-    else
-    {
-      registration->prototypeServiceInstances[module].push_back(smap);
-    }
+    s = InterfaceMapImpl(smap);
   }
   catch (...)
   {
     US_WARN << "ServiceFactory threw an exception";
-    s.clear();
+    s = InterfaceMapImpl();
   }
   return s;
 }
 
-InterfaceMap ServiceReferenceBasePrivate::GetPrototypeService(Module* module)
+void ServiceReferenceBasePrivate::UngetServiceFromFactory(Module* module, const InterfaceMapImpl& service)
 {
-  InterfaceMap s;
+  try
   {
-    MutexLock lock(registration->propsLock);
-    if (registration->available)
-    {
-      ServiceFactory* factory = reinterpret_cast<ServiceFactory*>(
-            registration->GetService("org.cppmicroservices.factory"));
-      s = GetServiceFromFactory(module, factory, false);
-    }
+    registration->factory->UngetService(module, ServiceRegistrationBase(registration), service.ToInterfaceMap());
+  }
+  catch (const std::exception& /*e*/)
+  {
+    US_WARN << "ServiceFactory threw an exception";
   }
-  return s;
 }
 
-void* ServiceReferenceBasePrivate::GetService(Module* module)
+InterfaceMapImpl ServiceReferenceBasePrivate::GetPrototypeService(Module* module, std::size_t& slot)
 {
-  void* s = NULL;
+  InterfaceMapImpl s;
+  slot = ServiceRegistrationBasePrivate::NO_SLOT;
   {
-    MutexLock lock(registration->propsLock);
-    if (registration->available)
-    {
-      ServiceFactory* serviceFactory = reinterpret_cast<ServiceFactory*>(
-            registration->GetService("org.cppmicroservices.factory"));
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    if (!registration->available.Load()) return s;
 
-      const int count = registration->dependents[module];
-      if (count == 0)
-      {
-        if (serviceFactory)
-        {
-          const InterfaceMap im = GetServiceFromFactory(module, serviceFactory, true);
-          s = im.find(interfaceId)->second;
-        }
-        else
-        {
-          s = registration->GetService(interfaceId);
-        }
-      }
-      else
+    ServiceRegistrationBasePrivate::ModuleToServicesMap::iterator pool =
+        registration->pooledServiceInstances.find(module);
+    if (pool != registration->pooledServiceInstances.end())
+    {
+      s = pool->second.back();
+      pool->second.pop_back();
+      if (pool->second.empty())
       {
-        if (serviceFactory)
-        {
-          // return the already produced instance
-          s = registration->moduleServiceInstance[module][interfaceId];
-        }
-        else
-        {
-          s = registration->GetService(interfaceId);
-        }
+        registration->pooledServiceInstances.erase(pool);
       }
+      ++registration->poolStatistics.reused;
+      --registration->poolStatistics.idle;
+      slot = registration->AddPrototypeService(module, s);
+      return s;
+    }
+  }
 
-      if (s)
-      {
-        registration->dependents[module] = count + 1;
-      }
+  // every call creates a new instance, so no reservation is needed
+  s = GetServiceFromFactory(module, registration->factory);
+  if (s.Empty()) return s;
+
+  {
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    ++registration->poolStatistics.created;
+    if (registration->available.Load())
+    {
+      slot = registration->AddPrototypeService(module, s);
+      return s;
     }
   }
-  return s;
+
+  // the service was unregistered while the factory was called
+  UngetServiceFromFactory(module, s);
+  return InterfaceMapImpl();
 }
 
-InterfaceMap ServiceReferenceBasePrivate::GetServiceInterfaceMap(Module* module)
+InterfaceMapImpl ServiceReferenceBasePrivate::GetModuleService(Module* module)
 {
-  InterfaceMap s;
   {
-    MutexLock lock(registration->propsLock);
-    if (registration->available)
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    for (;;)
     {
-      ServiceFactory* serviceFactory = reinterpret_cast<ServiceFactory*>(
-            registration->GetService("org.cppmicroservices.factory"));
+      if (!registration->available.Load()) return InterfaceMapImpl();
 
-      const int count = registration->dependents[module];
-      if (count == 0)
+      ServiceRegistrationBasePrivate::ModuleToRefsMap::iterator count =
+          registration->dependents.find(module);
+      if (count != registration->dependents.end())
       {
-        if (serviceFactory)
-        {
-          s = GetServiceFromFactory(module, serviceFactory, true);
-        }
-        else
-        {
-          s = registration->service;
-        }
+        // return the already produced instance
+        ++count->second;
+        return registration->moduleServiceInstance[module];
       }
-      else
+
+      ServiceRegistrationBasePrivate::ModuleToThreadMap::const_iterator pending =
+          registration->pendingModuleServices.find(module);
+      if (pending == registration->pendingModuleServices.end())
       {
-        if (serviceFactory)
-        {
-          // return the already produced instance
-          s = registration->moduleServiceInstance[module];
-        }
-        else
-        {
-          s = registration->service;
-        }
+        break;
       }
-
-      if (!s.empty())
+      if (pending->second == ThreadId::Current())
       {
-        registration->dependents[module] = count + 1;
+        // waiting for our own factory call would never return
+        US_WARN << "ServiceFactory::GetService() recursively requested its own service "
+                   "for module " << module->GetName() << " (factory recursion)";
+        return InterfaceMapImpl();
       }
+      // another thread is calling the factory for this module
+      registration->propsLock.Wait();
+    }
+    // reserve the factory call for this module
+    registration->pendingModuleServices.insert(std::make_pair(module, ThreadId::Current()));
+  }
+
+  InterfaceMapImpl s = GetServiceFromFactory(module, registration->factory);
+
+  bool available = false;
+  {
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    registration->pendingModuleServices.erase(module);
+    available = registration->available.Load();
+    if (available && !s.Empty())
+    {
+      registration->moduleServiceInstance.insert(std::make_pair(module, s));
+      registration->dependents[module] = 1;
     }
+    registration->propsLock.NotifyAll();
+  }
+
+  if (!available && !s.Empty())
+  {
+    // the service was unregistered while the factory was called
+    UngetServiceFromFactory(module, s);
+    s = InterfaceMapImpl();
   }
   return s;
 }
 
-bool ServiceReferenceBasePrivate::UngetPrototypeService(Module* module, const InterfaceMap& service)
+void* ServiceReferenceBasePrivate::GetService(Module* module)
+{
+  if (registration->factory == NULL)
+  {
+    return GetSingletonService(module);
+  }
+  return GetModuleService(module).Find(interfaceKey);
+}
+
+void* ServiceReferenceBasePrivate::GetSingletonService(Module* module)
 {
-  MutexLock lock(registration->propsLock);
+  // The service object of a singleton never changes, so after the
+  // first use only the use count of the module needs to be updated.
+  ServiceRegistrationBasePrivate::ModuleUseCount* useCount = registration->FindUseCount(module);
+  void* s = cachedService.Load();
+  if (s == NULL || useCount == NULL)
+  {
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    if (!registration->available.Load()) return NULL;
+    s = registration->GetService(interfaceKey);
+    if (s == NULL) return NULL;
+    cachedService.Store(s);
+    useCount = registration->GetUseCount(module);
+  }
 
-  ServiceRegistrationBasePrivate::ModuleToServicesMap::iterator iter =
-      registration->prototypeServiceInstances.find(module);
-  if (iter == registration->prototypeServiceInstances.end())
+  useCount->count.AtomicIncrement();
+  // the increment and the store in Unregister() which clears the flag are
+  // sequentially consistent, so a concurrent Unregister() either resets
+  // the new count or we see the service as unavailable
+  if (!registration->available.Load())
   {
-    return false;
+    // Unregister() may already have reset the count including our
+    // increment, so the count must not go below zero
+    useCount->count.AtomicDecrementIfPositive();
+    return NULL;
   }
+  return s;
+}
 
-  std::list<InterfaceMap>& prototypeServiceMaps = iter->second;
+InterfaceMapImpl ServiceReferenceBasePrivate::GetServiceInterfaceMap(Module* module)
+{
+  if (registration->factory != NULL)
+  {
+    return GetModuleService(module);
+  }
 
-  for (std::list<InterfaceMap>::iterator imIter = prototypeServiceMaps.begin();
-       imIter != prototypeServiceMaps.end(); ++imIter)
+  InterfaceMapImpl s;
+  ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+  US_UNUSED(lock);
+  if (registration->available.Load())
   {
-    if (service == *imIter)
+    s = registration->service;
+    if (!s.Empty())
     {
-      try
-      {
-        ServiceFactory* sf = reinterpret_cast<ServiceFactory*>(
-                               registration->GetService("org.cppmicroservices.factory"));
-        sf->UngetService(module, ServiceRegistrationBase(registration), service);
-      }
-      catch (const std::exception& /*e*/)
-      {
-        US_WARN << "ServiceFactory threw an exception";
-      }
-      prototypeServiceMaps.erase(imIter);
-      if (prototypeServiceMaps.empty())
-      {
-        registration->prototypeServiceInstances.erase(iter);
-      }
-      return true;
+      registration->GetUseCount(module)->count.AtomicIncrement();
+    }
+  }
+  return s;
+}
+
+bool ServiceReferenceBasePrivate::UngetPrototypeService(Module* module, std::size_t slot)
+{
+  InterfaceMapImpl service;
+  bool poolable = false;
+  {
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    service = registration->RemovePrototypeService(module, slot);
+    if (service.Empty())
+    {
+      return false;
     }
+    poolable = ReservePoolSlot();
   }
 
-  return false;
+  if (poolable)
+  {
+    PoolPrototypeService(module, service);
+  }
+  else
+  {
+    UngetServiceFromFactory(module, service);
+  }
+  return true;
 }
 
-bool ServiceReferenceBasePrivate::UngetService(Module* module, bool checkRefCounter)
+bool ServiceReferenceBasePrivate::ReservePoolSlot()
 {
-  MutexLock lock(registration->propsLock);
-  bool hadReferences = false;
-  bool removeService = false;
+  const Any poolSize = registration->GetProperties().Value(ServiceConstants::SERVICE_POOL_SIZE());
+  if (poolSize.TypeTag() != ANY_TYPE_INT) return false;
 
-  int count= registration->dependents[module];
-  if (count > 0)
+  ServicePoolStatistics& statistics = registration->poolStatistics;
+  if (dynamic_cast<PrototypeServiceFactory*>(registration->factory) == NULL ||
+      static_cast<int>(statistics.idle) >= any_cast<int>(poolSize))
+  {
+    ++statistics.discarded;
+    return false;
+  }
+  // counted as idle until it is known whether the object can be reset
+  ++statistics.idle;
+  return true;
+}
+
+void ServiceReferenceBasePrivate::PoolPrototypeService(Module* module, const InterfaceMapImpl& service)
+{
+  bool reset = false;
+  try
+  {
+    reset = static_cast<PrototypeServiceFactory*>(registration->factory)->ResetService(
+          module, ServiceRegistrationBase(registration), service.ToInterfaceMap());
+  }
+  catch (const std::exception& /*e*/)
   {
-    hadReferences = true;
+    US_WARN << "PrototypeServiceFactory threw an exception";
   }
 
-  if(checkRefCounter)
   {
-    if (count > 1)
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+    ServicePoolStatistics& statistics = registration->poolStatistics;
+    if (reset && registration->available.Load())
     {
-      registration->dependents[module] = count - 1;
+      registration->pooledServiceInstances[module].push_back(service);
+      ++statistics.recycled;
+      return;
     }
-    else if(count == 1)
+    if (registration->available.Load())
     {
-      removeService = true;
+      --statistics.idle;
+      ++statistics.discarded;
     }
   }
-  else
+
+  UngetServiceFromFactory(module, service);
+}
+
+bool ServiceReferenceBasePrivate::UngetService(Module* module, bool checkRefCounter)
+{
+  if (registration->factory == NULL)
   {
-    removeService = true;
+    ServiceRegistrationBasePrivate::ModuleUseCount* useCount = registration->FindUseCount(module);
+    if (useCount == NULL) return false;
+    if (!checkRefCounter)
+    {
+      return ServiceRegistrationBasePrivate::ResetUseCount(useCount) > 0;
+    }
+    // a negative result means the module did not use the service
+    const int count = static_cast<int>(useCount->count.AtomicDecrementIfPositive());
+    return count == 0;
   }
 
-  if (removeService)
+  InterfaceMapImpl sfi;
   {
-    InterfaceMap sfi = registration->moduleServiceInstance[module];
-    registration->moduleServiceInstance.erase(module);
-    if (!sfi.empty())
+    ServiceRegistrationBasePrivate::PropsMutex::Lock lock(registration->propsLock);
+    US_UNUSED(lock);
+
+    ServiceRegistrationBasePrivate::ModuleToRefsMap::iterator count =
+        registration->dependents.find(module);
+    if (count == registration->dependents.end())
     {
-      try
-      {
-        ServiceFactory* sf = reinterpret_cast<ServiceFactory*>(
-                               registration->GetService("org.cppmicroservices.factory"));
-        sf->UngetService(module, ServiceRegistrationBase(registration), sfi);
-      }
-      catch (const std::exception& /*e*/)
-      {
-        US_WARN << "ServiceFactory threw an exception";
-      }
+      return false;
     }
-    registration->dependents.erase(module);
+
+    if (checkRefCounter && count->second > 1)
+    {
+      --count->second;
+      return false;
+    }
+
+    ServiceRegistrationBasePrivate::ModuleToServiceMap::iterator instance =
+        registration->moduleServiceInstance.find(module);
+    if (instance != registration->moduleServiceInstance.end())
+    {
+      sfi = instance->second;
+      registration->moduleServiceInstance.erase(instance);
+    }
+    registration->dependents.erase(count);
   }
 
-  return hadReferences && removeService;
+  if (!sfi.Empty())
+  {
+    UngetServiceFromFactory(module, sfi);
+  }
+  return true;
 }
 
-const ServicePropertiesImpl& ServiceReferenceBasePrivate::GetProperties() const
+ServicePropertiesImpl ServiceReferenceBasePrivate::GetProperties() const
 {
-  return registration->properties;
+  return registration->GetProperties();
 }
 
-Any ServiceReferenceBasePrivate::GetProperty(const std::string& key, bool lock) const
+Any ServiceReferenceBasePrivate::GetProperty(const std::string& key) const
 {
-  if (lock)
-  {
-    MutexLock lock(registration->propsLock);
-    return registration->properties.Value(key);
-  }
-  else
-  {
-    return registration->properties.Value(key);
-  }
+  return registration->GetProperties().Value(key);
 }
 
 bool ServiceReferenceBasePrivate::IsConvertibleTo(const std::string& interfaceId) const
 {
-  return registration ? registration->service.find(interfaceId) != registration->service.end() : false;
+  return registration ? registration->service.Contains(interfaceId) : false;
 }
 
 US_END_NAMESPACE
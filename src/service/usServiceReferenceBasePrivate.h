@@ -24,7 +24,8 @@
 #define USSERVICEREFERENCEBASEPRIVATE_H
 
 #include "usAtomicInt_p.h"
-
+#include "usServiceInterface.h"
+#include "usInterfaceMapImpl_p.h"
 #include "usServiceInterface.h"
 
 #include <string>
@@ -57,15 +58,17 @@ public:
     */
   void* GetService(Module* module);
 
-  InterfaceMap GetServiceInterfaceMap(Module* module);
+  InterfaceMapImpl GetServiceInterfaceMap(Module* module);
 
   /**
     * Get new service instance.
     *
     * @param module requester of service.
+    * @param slot Set to the slot of the new instance, which identifies
+    *        it in UngetPrototypeService().
     * @return Service requested or null in case of failure.
     */
-  InterfaceMap GetPrototypeService(Module* module);
+  InterfaceMapImpl GetPrototypeService(Module* module, std::size_t& slot);
 
   /**
    * Unget the service object.
@@ -83,20 +86,19 @@ public:
    * Unget prototype scope service objects.
    *
    * @param module Module who wants to remove a prototype scope service.
-   * @param service The prototype scope service pointer.
+   * @param slot The slot of the prototype scope service, as returned by
+   *        GetPrototypeService().
    * @return \c true if the service was removed, \c false otherwise.
    */
-  bool UngetPrototypeService(Module* module, void* service);
-
-  bool UngetPrototypeService(Module* module, const InterfaceMap& service);
+  bool UngetPrototypeService(Module* module, std::size_t slot);
 
   /**
    * Get all properties registered with this service.
    *
-   * @return A ServiceProperties object containing properties or being empty
-   *         if service has been removed.
+   * @return A snapshot of the service properties which is not affected
+   *         by later property updates.
    */
-  const ServicePropertiesImpl& GetProperties() const;
+  ServicePropertiesImpl GetProperties() const;
 
   /**
    * Returns the property value to which the specified property key is mapped
@@ -112,13 +114,10 @@ public:
    * still be interrogated.
    *
    * @param key The property key.
-   * @param lock If <code>true</code>, access of the properties of the service
-   * referenced by this <code>ServiceReference</code> object will be
-   * synchronized.
    * @return The property value to which the key is mapped; an invalid Any
    * if there is no property named after the key.
    */
-  Any GetProperty(const std::string& key, bool lock) const;
+  Any GetProperty(const std::string& key) const;
 
   bool IsConvertibleTo(const std::string& interfaceId) const;
 
@@ -137,10 +136,54 @@ public:
    */
   std::string interfaceId;
 
+  /**
+   * The interned id of interfaceId, or -1 if interfaceId is empty.
+   */
+  int interfaceKey;
+
+  /**
+   * The service object for interfaceId of a service with singleton
+   * scope, or NULL if it was not looked up yet. Must be reset when
+   * interfaceId changes. Loaded without a lock, the acquire load pairs
+   * with the release store after the lookup.
+   */
+  AtomicPointer<void> cachedService;
+
 private:
 
-  InterfaceMap GetServiceFromFactory(Module* module, ServiceFactory* factory,
-                                     bool isModuleScope);
+  void* GetSingletonService(Module* module);
+
+  /**
+   * Returns the module scope object instance of a service registered with
+   * a ServiceFactory, calling the factory if the module does not use the
+   * service yet. The factory is called without holding any lock. Concurrent
+   * calls for the same module wait until the first call produced the
+   * instance.
+   */
+  InterfaceMapImpl GetModuleService(Module* module);
+
+  /**
+   * Reserves room in the instance pool for a released prototype scope
+   * service object. Must be called with propsLock held.
+   *
+   * @return \c true if the object should be passed to PoolPrototypeService(),
+   *         \c false if it must be returned to the factory.
+   */
+  bool ReservePoolSlot();
+
+  /**
+   * Resets a released prototype scope service object and puts it into
+   * the pool reserved by ReservePoolSlot(), or returns it to the factory
+   * if it cannot be reset. Must be called without holding propsLock.
+   */
+  void PoolPrototypeService(Module* module, const InterfaceMapImpl& service);
+
+  /**
+   * Calls the factory without holding any lock.
+   */
+  InterfaceMapImpl GetServiceFromFactory(Module* module, ServiceFactory* factory);
+
+  void UngetServiceFromFactory(Module* module, const InterfaceMapImpl& service);
 
   // purposely not implemented
   ServiceReferenceBasePrivate(const ServiceReferenceBasePrivate&);
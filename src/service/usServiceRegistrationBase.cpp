@@ -23,6 +23,7 @@
 
 #include "usServiceRegistrationBase.h"
 #include "usServiceRegistrationBasePrivate.h"
+#include "usServiceExecutor_p.h"
 #include "usServiceListenerEntry_p.h"
 #include "usServiceRegistry_p.h"
 #include "usServiceFactory.h"
@@ -34,6 +35,71 @@
 
 US_BEGIN_NAMESPACE
 
+namespace {
+
+typedef std::vector<std::pair<Module*, InterfaceMapImpl> > ServiceInstances;
+
+class UngetServiceTask : public ServiceTask
+{
+
+public:
+
+  UngetServiceTask(ServiceFactory* factory, const ServiceRegistrationBase& registration,
+                   Module* module, const InterfaceMapImpl& service, ServiceFuturePrivate* future)
+    : m_factory(factory), m_registration(registration), m_module(module),
+      m_service(service), m_future(future)
+  {
+    m_future->ref.Ref();
+  }
+
+  ~UngetServiceTask()
+  {
+    if (!m_future->ref.Deref())
+      delete m_future;
+  }
+
+  void Run()
+  {
+    try
+    {
+      m_factory->UngetService(m_module, m_registration, m_service.ToInterfaceMap());
+    }
+    catch (const std::exception& /*ue*/)
+    {
+      US_WARN << "ServiceFactory UngetService implementation threw an exception";
+    }
+    m_future->Done();
+  }
+
+private:
+
+  ServiceFactory* const m_factory;
+  const ServiceRegistrationBase m_registration;
+  Module* const m_module;
+  const InterfaceMapImpl m_service;
+  ServiceFuturePrivate* const m_future;
+
+  // purposely not implemented
+  UngetServiceTask(const UngetServiceTask&);
+  UngetServiceTask& operator=(const UngetServiceTask&);
+};
+
+void AddServiceInstances(const ServiceRegistrationBasePrivate::ModuleToServicesMap& services,
+                         ServiceInstances& instances)
+{
+  for (ServiceRegistrationBasePrivate::ModuleToServicesMap::const_iterator i = services.begin();
+       i != services.end(); ++i)
+  {
+    for (std::list<InterfaceMapImpl>::const_iterator listIter = i->second.begin();
+         listIter != i->second.end(); ++listIter)
+    {
+      instances.push_back(std::make_pair(i->first, *listIter));
+    }
+  }
+}
+
+}
+
 ServiceRegistrationBase::ServiceRegistrationBase()
   : d(0)
 {
@@ -86,7 +152,7 @@ ServiceRegistrationBase::~ServiceRegistrationBase()
 ServiceReferenceBase ServiceRegistrationBase::GetReference(const std::string& interfaceId) const
 {
   if (!d) throw std::logic_error("ServiceRegistrationBase object invalid");
-  if (!d->available) throw std::logic_error("Service is unregistered");
+  if (!d->available.Load()) throw std::logic_error("Service is unregistered");
 
   ServiceReferenceBase ref = d->reference;
   ref.SetInterfaceId(interfaceId);
@@ -98,49 +164,67 @@ void ServiceRegistrationBase::SetProperties(const ServiceProperties& props)
   if (!d) throw std::logic_error("ServiceRegistrationBase object invalid");
 
   MutexLock lock(d->eventLock);
+  if (!d->available.Load()) throw std::logic_error("Service is unregistered");
+
+  // writers are serialized by the event lock, so the
+  // current properties cannot change until we are done
+  const ServicePropertiesImpl oldProps = d->GetProperties();
+  const std::vector<std::string>& classes =
+      ref_any_cast<std::vector<std::string> >(oldProps.Value(PropertyKeys::KEY_OBJECTCLASS));
+  const long int sid = any_cast<long int>(oldProps.Value(PropertyKeys::KEY_SERVICE_ID));
+  const Any& scope = oldProps.Value(PropertyKeys::KEY_SERVICE_SCOPE);
+  const bool isPrototypeFactory = scope.Type() == typeid(std::string) &&
+      ref_any_cast<std::string>(scope) == ServiceConstants::SCOPE_PROTOTYPE();
+  const bool isFactory = isPrototypeFactory || (scope.Type() == typeid(std::string) &&
+      ref_any_cast<std::string>(scope) == ServiceConstants::SCOPE_MODULE());
+
+  PublishProperties(oldProps, ServiceRegistry::CreateServiceProperties(
+                      props, classes, isFactory, isPrototypeFactory, sid));
+}
 
-  ServiceEvent modifiedEndMatchEvent(ServiceEvent::MODIFIED_ENDMATCH, d->reference);
-  ServiceListeners::ServiceListenerEntries before;
-  // TBD, optimize the locking of services
-  {
-    //MutexLock lock2(d->module->coreCtx->globalFwLock);
+void ServiceRegistrationBase::UpdateProperties(const ServiceProperties& props,
+                                               const std::vector<std::string>& removedKeys)
+{
+  if (!d) throw std::logic_error("ServiceRegistrationBase object invalid");
 
-    if (d->available)
-    {
-      // NYI! Optimize the MODIFIED_ENDMATCH code
-      int old_rank = 0;
-      int new_rank = 0;
+  MutexLock lock(d->eventLock);
+  if (!d->available.Load()) throw std::logic_error("Service is unregistered");
 
-      std::vector<std::string> classes;
-      {
-        MutexLock lock3(d->propsLock);
+  const ServicePropertiesImpl oldProps = d->GetProperties();
+  PublishProperties(oldProps, ServicePropertiesImpl(oldProps, props, removedKeys));
+}
 
-        {
-          const Any& any = d->properties.Value(ServiceConstants::SERVICE_RANKING());
-          if (any.Type() == typeid(int)) old_rank = any_cast<int>(any);
-        }
+void ServiceRegistrationBase::PublishProperties(const ServicePropertiesImpl& oldProps,
+                                                const ServicePropertiesImpl& newProps)
+{
+  ServiceEvent modifiedEndMatchEvent(ServiceEvent::MODIFIED_ENDMATCH, d->reference);
+  ServiceListeners::ServiceListenerEntries before;
+  d->module->coreCtx->listeners.GetMatchingServiceListeners(modifiedEndMatchEvent, before);
 
-        d->module->coreCtx->listeners.GetMatchingServiceListeners(modifiedEndMatchEvent, before, false);
-        classes = ref_any_cast<std::vector<std::string> >(d->properties.Value(ServiceConstants::OBJECTCLASS()));
-        long int sid = any_cast<long int>(d->properties.Value(ServiceConstants::SERVICE_ID()));
-        d->properties = ServiceRegistry::CreateServiceProperties(props, classes, false, false, sid);
+  d->SetProperties(newProps);
 
-        {
-          const Any& any = d->properties.Value(ServiceConstants::SERVICE_RANKING());
-          if (any.Type() == typeid(int)) new_rank = any_cast<int>(any);
-        }
-      }
+  int old_rank = 0;
+  int new_rank = 0;
+  {
+    const Any& any = oldProps.Value(PropertyKeys::KEY_SERVICE_RANKING);
+    if (any.TypeTag() == ANY_TYPE_INT) old_rank = any_cast<int>(any);
+  }
+  {
+    const Any& any = newProps.Value(PropertyKeys::KEY_SERVICE_RANKING);
+    if (any.TypeTag() == ANY_TYPE_INT) new_rank = any_cast<int>(any);
+  }
 
-      if (old_rank != new_rank)
-      {
-        d->module->coreCtx->services.UpdateServiceRegistrationOrder(*this, classes);
-      }
-    }
-    else
-    {
-      throw std::logic_error("Service is unregistered");
-    }
+  const std::vector<std::string>& classes =
+      ref_any_cast<std::vector<std::string> >(newProps.Value(PropertyKeys::KEY_OBJECTCLASS));
+  if (old_rank != new_rank)
+  {
+    d->module->coreCtx->services.UpdateServiceRegistrationOrder(*this, classes);
   }
+  else
+  {
+    d->module->coreCtx->services.Modified(classes);
+  }
+
   ServiceEvent modifiedEvent(ServiceEvent::MODIFIED, d->reference);
   ServiceListeners::ServiceListenerEntries matchingListeners;
   d->module->coreCtx->listeners.GetMatchingServiceListeners(modifiedEvent, matchingListeners);
@@ -153,17 +237,24 @@ void ServiceRegistrationBase::SetProperties(const ServiceProperties& props)
 }
 
 void ServiceRegistrationBase::Unregister()
+{
+  Unregister(NULL);
+}
+
+ServiceFuture ServiceRegistrationBase::Unregister(ServiceExecutor* executor)
 {
   if (!d) throw std::logic_error("ServiceRegistrationBase object invalid");
 
-  if (d->unregistering) return; // Silently ignore redundant unregistration.
+  if (d->unregistering.Load()) return ServiceFuture(); // Silently ignore redundant unregistration.
   {
     MutexLock lock(d->eventLock);
-    if (d->unregistering) return;
-    d->unregistering = true;
+    if (d->unregistering.Load()) return ServiceFuture();
+    d->unregistering.Store(true);
 
-    if (d->available)
+    if (d->available.Load())
     {
+      // invalidate all service handles
+      d->generation.Ref();
       if (d->module)
       {
         d->module->coreCtx->services.RemoveServiceRegistration(*this);
@@ -185,65 +276,77 @@ void ServiceRegistrationBase::Unregister()
           unregisteringEvent);
   }
 
+  ServiceInstances instances;
   {
     MutexLock lock(d->eventLock);
     {
-      MutexLock lock2(d->propsLock);
-      d->available = false;
-      InterfaceMap::const_iterator factoryIter = d->service.find("org.cppmicroservices.factory");
-      if (d->module && factoryIter != d->service.end())
+      ServiceRegistrationBasePrivate::PropsMutex::Lock lock2(d->propsLock);
+      US_UNUSED(lock2);
+      d->available.Store(false);
+      if (d->module && d->factory)
       {
-        ServiceFactory* serviceFactory = reinterpret_cast<ServiceFactory*>(factoryIter->second);
-        ServiceRegistrationBasePrivate::ModuleToServicesMap::const_iterator end = d->prototypeServiceInstances.end();
-
-        // unget all prototype services
-        for (ServiceRegistrationBasePrivate::ModuleToServicesMap::const_iterator i = d->prototypeServiceInstances.begin();
-             i != end; ++i)
+        // collect all prototype services, including the pooled ones, and
+        // the module scope services, to unget them without holding a lock
+        for (std::vector<ServiceRegistrationBasePrivate::PrototypeServiceSlot>::const_iterator i = d->prototypeServiceSlots.begin();
+             i != d->prototypeServiceSlots.end(); ++i)
         {
-          for (std::list<InterfaceMap>::const_iterator listIter = i->second.begin();
-               listIter != i->second.end(); ++listIter)
-          {
-            const InterfaceMap& service = *listIter;
-            try
-            {
-              // NYI, don't call inside lock
-              serviceFactory->UngetService(i->first, *this, service);
-            }
-            catch (const std::exception& /*ue*/)
-            {
-              US_WARN << "ServiceFactory UngetService implementation threw an exception";
-            }
-          }
+          if (i->module != NULL) instances.push_back(std::make_pair(i->module, i->service));
         }
-
-        // unget module scope services
-        ServiceRegistrationBasePrivate::ModuleToServiceMap::const_iterator moduleEnd = d->moduleServiceInstance.end();
+        AddServiceInstances(d->pooledServiceInstances, instances);
         for (ServiceRegistrationBasePrivate::ModuleToServiceMap::const_iterator i = d->moduleServiceInstance.begin();
-             i != moduleEnd; ++i)
+             i != d->moduleServiceInstance.end(); ++i)
         {
-          try
-          {
-            // NYI, don't call inside lock
-            serviceFactory->UngetService(i->first, *this, i->second);
-          }
-          catch (const std::exception& /*ue*/)
-          {
-            US_WARN << "ServiceFactory UngetService implementation threw an exception";
-          }
+          instances.push_back(*i);
         }
       }
       d->module = 0;
       d->dependents.clear();
-      d->service.clear();
-      d->prototypeServiceInstances.clear();
+      for (ServiceRegistrationBasePrivate::ModuleUseCount* useCount = d->useCounts.Load();
+           useCount; useCount = useCount->next)
+      {
+        ServiceRegistrationBasePrivate::ResetUseCount(useCount);
+      }
+      d->service = InterfaceMapImpl();
+      d->prototypeServiceSlots.clear();
+      d->freePrototypeSlot = ServiceRegistrationBasePrivate::NO_SLOT;
+      d->prototypeServiceCounts.clear();
+      d->pooledServiceInstances.clear();
+      d->poolStatistics.idle = 0;
       d->moduleServiceInstance.clear();
       // increment the reference count, since "d->reference" was used originally
       // to keep d alive.
       d->ref.Ref();
       d->reference = 0;
-      d->unregistering = false;
+      d->unregistering.Store(false);
     }
   }
+
+  if (instances.empty()) return ServiceFuture();
+
+  ServiceFuture future(new ServiceFuturePrivate(instances.size()));
+  for (ServiceInstances::const_iterator i = instances.begin(); i != instances.end(); ++i)
+  {
+    UngetServiceTask* task = new UngetServiceTask(d->factory, *this, i->first, i->second, future.d);
+    if (executor)
+    {
+      executor->Execute(task);
+    }
+    else
+    {
+      task->Run();
+      delete task;
+    }
+  }
+  return future;
+}
+
+ServicePoolStatistics ServiceRegistrationBase::GetPoolStatistics() const
+{
+  if (!d) throw std::logic_error("ServiceRegistrationBase object invalid");
+
+  ServiceRegistrationBasePrivate::PropsMutex::Lock lock(d->propsLock);
+  US_UNUSED(lock);
+  return d->poolStatistics;
 }
 
 bool ServiceRegistrationBase::operator<(const ServiceRegistrationBase& o) const
@@ -24,6 +24,7 @@
 
 #include "usServiceProperties.h"
 #include "usServiceReference.h"
+#include "usServiceExecutor.h"
 
 US_MSVC_PUSH_DISABLE_WARNING(4396)
 
@@ -33,6 +34,32 @@ class ModulePrivate;
 class ServiceRegistrationBasePrivate;
 class ServicePropertiesImpl;
 
+/**
+ * \ingroup MicroServices
+ *
+ * Statistics of the instance pool of a prototype scope service.
+ *
+ * @see ServiceConstants::SERVICE_POOL_SIZE()
+ * @see ServiceRegistrationBase::GetPoolStatistics()
+ */
+struct ServicePoolStatistics
+{
+  ServicePoolStatistics()
+    : created(0), reused(0), recycled(0), discarded(0), idle(0)
+  {}
+
+  /** Number of service objects the factory created for ServiceObjects. */
+  std::size_t created;
+  /** Number of ServiceObjects::GetService() calls served from the pool. */
+  std::size_t reused;
+  /** Number of released service objects which were put into the pool. */
+  std::size_t recycled;
+  /** Number of released service objects which did not fit into the pool. */
+  std::size_t discarded;
+  /** Number of service objects currently in the pool. */
+  std::size_t idle;
+};
+
 /**
  * \ingroup MicroServices
  *
@@ -128,6 +155,33 @@ public:
    */
   void SetProperties(const ServiceProperties& properties);
 
+  /**
+   * Modifies some of the properties associated with a service.
+   *
+   * <p>
+   * Unlike SetProperties(), this method keeps all properties which are
+   * neither contained in <code>properties</code> nor in <code>removedKeys</code>.
+   * Keys are compared case insensitively, so a key in <code>properties</code>
+   * replaces an existing case variant. The ServiceConstants#OBJECTCLASS,
+   * ServiceConstants#SERVICE_ID and ServiceConstants#SERVICE_SCOPE keys
+   * cannot be modified or removed by this method.
+   *
+   * <p>
+   * The new properties are published as a whole. Readers either see the
+   * properties before or after the update, never a mix of both. A service
+   * event of type ServiceEvent#MODIFIED is fired afterwards.
+   *
+   * @param properties The properties to add or replace.
+   * @param removedKeys The keys of the properties to remove.
+   *
+   * @throws std::logic_error If this <code>ServiceRegistrationBase</code>
+   *         object has already been unregistered or if it is invalid.
+   * @throws std::runtime_error If <code>properties</code> contains
+   *         case variants of the same key name.
+   */
+  void UpdateProperties(const ServiceProperties& properties,
+                        const std::vector<std::string>& removedKeys = std::vector<std::string>());
+
   /**
    * Unregisters a service. Remove a <code>ServiceRegistrationBase</code> object
    * from the framework service registry. All <code>ServiceRegistrationBase</code>
@@ -161,6 +215,39 @@ public:
    */
   void Unregister();
 
+  /**
+   * Unregisters a service like Unregister(), but hands the release of the
+   * service objects produced by a ServiceFactory to an executor.
+   *
+   * <p>
+   * The service is unavailable when this method returns. Each module scope
+   * or prototype scope service object which has to be released by calling
+   * <code>ServiceFactory#UngetService</code> is passed to \c executor as a
+   * separate task, so an executor with several threads releases them in
+   * parallel. The factory must stay valid until the returned future is done.
+   *
+   * @param executor The executor running the release tasks, or NULL to
+   *        release the service objects on the calling thread.
+   * @return A future which is done when all service objects have been
+   *         released.
+   *
+   * @throws std::logic_error If this
+   *         <code>ServiceRegistrationBase</code> object has already been
+   *         unregistered or if it is invalid.
+   * @see Unregister()
+   */
+  ServiceFuture Unregister(ServiceExecutor* executor);
+
+  /**
+   * Returns the statistics of the instance pool of this service. All
+   * values are zero if the service has no instance pool.
+   *
+   * @throws std::logic_error If this <code>ServiceRegistrationBase</code>
+   *         object is invalid.
+   * @see ServiceConstants#SERVICE_POOL_SIZE
+   */
+  ServicePoolStatistics GetPoolStatistics() const;
+
   /**
    * Compare two ServiceRegistrationBase objects.
    *
@@ -200,6 +287,13 @@ private:
   ServiceRegistrationBase(ModulePrivate* module, const InterfaceMap& service,
                           const ServicePropertiesImpl& props);
 
+  /**
+   * Publishes new properties and fires the MODIFIED events. The
+   * event lock must be held by the caller.
+   */
+  void PublishProperties(const ServicePropertiesImpl& oldProps,
+                         const ServicePropertiesImpl& newProps);
+
   ServiceRegistrationBasePrivate* d;
 
 };
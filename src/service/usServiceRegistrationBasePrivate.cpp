@@ -21,6 +21,8 @@
 
 #include "usServiceRegistrationBasePrivate.h"
 
+#include <algorithm>
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable:4355)
@@ -28,47 +30,152 @@
 
 US_BEGIN_NAMESPACE
 
+namespace {
+
+ServiceFactory* GetFactory(const InterfaceMap& service)
+{
+  InterfaceMap::const_iterator iter = service.find("org.cppmicroservices.factory");
+  return iter != service.end() ? reinterpret_cast<ServiceFactory*>(iter->second) : NULL;
+}
+
+}
+
+const std::size_t ServiceRegistrationBasePrivate::NO_SLOT = static_cast<std::size_t>(-1);
+
 ServiceRegistrationBasePrivate::ServiceRegistrationBasePrivate(
   ModulePrivate* module, const InterfaceMap& service,
   const ServicePropertiesImpl& props)
-  : ref(0), service(service), module(module), reference(this),
-    properties(props), available(true), unregistering(false)
+  : ref(0), service(service), useCounts(), freePrototypeSlot(NO_SLOT), module(module),
+    factory(GetFactory(service)), reference(this),
+    available(true), unregistering(false)
 {
   // The reference counter is initialized to 0 because it will be
   // incremented by the "reference" member.
+  eventLock.SetName("ServiceRegistration::eventLock");
+  propsLock.SetLockName("ServiceRegistration::propsLock");
+  properties.Store(new PublishedProperties(props));
 }
 
 ServiceRegistrationBasePrivate::~ServiceRegistrationBasePrivate()
 {
-
+  ModuleUseCount* useCount = useCounts.Load();
+  while (useCount)
+  {
+    ModuleUseCount* next = useCount->next;
+    delete useCount;
+    useCount = next;
+  }
 }
 
 bool ServiceRegistrationBasePrivate::IsUsedByModule(Module* p) const
 {
+  const ModuleUseCount* useCount = FindUseCount(p);
   return (dependents.find(p) != dependents.end()) ||
-      (prototypeServiceInstances.find(p) != prototypeServiceInstances.end());
+      (prototypeServiceCounts.find(p) != prototypeServiceCounts.end()) ||
+      (useCount && UseCount(useCount) > 0);
 }
 
-const InterfaceMap& ServiceRegistrationBasePrivate::GetInterfaces() const
+const InterfaceMapImpl& ServiceRegistrationBasePrivate::GetInterfaces() const
 {
   return service;
 }
 
-void* ServiceRegistrationBasePrivate::GetService(const std::string& interfaceId) const
+void* ServiceRegistrationBasePrivate::GetService(int interfaceKey) const
 {
-  if (interfaceId.empty() && service.size() > 0)
+  if (interfaceKey < 0)
   {
-    return service.begin()->second;
+    return service.Front();
   }
+  return service.Find(interfaceKey);
+}
 
-  InterfaceMap::const_iterator iter = service.find(interfaceId);
-  if (iter != service.end())
+ServiceRegistrationBasePrivate::ModuleUseCount* ServiceRegistrationBasePrivate::FindUseCount(Module* m) const
+{
+  for (ModuleUseCount* useCount = useCounts.Load(); useCount; useCount = useCount->next)
   {
-    return iter->second;
+    if (useCount->module == m) return useCount;
   }
   return NULL;
 }
 
+ServiceRegistrationBasePrivate::ModuleUseCount* ServiceRegistrationBasePrivate::GetUseCount(Module* m)
+{
+  ModuleUseCount* useCount = FindUseCount(m);
+  if (!useCount)
+  {
+    useCount = new ModuleUseCount(m, useCounts.Load());
+    useCounts.Store(useCount);
+  }
+  return useCount;
+}
+
+int ServiceRegistrationBasePrivate::UseCount(const ModuleUseCount* useCount)
+{
+  return static_cast<int>(useCount->count.Load());
+}
+
+int ServiceRegistrationBasePrivate::ResetUseCount(ModuleUseCount* useCount)
+{
+  // the count may include the increment of a concurrent
+  // GetSingletonService() which then sees the service as unavailable
+  // and backs out without going below zero
+  return static_cast<int>(useCount->count.Exchange(0));
+}
+
+ServicePropertiesImpl ServiceRegistrationBasePrivate::GetProperties() const
+{
+  ExplicitlySharedDataPointer<const PublishedProperties> published;
+  properties.Load(published);
+  return published->properties;
+}
+
+std::size_t ServiceRegistrationBasePrivate::AddPrototypeService(Module* m, const InterfaceMapImpl& service)
+{
+  std::size_t slot = freePrototypeSlot;
+  if (slot != NO_SLOT)
+  {
+    freePrototypeSlot = prototypeServiceSlots[slot].nextFree;
+  }
+  else
+  {
+    slot = prototypeServiceSlots.size();
+    prototypeServiceSlots.push_back(PrototypeServiceSlot());
+  }
+
+  PrototypeServiceSlot& prototypeSlot = prototypeServiceSlots[slot];
+  prototypeSlot.module = m;
+  prototypeSlot.service = service;
+  ++prototypeServiceCounts[m];
+  return slot;
+}
+
+InterfaceMapImpl ServiceRegistrationBasePrivate::RemovePrototypeService(Module* m, std::size_t slot)
+{
+  if (slot >= prototypeServiceSlots.size() || prototypeServiceSlots[slot].module != m)
+  {
+    return InterfaceMapImpl();
+  }
+
+  PrototypeServiceSlot& prototypeSlot = prototypeServiceSlots[slot];
+  InterfaceMapImpl service = prototypeSlot.service;
+  prototypeSlot.module = NULL;
+  prototypeSlot.service = InterfaceMapImpl();
+  prototypeSlot.nextFree = freePrototypeSlot;
+  freePrototypeSlot = slot;
+
+  ModuleToRefsMap::iterator count = prototypeServiceCounts.find(m);
+  if (--count->second == 0)
+  {
+    prototypeServiceCounts.erase(count);
+  }
+  return service;
+}
+
+void ServiceRegistrationBasePrivate::SetProperties(const ServicePropertiesImpl& props)
+{
+  properties.Store(new PublishedProperties(props));
+}
+
 US_END_NAMESPACE
 
 #ifdef _MSC_VER
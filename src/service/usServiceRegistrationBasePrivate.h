@@ -24,13 +24,16 @@
 #define USSERVICEREGISTRATIONBASEPRIVATE_H
 
 #include "usServiceInterface.h"
+#include "usInterfaceMapImpl_p.h"
 #include "usServiceReference.h"
+#include "usServiceRegistrationBase.h"
 #include "usServicePropertiesImpl_p.h"
 #include "usAtomicInt_p.h"
 
 US_BEGIN_NAMESPACE
 
 class ModulePrivate;
+class ServiceFactory;
 class ServiceRegistrationBase;
 
 /**
@@ -58,65 +61,150 @@ protected:
   /**
    * Service or ServiceFactory object.
    */
-  InterfaceMap service;
+  InterfaceMapImpl service;
 
 public:
 
   typedef US_UNORDERED_MAP_TYPE<Module*,int> ModuleToRefsMap;
-  typedef US_UNORDERED_MAP_TYPE<Module*, InterfaceMap> ModuleToServiceMap;
-  typedef US_UNORDERED_MAP_TYPE<Module*, std::list<InterfaceMap> > ModuleToServicesMap;
+  typedef US_UNORDERED_MAP_TYPE<Module*, InterfaceMapImpl> ModuleToServiceMap;
+  typedef US_UNORDERED_MAP_TYPE<Module*, std::list<InterfaceMapImpl> > ModuleToServicesMap;
+  typedef US_UNORDERED_MAP_TYPE<Module*, ThreadId> ModuleToThreadMap;
 
   /**
    * Modules dependent on this service. Integer is used as
    * reference counter, counting number of unbalanced getService().
+   * Only used for services registered with a ServiceFactory, see
+   * useCounts for services with singleton scope.
    */
   ModuleToRefsMap dependents;
 
   /**
-   * Object instances that a prototype factory has produced.
+   * The use count of a module for a service with singleton scope.
    */
-  ModuleToServicesMap prototypeServiceInstances;
+  struct ModuleUseCount
+  {
+    ModuleUseCount(Module* m, ModuleUseCount* n) : module(m), next(n) {}
+
+    Module* const module;
+    AtomicCounter count;
+    ModuleUseCount* const next;
+  };
+
+  /**
+   * Use counts of modules for a service with singleton scope. Nodes
+   * are only prepended, with propsLock held, and deleted together
+   * with this object, so the list can be searched without a lock. The
+   * release store of a new head publishes the complete node to the
+   * acquire loads of the readers.
+   */
+  AtomicPointer<ModuleUseCount> useCounts;
+
+  /**
+   * An object instance that a prototype factory has produced. The slots
+   * of released instances form a free list and are reused.
+   */
+  struct PrototypeServiceSlot
+  {
+    PrototypeServiceSlot() : module(NULL), nextFree(NO_SLOT) {}
+
+    // NULL if the slot is free
+    Module* module;
+    InterfaceMapImpl service;
+    std::size_t nextFree;
+  };
+
+  /**
+   * An invalid slot index.
+   */
+  static const std::size_t NO_SLOT;
+
+  /**
+   * Object instances that a prototype factory has produced, indexed by
+   * the slot returned from AddPrototypeService().
+   */
+  std::vector<PrototypeServiceSlot> prototypeServiceSlots;
+
+  /**
+   * First free slot in prototypeServiceSlots or NO_SLOT.
+   */
+  std::size_t freePrototypeSlot;
+
+  /**
+   * Number of prototype object instances held by each module.
+   */
+  ModuleToRefsMap prototypeServiceCounts;
+
+  /**
+   * Released prototype scope object instances of each module which are
+   * kept for reuse, see ServiceConstants::SERVICE_POOL_SIZE().
+   */
+  ModuleToServicesMap pooledServiceInstances;
+
+  ServicePoolStatistics poolStatistics;
 
   /**
    * Object instance with module scope that a factory may have produced.
    */
   ModuleToServiceMap moduleServiceInstance;
 
+  /**
+   * Modules for which a thread currently calls ServiceFactory::GetService()
+   * to produce the module scope object instance, mapped to that thread.
+   * Other threads getting the service for such a module wait on propsLock
+   * until the call finished, the calling thread itself gets no service.
+   */
+  ModuleToThreadMap pendingModuleServices;
+
   /**
    * Module registering this service.
    */
   ModulePrivate* module;
 
   /**
-   * Reference object to this service registration.
+   * The ServiceFactory of the service or NULL if the
+   * service has singleton scope.
    */
-  ServiceReferenceBase reference;
+  ServiceFactory* const factory;
 
   /**
-   * Service properties.
+   * Reference object to this service registration.
    */
-  ServicePropertiesImpl properties;
+  ServiceReferenceBase reference;
 
   /**
    * Is service available. I.e., if <code>true</code> then holders
    * of a ServiceReference for the service are allowed to get it.
+   * Read without holding propsLock by the GetService fast path.
    */
-  volatile bool available;
+  AtomicFlag available;
 
   /**
    * Avoid recursive unregistrations. I.e., if <code>true</code> then
    * unregistration of this service has started but is not yet
    * finished.
    */
-  volatile bool unregistering;
+  AtomicFlag unregistering;
+
+  /**
+   * Incremented when the service is unregistered, to invalidate
+   * ServiceHandle objects for the service.
+   */
+  AtomicInt generation;
 
   /**
    * Lock object for synchronous event delivery.
    */
   Mutex eventLock;
 
-  // needs to be recursive
-  Mutex propsLock;
+  typedef MultiThreaded<MutexLockingStrategy, WaitCondition> PropsMutex;
+
+  /**
+   * Guards the object instances produced by the factory, the use counts
+   * and the availability of the service. It is never held while calling
+   * the ServiceFactory, and it is notified when a pending factory call
+   * for a module finished.
+   */
+  PropsMutex propsLock;
 
   ServiceRegistrationBasePrivate(ModulePrivate* module, const InterfaceMap& service,
                                  const ServicePropertiesImpl& props);
@@ -131,12 +219,86 @@ public:
    */
   bool IsUsedByModule(Module* m) const;
 
-  const InterfaceMap& GetInterfaces() const;
+  const InterfaceMapImpl& GetInterfaces() const;
 
-  void* GetService(const std::string& interfaceId) const;
+  /**
+   * @param interfaceKey The interned interface id, or -1 for the service
+   *        object of the first interface.
+   */
+  void* GetService(int interfaceKey) const;
+
+  /**
+   * Searches the use count of a module without locking.
+   *
+   * @return The use count node of \c m or NULL if \c m never used the service.
+   */
+  ModuleUseCount* FindUseCount(Module* m) const;
+
+  /**
+   * Returns the use count node of a module, creating it if necessary.
+   * Must be called with propsLock held.
+   */
+  ModuleUseCount* GetUseCount(Module* m);
+
+  /**
+   * Returns the current value of a use count.
+   */
+  static int UseCount(const ModuleUseCount* useCount);
+
+  /**
+   * Sets a use count to zero.
+   *
+   * @return The previous value of the use count.
+   */
+  static int ResetUseCount(ModuleUseCount* useCount);
+
+  /**
+   * Returns the current service properties. The returned set is
+   * immutable and is not affected by later property updates, so it
+   * can be read without holding any lock.
+   */
+  ServicePropertiesImpl GetProperties() const;
+
+  /**
+   * Records a prototype object instance produced for a module. Must be
+   * called with propsLock held.
+   *
+   * @return The slot of the instance.
+   */
+  std::size_t AddPrototypeService(Module* m, const InterfaceMapImpl& service);
+
+  /**
+   * Removes a prototype object instance. Must be called with propsLock held.
+   *
+   * @return The removed instance or an empty map if \c slot does not
+   *         contain an instance of module \c m.
+   */
+  InterfaceMapImpl RemovePrototypeService(Module* m, std::size_t slot);
+
+  /**
+   * Replaces the service properties. Callers holding a set returned
+   * by GetProperties() keep seeing the previous properties. Must be
+   * called with eventLock held.
+   */
+  void SetProperties(const ServicePropertiesImpl& props);
 
 private:
 
+  /**
+   * A published property set.
+   */
+  struct PublishedProperties : public SharedData
+  {
+    explicit PublishedProperties(const ServicePropertiesImpl& props) : properties(props) {}
+    const ServicePropertiesImpl properties;
+  };
+
+  /**
+   * Service properties, loaded without a lock and replaced with
+   * eventLock held.
+   */
+  PublishedPointer<const PublishedProperties> properties;
+
   // purposely not implemented
   ServiceRegistrationBasePrivate(const ServiceRegistrationBasePrivate&);
   ServiceRegistrationBasePrivate& operator=(const ServiceRegistrationBasePrivate&);
@@ -31,6 +31,7 @@
 #include "usServiceRegistrationBasePrivate.h"
 #include "usModulePrivate.h"
 #include "usCoreModuleContext_p.h"
+#include "usServiceFindHook.h"
 
 
 US_BEGIN_NAMESPACE
@@ -63,13 +64,13 @@ ServicePropertiesImpl ServiceRegistry::CreateServiceProperties(const ServiceProp
     props.insert(std::make_pair(ServiceConstants::SERVICE_SCOPE(), ServiceConstants::SCOPE_SINGLETON()));
   }
 
-  return ServicePropertiesImpl(props);
+  return ServicePropertiesImpl(props, true);
 }
 
 ServiceRegistry::ServiceRegistry(CoreModuleContext* coreCtx)
   : core(coreCtx)
 {
-
+  mutex.SetName("ServiceRegistry::mutex");
 }
 
 ServiceRegistry::~ServiceRegistry()
@@ -79,6 +80,14 @@ ServiceRegistry::~ServiceRegistry()
 
 void ServiceRegistry::Clear()
 {
+  {
+    // keep the class epochs monotonic
+    const int e = static_cast<int>(epoch.AtomicIncrement());
+    for (MapClassEpochs::iterator i = classEpochs.begin(); i != classEpochs.end(); ++i)
+    {
+      i->second = e;
+    }
+  }
   services.clear();
   serviceRegistrations.clear();
   classServices.clear();
@@ -113,7 +122,7 @@ ServiceRegistrationBase ServiceRegistry::RegisterService(ModulePrivate* module,
   ServiceRegistrationBase res(module, service,
                               CreateServiceProperties(properties, classes, isFactory, isPrototypeFactory));
   {
-    MutexLock lock(mutex);
+    MutexLock lock(mutex, US_LOCK_SITE);
     services.insert(std::make_pair(res, classes));
     serviceRegistrations.push_back(res);
     for (std::vector<std::string>::const_iterator i = classes.begin();
@@ -124,6 +133,7 @@ ServiceRegistrationBase ServiceRegistry::RegisterService(ModulePrivate* module,
           std::lower_bound(s.begin(), s.end(), res);
       s.insert(ip, res);
     }
+    Modified_unlocked(classes);
   }
 
   ServiceReferenceBase r = res.GetReference(std::string());
@@ -138,7 +148,7 @@ ServiceRegistrationBase ServiceRegistry::RegisterService(ModulePrivate* module,
 void ServiceRegistry::UpdateServiceRegistrationOrder(const ServiceRegistrationBase& sr,
                                                      const std::vector<std::string>& classes)
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
   for (std::vector<std::string>::const_iterator i = classes.begin();
        i != classes.end(); ++i)
   {
@@ -146,12 +156,58 @@ void ServiceRegistry::UpdateServiceRegistrationOrder(const ServiceRegistrationBa
     s.erase(std::remove(s.begin(), s.end(), sr), s.end());
     s.insert(std::lower_bound(s.begin(), s.end(), sr), sr);
   }
+  Modified_unlocked(classes);
+}
+
+void ServiceRegistry::Modified(const std::vector<std::string>& classes)
+{
+  MutexLock lock(mutex, US_LOCK_SITE);
+  Modified_unlocked(classes);
+}
+
+void ServiceRegistry::Modified_unlocked(const std::vector<std::string>& classes)
+{
+  const int e = static_cast<int>(epoch.AtomicIncrement());
+  for (std::vector<std::string>::const_iterator i = classes.begin();
+       i != classes.end(); ++i)
+  {
+    classEpochs[*i] = e;
+  }
+}
+
+int ServiceRegistry::GetEpoch() const
+{
+  return static_cast<int>(epoch.Load());
+}
+
+int ServiceRegistry::GetEpoch(const std::string& clazz) const
+{
+  MutexLock lock(mutex, US_LOCK_SITE);
+  return GetEpoch_unlocked(clazz);
+}
+
+int ServiceRegistry::GetEpoch_unlocked(const std::string& clazz) const
+{
+  MapClassEpochs::const_iterator i = classEpochs.find(clazz);
+  return i != classEpochs.end() ? i->second : 0;
+}
+
+bool ServiceRegistry::IsUnchanged(const std::string& clazz, int& sinceEpoch) const
+{
+  MutexLock lock(mutex, US_LOCK_SITE);
+  if (GetEpoch_unlocked(clazz) > sinceEpoch ||
+      GetEpoch_unlocked(us_service_interface_iid<ServiceFindHook>()) > sinceEpoch)
+  {
+    return false;
+  }
+  sinceEpoch = GetEpoch();
+  return true;
 }
 
 void ServiceRegistry::Get(const std::string& clazz,
                           std::vector<ServiceRegistrationBase>& serviceRegs) const
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
   Get_unlocked(clazz, serviceRegs);
 }
 
@@ -165,13 +221,18 @@ void ServiceRegistry::Get_unlocked(const std::string& clazz,
   }
 }
 
-ServiceReferenceBase ServiceRegistry::Get(ModulePrivate* module, const std::string& clazz) const
+ServiceReferenceBase ServiceRegistry::Get(ModulePrivate* module, const std::string& clazz, int* resultEpoch) const
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
+  if (resultEpoch != NULL)
+  {
+    // find hooks may filter differently on every call
+    *resultEpoch = classServices.count(us_service_interface_iid<ServiceFindHook>()) > 0 ? -1 : GetEpoch();
+  }
   try
   {
     std::vector<ServiceReferenceBase> srs;
-    Get_unlocked(clazz, "", module, srs);
+    Get_unlocked(clazz, LDAPExpr(), module, srs);
     US_DEBUG << "get service ref " << clazz << " for module "
              << module->info.name << " = " << srs.size() << " refs";
 
@@ -189,22 +250,29 @@ ServiceReferenceBase ServiceRegistry::Get(ModulePrivate* module, const std::stri
 void ServiceRegistry::Get(const std::string& clazz, const std::string& filter,
                           ModulePrivate* module, std::vector<ServiceReferenceBase>& res) const
 {
-  MutexLock lock(mutex);
+  // parse outside of the lock
+  const LDAPExpr ldap = filter.empty() ? LDAPExpr() : LDAPExpr(filter);
+  MutexLock lock(mutex, US_LOCK_SITE);
+  Get_unlocked(clazz, ldap, module, res);
+}
+
+void ServiceRegistry::Get(const std::string& clazz, const LDAPExpr& filter,
+                          ModulePrivate* module, std::vector<ServiceReferenceBase>& res) const
+{
+  MutexLock lock(mutex, US_LOCK_SITE);
   Get_unlocked(clazz, filter, module, res);
 }
 
-void ServiceRegistry::Get_unlocked(const std::string& clazz, const std::string& filter,
+void ServiceRegistry::Get_unlocked(const std::string& clazz, const LDAPExpr& ldap,
                           ModulePrivate* module, std::vector<ServiceReferenceBase>& res) const
 {
   std::vector<ServiceRegistrationBase>::const_iterator s;
   std::vector<ServiceRegistrationBase>::const_iterator send;
   std::vector<ServiceRegistrationBase> v;
-  LDAPExpr ldap;
   if (clazz.empty())
   {
-    if (!filter.empty())
+    if (!ldap.IsNull())
     {
-      ldap = LDAPExpr(filter);
       LDAPExpr::ObjectClassSet matched;
       if (ldap.GetMatchedObjectClasses(matched))
       {
@@ -252,17 +320,13 @@ void ServiceRegistry::Get_unlocked(const std::string& clazz, const std::string&
     {
       return;
     }
-    if (!filter.empty())
-    {
-      ldap = LDAPExpr(filter);
-    }
   }
 
   for (; s != send; ++s)
   {
     ServiceReferenceBase sri = s->GetReference(clazz);
 
-    if (filter.empty() || ldap.Evaluate(s->d->properties, false))
+    if (ldap.IsNull() || ldap.Evaluate(s->d->GetProperties(), false))
     {
       res.push_back(sri);
     }
@@ -272,21 +336,22 @@ void ServiceRegistry::Get_unlocked(const std::string& clazz, const std::string&
   {
     if (module != NULL)
     {
-      core->serviceHooks.FilterServiceReferences(module->moduleContext, clazz, filter, res);
+      core->serviceHooks.FilterServiceReferences(module->moduleContext, clazz, ldap, res);
     }
     else
     {
-      core->serviceHooks.FilterServiceReferences(NULL, clazz, filter, res);
+      core->serviceHooks.FilterServiceReferences(NULL, clazz, ldap, res);
     }
   }
 }
 
 void ServiceRegistry::RemoveServiceRegistration(const ServiceRegistrationBase& sr)
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
 
+  const ServicePropertiesImpl props = sr.d->GetProperties();
   const std::vector<std::string>& classes = ref_any_cast<std::vector<std::string> >(
-        sr.d->properties.Value(ServiceConstants::OBJECTCLASS()));
+        props.Value(PropertyKeys::KEY_OBJECTCLASS));
   services.erase(sr);
   serviceRegistrations.erase(std::remove(serviceRegistrations.begin(), serviceRegistrations.end(), sr),
                              serviceRegistrations.end());
@@ -303,12 +368,13 @@ void ServiceRegistry::RemoveServiceRegistration(const ServiceRegistrationBase& s
       classServices.erase(*i);
     }
   }
+  Modified_unlocked(classes);
 }
 
 void ServiceRegistry::GetRegisteredByModule(ModulePrivate* p,
                                             std::vector<ServiceRegistrationBase>& res) const
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
 
   for (std::vector<ServiceRegistrationBase>::const_iterator i = serviceRegistrations.begin();
        i != serviceRegistrations.end(); ++i)
@@ -323,7 +389,7 @@ void ServiceRegistry::GetRegisteredByModule(ModulePrivate* p,
 void ServiceRegistry::GetUsedByModule(Module* p,
                                       std::vector<ServiceRegistrationBase>& res) const
 {
-  MutexLock lock(mutex);
+  MutexLock lock(mutex, US_LOCK_SITE);
 
   for (std::vector<ServiceRegistrationBase>::const_iterator i = serviceRegistrations.begin();
        i != serviceRegistrations.end(); ++i)
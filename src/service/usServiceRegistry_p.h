@@ -31,6 +31,7 @@
 US_BEGIN_NAMESPACE
 
 class CoreModuleContext;
+class LDAPExpr;
 class ModulePrivate;
 class ServicePropertiesImpl;
 
@@ -79,6 +80,20 @@ public:
    */
   MapClassServices classServices;
 
+  typedef US_UNORDERED_MAP_TYPE<std::string, int> MapClassEpochs;
+
+  /**
+   * Mapping of classname to the epoch of the last change of a service
+   * registered under it.
+   */
+  MapClassEpochs classEpochs;
+
+  /**
+   * Incremented on every change of a registered service. Read without
+   * locking, written while holding mutex.
+   */
+  AtomicCounter epoch;
+
   CoreModuleContext* core;
 
   ServiceRegistry(CoreModuleContext* coreCtx);
@@ -116,6 +131,38 @@ public:
   void UpdateServiceRegistrationOrder(const ServiceRegistrationBase& sr,
                                       const std::vector<std::string>& classes);
 
+  /**
+   * Service properties changed without affecting the order of the
+   * registered services, advance the epoch of the given classes.
+   *
+   * @param classes The class names of the modified service.
+   */
+  void Modified(const std::vector<std::string>& classes);
+
+  /**
+   * Get the current epoch of the registry. The epoch is incremented whenever
+   * a service is registered, modified or unregistered.
+   */
+  int GetEpoch() const;
+
+  /**
+   * Get the epoch of the last change of a service registered under a
+   * certain class, or zero if no such service was ever registered.
+   */
+  int GetEpoch(const std::string& clazz) const;
+
+  /**
+   * Check if the result of a previous Get(ModulePrivate*, const std::string&, int*)
+   * call is still valid.
+   *
+   * @param clazz The class name of the previous request.
+   * @param sinceEpoch The epoch returned by the previous request. Set to the
+   *        current epoch if the result is still valid.
+   * @return <code>true</code> if no service registered under <code>clazz</code>
+   *         and no find hook changed since <code>sinceEpoch</code>.
+   */
+  bool IsUnchanged(const std::string& clazz, int& sinceEpoch) const;
+
   /**
    * Get all services implementing a certain class.
    * Only used internally by the framework.
@@ -130,9 +177,11 @@ public:
    *
    * @param module The module requesting reference
    * @param clazz The class name of the requested service.
+   * @param resultEpoch If not NULL, set to the epoch of the result, or to -1 if
+   *        the result depends on find hooks and must not be reused.
    * @return A {@link ServiceReference} object.
    */
-  ServiceReferenceBase Get(ModulePrivate* module, const std::string& clazz) const;
+  ServiceReferenceBase Get(ModulePrivate* module, const std::string& clazz, int* resultEpoch = NULL) const;
 
   /**
    * Get all services implementing a certain class and then
@@ -146,6 +195,18 @@ public:
   void Get(const std::string& clazz, const std::string& filter,
            ModulePrivate* module, std::vector<ServiceReferenceBase>& serviceRefs) const;
 
+  /**
+   * Get all services implementing a certain class and then
+   * filter these with an already compiled property filter.
+   *
+   * @param clazz The class name of requested service.
+   * @param filter The property filter, a null expression matches all services.
+   * @param module The module requesting reference.
+   * @return A list of {@link ServiceReference} object.
+   */
+  void Get(const std::string& clazz, const LDAPExpr& filter,
+           ModulePrivate* module, std::vector<ServiceReferenceBase>& serviceRefs) const;
+
   /**
    * Remove a registered service.
    *
@@ -173,9 +234,13 @@ private:
 
   friend class ServiceHooks;
 
+  void Modified_unlocked(const std::vector<std::string>& classes);
+
+  int GetEpoch_unlocked(const std::string& clazz) const;
+
   void Get_unlocked(const std::string& clazz, std::vector<ServiceRegistrationBase>& serviceRegs) const;
 
-  void Get_unlocked(const std::string& clazz, const std::string& filter,
+  void Get_unlocked(const std::string& clazz, const LDAPExpr& filter,
                     ModulePrivate* module, std::vector<ServiceReferenceBase>& serviceRefs) const;
 
   // purposely not implemented
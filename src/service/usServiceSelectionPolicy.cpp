@@ -0,0 +1,189 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceSelectionPolicy.h"
+
+#include "usThreads_p.h"
+
+US_BEGIN_NAMESPACE
+
+namespace {
+
+// The weight of a completed call in the latency average
+const double LATENCY_SMOOTHING = 0.25;
+
+/*
+ * Returns the n-th number of the pseudo-random sequence for seed. The
+ * SplitMix64 finalizer makes consecutive values of n independent, so
+ * concurrent callers only need an atomic counter as state.
+ */
+unsigned long long RandomNumber(unsigned long seed, unsigned long long n)
+{
+  unsigned long long z = (static_cast<unsigned long long>(seed) << 32) + n * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Returns true if a is less loaded than b
+bool IsLessLoaded(const ServiceLoad* a, const ServiceLoad* b)
+{
+  const int aInFlight = a->GetInFlight();
+  const int bInFlight = b->GetInFlight();
+  if (aInFlight != bInFlight) return aInFlight < bInFlight;
+  return a->GetLatency() < b->GetLatency();
+}
+
+}
+
+class ServiceLoadPrivate : public MultiThreaded<>
+{
+public:
+
+  ServiceLoadPrivate(long int serviceId)
+    : serviceId(serviceId), latency(0), callCount(0)
+  {
+    this->SetLockName("ServiceLoad");
+  }
+
+  const long int serviceId;
+
+  AtomicCounter inFlight;
+
+  /**
+   * The latency average in microseconds and the number of completed
+   * calls, guarded by this.
+   */
+  double latency;
+  unsigned long callCount;
+};
+
+ServiceLoad::ServiceLoad(long int serviceId)
+  : d(new ServiceLoadPrivate(serviceId))
+{
+}
+
+ServiceLoad::~ServiceLoad()
+{
+  delete d;
+}
+
+long int ServiceLoad::GetServiceId() const
+{
+  return d->serviceId;
+}
+
+int ServiceLoad::GetInFlight() const
+{
+  return static_cast<int>(d->inFlight.Load());
+}
+
+double ServiceLoad::GetLatency() const
+{
+  ServiceLoadPrivate::Lock lock(d); US_UNUSED(lock);
+  return d->latency;
+}
+
+unsigned long ServiceLoad::GetCallCount() const
+{
+  ServiceLoadPrivate::Lock lock(d); US_UNUSED(lock);
+  return d->callCount;
+}
+
+void ServiceLoad::CallStarted()
+{
+  d->inFlight.AtomicIncrement();
+}
+
+void ServiceLoad::CallEnded(long long duration)
+{
+  d->inFlight.AtomicDecrement();
+  const double micros = static_cast<double>(duration) / 1000.0;
+
+  ServiceLoadPrivate::Lock lock(d); US_UNUSED(lock);
+  d->latency = d->callCount == 0 ? micros
+                                 : d->latency + LATENCY_SMOOTHING * (micros - d->latency);
+  ++d->callCount;
+}
+
+ServiceSelectionPolicy::~ServiceSelectionPolicy()
+{
+}
+
+RoundRobinSelectionPolicy::RoundRobinSelectionPolicy()
+{
+}
+
+std::size_t RoundRobinSelectionPolicy::Select(const std::vector<ServiceLoad*>& candidates)
+{
+  const unsigned int n = static_cast<unsigned int>(next.AtomicIncrement());
+  return n % candidates.size();
+}
+
+RandomSelectionPolicy::RandomSelectionPolicy(unsigned long seed)
+  : seed(seed)
+{
+}
+
+std::size_t RandomSelectionPolicy::Select(const std::vector<ServiceLoad*>& candidates)
+{
+  const unsigned int n = static_cast<unsigned int>(sequence.AtomicIncrement());
+  return static_cast<std::size_t>(RandomNumber(seed, n) % candidates.size());
+}
+
+LeastInFlightSelectionPolicy::LeastInFlightSelectionPolicy()
+{
+}
+
+std::size_t LeastInFlightSelectionPolicy::Select(const std::vector<ServiceLoad*>& candidates)
+{
+  // start at a rotating offset, so ties are broken in turn
+  const std::size_t size = candidates.size();
+  const std::size_t start = static_cast<unsigned int>(next.AtomicIncrement()) % size;
+  std::size_t selected = start;
+  for (std::size_t i = 1; i < size; ++i)
+  {
+    const std::size_t index = (start + i) % size;
+    if (IsLessLoaded(candidates[index], candidates[selected]))
+    {
+      selected = index;
+    }
+  }
+  return selected;
+}
+
+PowerOfTwoChoicesSelectionPolicy::PowerOfTwoChoicesSelectionPolicy(unsigned long seed)
+  : seed(seed)
+{
+}
+
+std::size_t PowerOfTwoChoicesSelectionPolicy::Select(const std::vector<ServiceLoad*>& candidates)
+{
+  const unsigned long long random =
+      RandomNumber(seed, static_cast<unsigned int>(sequence.AtomicIncrement()));
+  const std::size_t size = candidates.size();
+  const std::size_t first = static_cast<std::size_t>(random % size);
+  // a different second candidate
+  const std::size_t second = (first + 1 + static_cast<std::size_t>((random >> 32) % (size - 1))) % size;
+  return IsLessLoaded(candidates[second], candidates[first]) ? second : first;
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,228 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+
+#ifndef USSERVICESELECTIONPOLICY_H
+#define USSERVICESELECTIONPOLICY_H
+
+#include <usConfig.h>
+
+#include "usSharedData.h"
+
+#include <cstddef>
+#include <vector>
+
+US_BEGIN_NAMESPACE
+
+class ServiceLoadPrivate;
+
+/**
+ * \ingroup MicroServices
+ *
+ * The load statistics of a service tracked by a <code>ServiceTracker</code>.
+ *
+ * <p>
+ * The statistics are updated by the <code>ServiceLease</code> objects
+ * returned from <code>ServiceTracker::SelectService()</code>: a call starts
+ * when a lease is created and ends when it is released. They are used by a
+ * <code>ServiceSelectionPolicy</code> to spread calls across services.
+ *
+ * \remarks This class is thread safe.
+ * @see ServiceTracker::SelectService
+ */
+class US_EXPORT ServiceLoad : public SharedData
+{
+
+public:
+
+  ~ServiceLoad();
+
+  /**
+   * @return The service id of the service.
+   */
+  long int GetServiceId() const;
+
+  /**
+   * @return The number of calls to the service which have started but
+   *         not ended yet.
+   */
+  int GetInFlight() const;
+
+  /**
+   * Returns the exponentially weighted moving average of the duration of
+   * the calls to the service. Each completed call contributes a quarter
+   * of its duration to the average.
+   *
+   * @return The average call duration in microseconds, or 0 if no call
+   *         has completed yet.
+   */
+  double GetLatency() const;
+
+  /**
+   * @return The number of completed calls to the service.
+   */
+  unsigned long GetCallCount() const;
+
+private:
+
+  friend class ServiceLeaseBasePrivate;
+  friend class ServiceTrackerPrivate;
+
+  ServiceLoad(long int serviceId);
+
+  void CallStarted();
+
+  void CallEnded(long long duration);
+
+  ServiceLoadPrivate* d;
+
+  // purposely not implemented
+  ServiceLoad(const ServiceLoad&);
+  ServiceLoad& operator=(const ServiceLoad&);
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Selects one of several equally ranked services for a call.
+ *
+ * <p>
+ * A policy is set with <code>ServiceTracker::SetSelectionPolicy</code>
+ * and consulted by <code>ServiceTracker::SelectService()</code> whenever
+ * more than one tracked service has the highest service ranking.
+ *
+ * \remarks Implementations must be thread safe, <code>Select</code> is
+ *          called concurrently and without holding any lock.
+ * \remarks A tracker does not take ownership of its policy, see
+ *          <code>ServiceTracker::SetSelectionPolicy</code> for how long
+ *          the policy must be kept alive.
+ */
+class US_EXPORT ServiceSelectionPolicy
+{
+
+public:
+
+  virtual ~ServiceSelectionPolicy();
+
+  /**
+   * Select one of the candidates.
+   *
+   * @param candidates The load statistics of the candidate services, ordered
+   *        by ascending service id. There are at least two candidates.
+   * @return The index of the selected candidate.
+   */
+  virtual std::size_t Select(const std::vector<ServiceLoad*>& candidates) = 0;
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Selects the candidates in turn.
+ */
+class US_EXPORT RoundRobinSelectionPolicy : public ServiceSelectionPolicy
+{
+
+public:
+
+  RoundRobinSelectionPolicy();
+
+  std::size_t Select(const std::vector<ServiceLoad*>& candidates);
+
+private:
+
+  AtomicCounter next;
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Selects a candidate uniformly at random.
+ */
+class US_EXPORT RandomSelectionPolicy : public ServiceSelectionPolicy
+{
+
+public:
+
+  /**
+   * @param seed The seed of the pseudo-random sequence.
+   */
+  RandomSelectionPolicy(unsigned long seed = 0);
+
+  std::size_t Select(const std::vector<ServiceLoad*>& candidates);
+
+private:
+
+  const unsigned long seed;
+  AtomicCounter sequence;
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Selects the candidate with the fewest calls in flight. Ties are broken
+ * by the lower average latency, and then in turn.
+ */
+class US_EXPORT LeastInFlightSelectionPolicy : public ServiceSelectionPolicy
+{
+
+public:
+
+  LeastInFlightSelectionPolicy();
+
+  std::size_t Select(const std::vector<ServiceLoad*>& candidates);
+
+private:
+
+  AtomicCounter next;
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * Selects two different candidates at random and takes the one with fewer
+ * calls in flight, or with the lower average latency if both have the same
+ * number of calls in flight.
+ *
+ * <p>
+ * Comparing only two candidates keeps the selection cheap for many
+ * services, while still avoiding overloaded ones.
+ */
+class US_EXPORT PowerOfTwoChoicesSelectionPolicy : public ServiceSelectionPolicy
+{
+
+public:
+
+  /**
+   * @param seed The seed of the pseudo-random sequence.
+   */
+  PowerOfTwoChoicesSelectionPolicy(unsigned long seed = 0);
+
+  std::size_t Select(const std::vector<ServiceLoad*>& candidates);
+
+private:
+
+  const unsigned long seed;
+  AtomicCounter sequence;
+};
+
+US_END_NAMESPACE
+
+#endif // USSERVICESELECTIONPOLICY_H
@@ -0,0 +1,349 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceTracker.h"
+
+#include "usServiceTrackerPrivate.h"
+#include "usTrackedService_p.h"
+#include "usModuleContext.h"
+#include "usServiceSelectionPolicy.h"
+#include "usServiceExecutor_p.h"
+
+#include <stdexcept>
+
+US_BEGIN_NAMESPACE
+
+ServiceTrackerBase::ServiceTrackerBase(ModuleContext* context, const ServiceReferenceBase& reference,
+                                       const std::string& interfaceId, ObjectDeleter objectDeleter)
+  : d(new ServiceTrackerPrivate(this, context, reference, interfaceId, objectDeleter))
+{
+}
+
+ServiceTrackerBase::ServiceTrackerBase(ModuleContext* context, const std::string& clazz,
+                                       const std::string& interfaceId, ObjectDeleter objectDeleter)
+  : d(new ServiceTrackerPrivate(this, context, clazz, interfaceId, objectDeleter))
+{
+}
+
+ServiceTrackerBase::ServiceTrackerBase(ModuleContext* context, const LDAPFilter& filter,
+                                       const std::string& interfaceId, ObjectDeleter objectDeleter)
+  : d(new ServiceTrackerPrivate(this, context, filter, interfaceId, objectDeleter))
+{
+}
+
+ServiceTrackerBase::~ServiceTrackerBase()
+{
+  /* the typed ServiceTracker closes itself while its overrides still exist */
+  delete d;
+}
+
+void ServiceTrackerBase::Open(ServiceExecutor* executor)
+{
+  TrackedService* t;
+  {
+    ServiceTrackerPrivate::Lock lock(d); US_UNUSED(lock);
+    if (d->trackedService)
+    {
+      return;
+    }
+
+    US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker::Open: " << d->filter;
+
+    t = new TrackedService(this);
+    {
+      TrackedService::Lock trackedLock(t); US_UNUSED(trackedLock);
+      try {
+        d->context->AddServiceListener(t, &TrackedService::ServiceChanged, d->listenerFilter);
+        std::vector<ServiceReferenceU> references;
+        if (!d->trackClass.empty())
+        {
+          references = d->GetInitialReferences(d->trackClass, LDAPFilter());
+        }
+        else
+        {
+          if (d->trackReference.GetModule() != 0)
+          {
+            references.push_back(d->trackReference);
+          }
+          else
+          { /* user supplied filter */
+            references = d->GetInitialReferences(std::string(), d->filter);
+          }
+        }
+        /* set tracked with the initial references */
+        t->SetInitial(references);
+      }
+      catch (const std::invalid_argument& e)
+      {
+        throw std::runtime_error(std::string("unexpected std::invalid_argument exception: ")
+            + e.what());
+      }
+    }
+    d->trackedService = t;
+  }
+  /* Call tracked outside of synchronized region */
+  t->TrackInitial(executor); /* process the initial references */
+}
+
+void ServiceTrackerBase::Close()
+{
+  TrackedService* outgoing;
+  std::vector<ServiceReferenceU> references;
+  {
+    ServiceTrackerPrivate::Lock lock(d); US_UNUSED(lock);
+    outgoing = d->trackedService;
+    if (outgoing != 0)
+    {
+      US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker::close:" << d->filter;
+      outgoing->Close();
+      {
+        TrackedService::Lock trackedLock(outgoing); US_UNUSED(trackedLock);
+        outgoing->GetTracked(references);
+      }
+      d->trackedService = 0;
+      try
+      {
+        d->context->RemoveServiceListener(outgoing, &TrackedService::ServiceChanged);
+      }
+      catch (const std::logic_error& /*e*/)
+      {
+        /* In case the context was stopped. */
+      }
+    }
+  }
+  if (outgoing != 0)
+  {
+    d->Modified(); /* clear the cache */
+    {
+      TrackedService::Lock lock(outgoing); US_UNUSED(lock);
+      outgoing->NotifyAll(); /* wake up any waiters */
+    }
+    for(std::vector<ServiceReferenceU>::const_iterator ref = references.begin();
+        ref != references.end(); ++ref)
+    {
+      outgoing->Untrack(*ref, ServiceEvent());
+    }
+
+    if (d->DEBUG_OUTPUT)
+    {
+      if (!d->GetCache())
+      {
+        US_DEBUG(true) << "ServiceTracker::close[cached cleared]:"
+                         << d->filter;
+      }
+    }
+
+    delete outgoing;
+    d->trackedService = 0;
+  }
+
+  /* notify the callbacks still waiting for a service */
+  d->NotifyAvailable(NULL);
+}
+
+bool ServiceTrackerBase::WaitForServiceObject(unsigned long timeoutMillis, void* service)
+{
+  TrackedObjectPointer object = d->GetHighestRankedObject();
+  /* the timeout covers all iterations, a service may be removed again
+     before it is retrieved */
+  const Deadline deadline(timeoutMillis);
+  while (!object)
+  {
+    if (d->Tracked() == 0)
+    { /* if ServiceTracker is not open */
+      return false;
+    }
+    ServiceAvailableWaiter waiter;
+    d->WhenAvailable(ServiceTrackerPrivate::AvailableCallback(&waiter, ServiceTrackerPrivate::AVAILABLE_WAITER));
+    if (!waiter.WaitNotified(deadline))
+    {
+      if (d->RemoveAvailableCallback(&waiter))
+      { /* timed out */
+        object = d->GetHighestRankedObject();
+        break;
+      }
+      /* the waiter is being notified and must outlive the notification */
+      waiter.WaitNotified(Deadline(0));
+    }
+    object = d->GetHighestRankedObject();
+  }
+  if (!object) return false;
+  CopyObject(object->object, service);
+  return true;
+}
+
+void ServiceTrackerBase::WhenAvailable(void* callback)
+{
+  if (callback == NULL)
+  {
+    throw std::invalid_argument("The callback must not be null");
+  }
+  d->WhenAvailable(ServiceTrackerPrivate::AvailableCallback(callback, ServiceTrackerPrivate::AVAILABLE_CALLBACK));
+}
+
+ServiceFuture ServiceTrackerBase::WhenAvailableFuture()
+{
+  ServiceFuturePrivate* future = new ServiceFuturePrivate(1);
+  ServiceFuture result(future);
+  /* the registered callback holds a second reference until it is notified */
+  future->ref.Ref();
+  d->WhenAvailable(ServiceTrackerPrivate::AvailableCallback(future, ServiceTrackerPrivate::AVAILABLE_FUTURE));
+  return result;
+}
+
+bool ServiceTrackerBase::CancelWhenAvailable(void* callback)
+{
+  return d->RemoveAvailableCallback(callback);
+}
+
+ExplicitlySharedDataPointer<const ServiceTrackerSnapshotBase>
+ServiceTrackerBase::GetTrackedSnapshot() const
+{
+  ExplicitlySharedDataPointer<const ServiceTrackerSnapshotBase> snapshot = d->GetSnapshot();
+  if (snapshot)
+  {
+    return snapshot;
+  }
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return ExplicitlySharedDataPointer<const ServiceTrackerSnapshotBase>(CreateSnapshot(-1));
+  }
+  {
+    TrackedService::Lock lock(t); US_UNUSED(lock);
+    ServiceTrackerPrivate::Snapshot* created = d->CreateSnapshot_unlocked(t);
+    snapshot = created;
+    d->SetSnapshot(created);
+  }
+  return snapshot;
+}
+
+bool ServiceTrackerBase::GetServiceObject(void* service, void* reference) const
+{
+  TrackedObjectPointer object = d->GetHighestRankedObject();
+  if (!object)
+  { /* if no service is being tracked */
+    return false;
+  }
+  if (service != NULL) CopyObject(object->object, service);
+  if (reference != NULL) CopyReference(object->object, reference);
+  return true;
+}
+
+void ServiceTrackerBase::GetServiceObject(const ServiceReferenceBase& reference, void* service) const
+{
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return;
+  }
+  TrackedService::Lock lock(t); US_UNUSED(lock);
+  TrackedObjectPointer object = t->GetCustomizedObject(reference);
+  if (object)
+  {
+    CopyObject(object->object, service);
+  }
+}
+
+bool ServiceTrackerBase::SelectServiceIndex(const ServiceTrackerSnapshotBase& snapshot,
+                                            std::size_t& index) const
+{
+  const std::vector<ServiceLoad*>& candidates = snapshot.GetCandidates();
+  if (candidates.empty())
+  {
+    return false;
+  }
+
+  std::size_t candidate = 0;
+  ServiceSelectionPolicy* policy = d->selectionPolicy.Load();
+  if (policy != NULL && candidates.size() > 1)
+  {
+    candidate = policy->Select(candidates);
+    if (candidate >= candidates.size())
+    {
+      US_WARN << "ServiceSelectionPolicy selected an invalid index " << candidate;
+      candidate = 0;
+    }
+  }
+  index = snapshot.candidateIndices[candidate];
+  return true;
+}
+
+void ServiceTrackerBase::SetSelectionPolicy(ServiceSelectionPolicy* policy)
+{
+  d->selectionPolicy.Store(policy);
+}
+
+void ServiceTrackerBase::Remove(const ServiceReferenceBase& reference)
+{
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return;
+  }
+  t->Untrack(reference, ServiceEvent());
+}
+
+int ServiceTrackerBase::Size() const
+{
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return 0;
+  }
+  {
+    TrackedService::Lock lock(t); US_UNUSED(lock);
+    return static_cast<int>(t->Size());
+  }
+}
+
+int ServiceTrackerBase::GetTrackingCount() const
+{
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return -1;
+  }
+  {
+    TrackedService::Lock lock(t); US_UNUSED(lock);
+    return t->GetTrackingCount();
+  }
+}
+
+bool ServiceTrackerBase::IsEmpty() const
+{
+  TrackedService* t = d->Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return true;
+  }
+  {
+    TrackedService::Lock lock(t); US_UNUSED(lock);
+    return t->IsEmpty();
+  }
+}
+
+ModuleContext* ServiceTrackerBase::GetModuleContext() const
+{
+  return d->context;
+}
+
+US_END_NAMESPACE
@@ -26,13 +26,18 @@
 #include <map>
 
 #include "usServiceReference.h"
+#include "usServiceHandle.h"
+#include "usServiceLease.h"
+#include "usServiceExecutor.h"
 #include "usServiceTrackerCustomizer.h"
+#include "usServiceAvailableCallback.h"
+#include "usServiceTrackerSnapshot.h"
 #include "usLDAPFilter.h"
 
 US_BEGIN_NAMESPACE
 
-template<class S, class T> class TrackedService;
-template<class S, class T> class ServiceTrackerPrivate;
+class TrackedService;
+class ServiceTrackerPrivate;
 class ModuleContext;
 
 /**
@@ -175,6 +180,101 @@ struct TrackedTypeTraits<void,void*>
 };
 /// \endcond
 
+/**
+ * \ingroup MicroServices
+ *
+ * The untyped implementation of ServiceTracker, compiled into the library.
+ * The tracked objects are opaque to it and owned by the typed tracker.
+ *
+ * \note This class is an implementation detail. Use the template
+ *       ServiceTracker instead.
+ *
+ * @remarks This class is thread safe.
+ */
+class US_EXPORT ServiceTrackerBase
+{
+
+private:
+
+  friend class TrackedService;
+  friend class ServiceTrackerPrivate;
+
+  ServiceTrackerPrivate* const d;
+
+  // purposely not implemented
+  ServiceTrackerBase(const ServiceTrackerBase&);
+  ServiceTrackerBase& operator=(const ServiceTrackerBase&);
+
+protected:
+
+  typedef void (*ObjectDeleter)(void*);
+
+  ServiceTrackerBase(ModuleContext* context, const ServiceReferenceBase& reference,
+                     const std::string& interfaceId, ObjectDeleter objectDeleter);
+
+  ServiceTrackerBase(ModuleContext* context, const std::string& clazz,
+                     const std::string& interfaceId, ObjectDeleter objectDeleter);
+
+  ServiceTrackerBase(ModuleContext* context, const LDAPFilter& filter,
+                     const std::string& interfaceId, ObjectDeleter objectDeleter);
+
+  virtual ~ServiceTrackerBase();
+
+  void Open(ServiceExecutor* executor);
+
+  void Close();
+
+  // Waits for a tracked service and assigns its tracked object to service
+  bool WaitForServiceObject(unsigned long timeoutMillis, void* service);
+
+  void WhenAvailable(void* callback);
+
+  ServiceFuture WhenAvailableFuture();
+
+  bool CancelWhenAvailable(void* callback);
+
+  ExplicitlySharedDataPointer<const ServiceTrackerSnapshotBase> GetTrackedSnapshot() const;
+
+  // Assigns the tracked object and the reference of the highest ranking
+  // service to service and reference, unless they are NULL
+  bool GetServiceObject(void* service, void* reference) const;
+
+  void GetServiceObject(const ServiceReferenceBase& reference, void* service) const;
+
+  bool SelectServiceIndex(const ServiceTrackerSnapshotBase& snapshot, std::size_t& index) const;
+
+  void SetSelectionPolicy(ServiceSelectionPolicy* policy);
+
+  void Remove(const ServiceReferenceBase& reference);
+
+  int Size() const;
+
+  int GetTrackingCount() const;
+
+  bool IsEmpty() const;
+
+  ModuleContext* GetModuleContext() const;
+
+  // Returns the object to track for reference, or NULL
+  virtual void* AddingObject(const ServiceReferenceBase& reference) = 0;
+
+  virtual void ModifiedObject(void* object) = 0;
+
+  virtual void RemovedObject(void* object) = 0;
+
+  // Assigns the tracked object in object to the tracked type in service
+  virtual void CopyObject(const void* object, void* service) const = 0;
+
+  // Assigns the reference of the tracked object in object to reference
+  virtual void CopyReference(const void* object, void* reference) const = 0;
+
+  virtual ServiceTrackerSnapshotBase* CreateSnapshot(int trackingCount) const = 0;
+
+  // Calls callback with object, or as closed if object is NULL
+  virtual void ServiceAvailable(void* callback, const void* object) = 0;
+
+};
+
 /**
  * \ingroup MicroServices
  *
@@ -231,7 +331,8 @@ struct TrackedTypeTraits<void,void*>
  * @remarks This class is thread safe.
  */
 template<class S, class TTT = TrackedTypeTraits<S,S*> >
-class ServiceTracker : protected ServiceTrackerCustomizer<S,typename TTT::TrackedType>
+class ServiceTracker : protected ServiceTrackerCustomizer<S,typename TTT::TrackedType>,
+    private ServiceTrackerBase
 {
 public:
 
@@ -244,6 +345,11 @@ public:
 
   typedef std::map<ServiceReference<S>,T> TrackingMap;
 
+  /// The type of the snapshots returned by GetTrackedSnapshot()
+  typedef ServiceTrackerSnapshot<S,T> SnapshotType;
+  /// A shared handle to an immutable snapshot
+  typedef ExplicitlySharedDataPointer<const SnapshotType> SnapshotHandle;
+
   ~ServiceTracker();
 
   /**
@@ -346,6 +452,37 @@ public:
    */
   virtual void Open();
 
+  /**
+   * Open this <code>ServiceTracker</code> and begin tracking services,
+   * calling the customizer for the initial services from tasks run by
+   * \c executor.
+   *
+   * <p>
+   * Use this method if the <code>ServiceTrackerCustomizer::AddingService</code>
+   * method does expensive work, like connecting to a remote endpoint. The
+   * tasks for the services found when opening the tracker may run
+   * concurrently. This method returns after all tasks completed, or were
+   * cancelled because their service was unregistered or modified to no
+   * longer match before the task ran. Services registered while the
+   * tracker is being opened are added from the thread delivering the
+   * service event, as with Open().
+   *
+   * <p>
+   * Exceptions thrown by <code>AddingService</code> in a task are logged
+   * and the service is not tracked.
+   *
+   * @param executor The executor running the customizer calls for the
+   *        initial services. If \c executor is null, this method is
+   *        equivalent to Open().
+   *
+   * @throws std::logic_error If the <code>ModuleContext</code>
+   *         with which this <code>ServiceTracker</code> was created is no
+   *         longer valid.
+   *
+   * @see ServiceExecutor
+   */
+  virtual void Open(ServiceExecutor* executor);
+
   /**
    * Close this <code>ServiceTracker</code>.
    *
@@ -354,6 +491,11 @@ public:
    * end the tracking of services.
    *
    * <p>
+   * Callbacks registered with WhenAvailable() which have not been called
+   * yet are called with an invalid reference and a default tracked object,
+   * and futures returned by WhenAvailable() are completed.
+   *
+   * <p>
    * This implementation calls GetServiceReferences() to get the list
    * of tracked services to remove.
    */
@@ -372,20 +514,94 @@ public:
    *
    * <p>
    * This implementation calls GetService() to determine if a service
-   * is being tracked.
+   * is being tracked, and waits with WhenAvailable() otherwise.
    *
+   * @param timeoutMillis The maximum time to wait in milliseconds, or 0 to
+   *        wait without a time limit.
    * @return Returns the result of GetService().
    */
   virtual T WaitForService(unsigned long timeoutMillis = 0);
 
+  /**
+   * Register a callback which is notified once a service is tracked by
+   * this <code>ServiceTracker</code>.
+   *
+   * <p>
+   * If a service is already being tracked, the callback is called before
+   * this method returns. Otherwise it is called when the next service is
+   * added to this <code>ServiceTracker</code>, from the thread adding the
+   * service. If this <code>ServiceTracker</code> is closed first, Close()
+   * calls the callback with an invalid reference and a default tracked
+   * object, i.e. <code>ServiceAvailable(ServiceReferenceType(), T())</code>,
+   * which is a null pointer for the default tracked type. A callback is
+   * called exactly once, unless it is removed with CancelWhenAvailable().
+   *
+   * <p>
+   * In contrast to WaitForService(), no thread is blocked while waiting
+   * and callbacks are only called when a service becomes available, not
+   * for every modification of this <code>ServiceTracker</code>.
+   *
+   * @param callback The callback to notify. It is not owned by this
+   *        <code>ServiceTracker</code> and must stay valid until it was
+   *        called or cancelled.
+   * @throws std::invalid_argument If \c callback is null.
+   *
+   * @see ServiceAvailableCallback
+   */
+  virtual void WhenAvailable(ServiceAvailableCallback<S,T>* callback);
+
+  /**
+   * Returns a future which is done once a service is tracked by this
+   * <code>ServiceTracker</code>, or once it is closed.
+   *
+   * <p>
+   * The future completes under the same conditions as a callback
+   * registered with WhenAvailable(ServiceAvailableCallback<S,T>*). It does
+   * not carry the service, call GetService() after it is done. The
+   * result is an invalid object if this <code>ServiceTracker</code> was
+   * closed in the meantime.
+   *
+   * @return A future which is already done if a service is being tracked.
+   */
+  virtual ServiceFuture WhenAvailable();
+
+  /**
+   * Remove a callback registered with WhenAvailable() which has not been
+   * called yet.
+   *
+   * @param callback The callback to remove.
+   * @return \c true if the callback was removed and will not be called,
+   *         \c false if it has already been called or is being called.
+   */
+  virtual bool CancelWhenAvailable(ServiceAvailableCallback<S,T>* callback);
+
   /**
    * Return a list of <code>ServiceReference</code>s for all services being
    * tracked by this <code>ServiceTracker</code>.
    *
+   * <p>
+   * This implementation copies the references of GetTrackedSnapshot().
+   *
    * @return List of <code>ServiceReference</code>s.
    */
   virtual std::vector<ServiceReferenceType> GetServiceReferences() const;
 
+  /**
+   * Return an immutable snapshot of all services being tracked by this
+   * <code>ServiceTracker</code>.
+   *
+   * <p>
+   * The snapshot is created on the first call after the set of tracked
+   * services was modified and shared by all following calls. Returning the
+   * current snapshot neither allocates nor synchronizes on this tracker,
+   * which makes this method suitable for calling all tracked services on
+   * every request.
+   *
+   * @return A handle to the snapshot. The snapshot is empty if no services
+   *         are being tracked or this tracker is not open.
+   */
+  virtual SnapshotHandle GetTrackedSnapshot() const;
+
   /**
    * Returns a <code>ServiceReference</code> for one of the services being
    * tracked by this <code>ServiceTracker</code>.
@@ -424,10 +640,7 @@ public:
    * <code>ServiceTracker</code>.
    *
    * <p>
-   * This implementation calls GetServiceReferences() to get the list
-   * of references for the tracked services and then calls
-   * GetService(const ServiceReference&) for each reference to get the
-   * tracked service object.
+   * This implementation copies the tracked objects of GetTrackedSnapshot().
    *
    * @return A list of service objects or an empty list if no services
    *         are being tracked.
@@ -447,6 +660,54 @@ public:
    */
   virtual T GetService() const;
 
+  /**
+   * Returns a ServiceHandle pinning the service returned by GetServiceReference().
+   *
+   * <p>
+   * The handle keeps a use count of the service for the module of the
+   * tracker's context, independently of the customizer. It is invalidated
+   * when the service is unregistered.
+   *
+   * @return A ServiceHandle or an invalid handle if no services are being
+   *         tracked.
+   */
+  ServiceHandle<S> GetServiceHandle() const;
+
+  /**
+   * Selects one of the services with the highest service ranking for a call.
+   *
+   * <p>
+   * If several tracked services share the highest ranking, the selection
+   * policy set with SetSelectionPolicy() chooses among them. Without a
+   * policy, the service returned by GetService() is selected.
+   *
+   * <p>
+   * The returned lease counts as a call in flight to the selected service
+   * until it is released. The number of calls in flight and the durations
+   * of completed calls are available to the selection policy.
+   *
+   * @return A lease for the selected service, or an invalid lease if no
+   *         services are being tracked.
+   */
+  ServiceLease<S,T> SelectService() const;
+
+  /**
+   * Sets the policy used by SelectService() to choose among services with
+   * the same, highest ranking.
+   *
+   * <p>
+   * The policy is not owned by this tracker and is not copied. The caller
+   * must keep it alive until this tracker is destroyed, or until the
+   * tracker has been closed and no SelectService() call on it is still
+   * running. The same applies to a policy replaced by a later call to
+   * this method, because a concurrent SelectService() call may still use
+   * the previous policy.
+   *
+   * @param policy The policy, or \c NULL to always select the service
+   *        returned by GetService().
+   */
+  using ServiceTrackerBase::SetSelectionPolicy;
+
   /**
    * Remove a service from this <code>ServiceTracker</code>.
    *
@@ -583,14 +844,26 @@ protected:
 private:
 
   typedef ServiceTracker<S,TTT> _ServiceTracker;
-  typedef TrackedService<S,TTT> _TrackedService;
-  typedef ServiceTrackerPrivate<S,TTT> _ServiceTrackerPrivate;
   typedef ServiceTrackerCustomizer<S,T> _ServiceTrackerCustomizer;
+  typedef ServiceTrackerEntry<S,T> _Entry;
+
+  void* AddingObject(const ServiceReferenceBase& reference);
+
+  void ModifiedObject(void* object);
+
+  void RemovedObject(void* object);
+
+  void CopyObject(const void* object, void* service) const;
+
+  void CopyReference(const void* object, void* reference) const;
+
+  ServiceTrackerSnapshotBase* CreateSnapshot(int trackingCount) const;
+
+  void ServiceAvailable(void* callback, const void* object);
 
-  friend class TrackedService<S,TTT>;
-  friend class ServiceTrackerPrivate<S,TTT>;
+  static void DeleteObject(void* object);
 
-  _ServiceTrackerPrivate* const d;
+  _ServiceTrackerCustomizer* const customizer;
 };
 
 US_END_NAMESPACE
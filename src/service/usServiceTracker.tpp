@@ -20,13 +20,10 @@
 =============================================================================*/
 
 
-#include "usServiceTrackerPrivate.h"
-#include "usTrackedService_p.h"
 #include "usServiceException.h"
 #include "usModuleContext.h"
 
 #include <stdexcept>
-#include <limits>
 
 US_BEGIN_NAMESPACE
 
@@ -34,7 +31,6 @@ template<class S, class TTT>
 ServiceTracker<S,TTT>::~ServiceTracker()
 {
   Close();
-  delete d;
 }
 
 #ifdef _MSC_VER
@@ -46,27 +42,32 @@ template<class S, class TTT>
 ServiceTracker<S,TTT>::ServiceTracker(ModuleContext* context,
                                       const ServiceReferenceType& reference,
                                       _ServiceTrackerCustomizer* customizer)
-  : d(new _ServiceTrackerPrivate(this, context, reference, customizer))
+  : ServiceTrackerBase(context, reference, us_service_interface_iid<S>(), &_ServiceTracker::DeleteObject)
+  , customizer(customizer ? customizer : this)
 {
 }
 
 template<class S, class TTT>
 ServiceTracker<S,TTT>::ServiceTracker(ModuleContext* context, const std::string& clazz,
                                       _ServiceTrackerCustomizer* customizer)
-  : d(new _ServiceTrackerPrivate(this, context, clazz, customizer))
+  : ServiceTrackerBase(context, clazz, us_service_interface_iid<S>(), &_ServiceTracker::DeleteObject)
+  , customizer(customizer ? customizer : this)
 {
 }
 
 template<class S, class TTT>
 ServiceTracker<S,TTT>::ServiceTracker(ModuleContext* context, const LDAPFilter& filter,
                                       _ServiceTrackerCustomizer* customizer)
-  : d(new _ServiceTrackerPrivate(this, context, filter, customizer))
+  : ServiceTrackerBase(context, filter, us_service_interface_iid<S>(), &_ServiceTracker::DeleteObject)
+  , customizer(customizer ? customizer : this)
 {
 }
 
 template<class S, class TTT>
 ServiceTracker<S,TTT>::ServiceTracker(ModuleContext *context, _ServiceTrackerCustomizer* customizer)
-  : d(new _ServiceTrackerPrivate(this, context, us_service_interface_iid<S>(), customizer))
+  : ServiceTrackerBase(context, std::string(us_service_interface_iid<S>()),
+                       us_service_interface_iid<S>(), &_ServiceTracker::DeleteObject)
+  , customizer(customizer ? customizer : this)
 {
   const char* clazz = us_service_interface_iid<S>();
   if (clazz == 0) throw ServiceException("The service interface class has no US_DECLARE_SERVICE_INTERFACE macro");
@@ -79,142 +80,62 @@ ServiceTracker<S,TTT>::ServiceTracker(ModuleContext *context, _ServiceTrackerCus
 template<class S, class TTT>
 void ServiceTracker<S,TTT>::Open()
 {
-  _TrackedService* t;
-  {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    if (d->trackedService)
-    {
-      return;
-    }
-
-    US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::Open: " << d->filter;
-
-    t = new _TrackedService(this, d->customizer);
-    {
-      US_UNUSED(typename _TrackedService::Lock(*t));
-      try {
-        d->context->AddServiceListener(t, &_TrackedService::ServiceChanged, d->listenerFilter);
-        std::vector<ServiceReferenceType> references;
-        if (!d->trackClass.empty())
-        {
-          references = d->GetInitialReferences(d->trackClass, std::string());
-        }
-        else
-        {
-          if (d->trackReference.GetModule() != 0)
-          {
-            references.push_back(d->trackReference);
-          }
-          else
-          { /* user supplied filter */
-            references = d->GetInitialReferences(std::string(),
-                                                 (d->listenerFilter.empty()) ? d->filter.ToString() : d->listenerFilter);
-          }
-        }
-        /* set tracked with the initial references */
-        t->SetInitial(references);
-      }
-      catch (const std::invalid_argument& e)
-      {
-        throw std::runtime_error(std::string("unexpected std::invalid_argument exception: ")
-            + e.what());
-      }
-    }
-    d->trackedService = t;
-  }
-  /* Call tracked outside of synchronized region */
-  t->TrackInitial(); /* process the initial references */
+  Open(NULL);
 }
 
 template<class S, class TTT>
-void ServiceTracker<S,TTT>::Close()
+void ServiceTracker<S,TTT>::Open(ServiceExecutor* executor)
 {
-  _TrackedService* outgoing;
-  std::vector<ServiceReferenceType> references;
-  {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    outgoing = d->trackedService;
-    if (outgoing == 0)
-    {
-      return;
-    }
-    US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::close:" << d->filter;
-    outgoing->Close();
-    references = GetServiceReferences();
-    d->trackedService = 0;
-    try
-    {
-      d->context->RemoveServiceListener(outgoing, &_TrackedService::ServiceChanged);
-    }
-    catch (const std::logic_error& /*e*/)
-    {
-      /* In case the context was stopped. */
-    }
-  }
-  d->Modified(); /* clear the cache */
-  {
-    US_UNUSED(typename _TrackedService::Lock(outgoing));
-    outgoing->NotifyAll(); /* wake up any waiters */
-  }
-  for(typename std::vector<ServiceReferenceType>::const_iterator ref = references.begin();
-      ref != references.end(); ++ref)
-  {
-    outgoing->Untrack(*ref, ServiceEvent());
-  }
-
-  if (d->DEBUG_OUTPUT)
-  {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    if ((d->cachedReference.GetModule() == 0) && !TTT::IsValid(d->cachedService))
-    {
-      US_DEBUG(true) << "ServiceTracker<S,TTT>::close[cached cleared]:"
-                       << d->filter;
-    }
-  }
+  ServiceTrackerBase::Open(executor);
+}
 
-  delete outgoing;
-  d->trackedService = 0;
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::Close()
+{
+  ServiceTrackerBase::Close();
 }
 
 template<class S, class TTT>
 typename ServiceTracker<S,TTT>::T
 ServiceTracker<S,TTT>::WaitForService(unsigned long timeoutMillis)
 {
-  T object = GetService();
-  while (!TTT::IsValid(object))
-  {
-    _TrackedService* t = d->Tracked();
-    if (t == 0)
-    { /* if ServiceTracker is not open */
-      return TTT::DefaultValue();
-    }
-    {
-      US_UNUSED(typename _TrackedService::Lock(t));
-      if (t->Size() == 0)
-      {
-        t->Wait(timeoutMillis);
-      }
-    }
-    object = GetService();
-  }
-  return object;
+  T service = TTT::DefaultValue();
+  WaitForServiceObject(timeoutMillis, &service);
+  return service;
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::WhenAvailable(ServiceAvailableCallback<S,T>* callback)
+{
+  ServiceTrackerBase::WhenAvailable(callback);
+}
+
+template<class S, class TTT>
+ServiceFuture ServiceTracker<S,TTT>::WhenAvailable()
+{
+  return ServiceTrackerBase::WhenAvailableFuture();
+}
+
+template<class S, class TTT>
+bool ServiceTracker<S,TTT>::CancelWhenAvailable(ServiceAvailableCallback<S,T>* callback)
+{
+  return ServiceTrackerBase::CancelWhenAvailable(callback);
 }
 
 template<class S, class TTT>
 std::vector<typename ServiceTracker<S,TTT>::ServiceReferenceType>
 ServiceTracker<S,TTT>::GetServiceReferences() const
 {
-  std::vector<ServiceReferenceType> refs;
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return refs;
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    d->GetServiceReferences_unlocked(refs, t);
-  }
-  return refs;
+  return GetTrackedSnapshot()->GetServiceReferences();
+}
+
+template<class S, class TTT>
+typename ServiceTracker<S,TTT>::SnapshotHandle
+ServiceTracker<S,TTT>::GetTrackedSnapshot() const
+{
+  /* all snapshots of this tracker are created by CreateSnapshot */
+  return SnapshotHandle(static_cast<const SnapshotType*>(
+                          ServiceTrackerBase::GetTrackedSnapshot().ConstData()));
 }
 
 template<class S, class TTT>
@@ -222,230 +143,108 @@ typename ServiceTracker<S,TTT>::ServiceReferenceType
 ServiceTracker<S,TTT>::GetServiceReference() const
 {
   ServiceReferenceType reference;
-  {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    reference = d->cachedReference;
-  }
-  if (reference.GetModule() != 0)
-  {
-    US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::getServiceReference[cached]:"
-                         << d->filter;
-    return reference;
-  }
-  US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::getServiceReference:" << d->filter;
-  std::vector<ServiceReferenceType> references = GetServiceReferences();
-  std::size_t length = references.size();
-  if (length == 0)
+  if (!GetServiceObject(NULL, &reference))
   { /* if no service is being tracked */
     throw ServiceException("No service is being tracked");
   }
-  typename std::vector<ServiceReferenceType>::const_iterator selectedRef = references.begin();
-  if (length > 1)
-  { /* if more than one service, select highest ranking */
-    std::vector<int> rankings(length);
-    int count = 0;
-    int maxRanking = std::numeric_limits<int>::min();
-    typename std::vector<ServiceReferenceType>::const_iterator refIter = references.begin();
-    for (std::size_t i = 0; i < length; i++)
-    {
-      Any rankingAny = refIter->GetProperty(ServiceConstants::SERVICE_RANKING());
-      int ranking = 0;
-      if (rankingAny.Type() == typeid(int))
-      {
-        ranking = any_cast<int>(rankingAny);
-      }
-
-      rankings[i] = ranking;
-      if (ranking > maxRanking)
-      {
-        selectedRef = refIter;
-        maxRanking = ranking;
-        count = 1;
-      }
-      else
-      {
-        if (ranking == maxRanking)
-        {
-          count++;
-        }
-      }
-      ++refIter;
-    }
-    if (count > 1)
-    { /* if still more than one service, select lowest id */
-      long int minId = std::numeric_limits<long int>::max();
-      refIter = references.begin();
-      for (std::size_t i = 0; i < length; i++)
-      {
-        if (rankings[i] == maxRanking)
-        {
-          Any idAny = refIter->GetProperty(ServiceConstants::SERVICE_ID());
-          long int id = 0;
-          if (idAny.Type() == typeid(long int))
-          {
-            id = any_cast<long int>(idAny);
-          }
-          if (id < minId)
-          {
-            selectedRef = refIter;
-            minId = id;
-          }
-        }
-        ++refIter;
-      }
-    }
-  }
-
-  {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    d->cachedReference = *selectedRef;
-    return d->cachedReference;
-  }
+  return reference;
 }
 
 template<class S, class TTT>
 typename ServiceTracker<S,TTT>::T
 ServiceTracker<S,TTT>::GetService(const ServiceReferenceType& reference) const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return TTT::DefaultValue();
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    return t->GetCustomizedObject(reference);
-  }
+  T service = TTT::DefaultValue();
+  GetServiceObject(reference, &service);
+  return service;
 }
 
 template<class S, class TTT>
 std::vector<typename ServiceTracker<S,TTT>::T> ServiceTracker<S,TTT>::GetServices() const
 {
-  std::vector<T> services;
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return services;
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    std::vector<ServiceReferenceType> references;
-    d->GetServiceReferences_unlocked(references, t);
-    for(typename std::vector<ServiceReferenceType>::const_iterator ref = references.begin();
-        ref != references.end(); ++ref)
-    {
-      services.push_back(t->GetCustomizedObject(*ref));
-    }
-  }
-  return services;
+  return GetTrackedSnapshot()->GetServices();
 }
 
 template<class S, class TTT>
 typename ServiceTracker<S,TTT>::T
 ServiceTracker<S,TTT>::GetService() const
 {
+  T service = TTT::DefaultValue();
+  GetServiceObject(&service, NULL);
+  return service;
+}
+
+template<class S, class TTT>
+ServiceHandle<S> ServiceTracker<S,TTT>::GetServiceHandle() const
+{
+  ServiceReferenceType reference;
+  if (!GetServiceObject(NULL, &reference))
   {
-    US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-    const T& service = d->cachedService;
-    if (TTT::IsValid(service))
-    {
-      US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::getService[cached]:"
-                                << d->filter;
-      return service;
-    }
+    return ServiceHandle<S>();
   }
-  US_DEBUG(d->DEBUG_OUTPUT) << "ServiceTracker<S,TTT>::getService:" << d->filter;
-
   try
   {
-    ServiceReferenceType reference = GetServiceReference();
-    if (reference.GetModule() == 0)
-    {
-      return TTT::DefaultValue();
-    }
-    {
-      US_UNUSED(typename _ServiceTrackerPrivate::Lock(d));
-      return d->cachedService = GetService(reference);
-    }
+    return GetModuleContext()->GetServiceHandle(reference);
   }
-  catch (const ServiceException&)
+  catch (const std::invalid_argument&)
   {
-    return TTT::DefaultValue();
+    // the service was unregistered concurrently
+    return ServiceHandle<S>();
   }
 }
 
 template<class S, class TTT>
-void ServiceTracker<S,TTT>::Remove(const ServiceReferenceType& reference)
+ServiceLease<S,typename ServiceTracker<S,TTT>::T> ServiceTracker<S,TTT>::SelectService() const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return;
+  SnapshotHandle snapshot = GetTrackedSnapshot();
+  std::size_t index = 0;
+  if (!SelectServiceIndex(*snapshot, index))
+  {
+    return ServiceLease<S,T>();
   }
-  t->Untrack(reference, ServiceEvent());
+  return ServiceLease<S,T>(snapshot->GetServiceReference(index), snapshot->GetService(index),
+                           snapshot->GetServiceLoads()[index]);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::Remove(const ServiceReferenceType& reference)
+{
+  ServiceTrackerBase::Remove(reference);
 }
 
 template<class S, class TTT>
 int ServiceTracker<S,TTT>::Size() const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return 0;
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    return static_cast<int>(t->Size());
-  }
+  return ServiceTrackerBase::Size();
 }
 
 template<class S, class TTT>
 int ServiceTracker<S,TTT>::GetTrackingCount() const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return -1;
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    return t->GetTrackingCount();
-  }
+  return ServiceTrackerBase::GetTrackingCount();
 }
 
 template<class S, class TTT>
 void ServiceTracker<S,TTT>::GetTracked(TrackingMap& map) const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return;
-  }
+  SnapshotHandle snapshot = GetTrackedSnapshot();
+  for (std::size_t i = 0; i < snapshot->Size(); ++i)
   {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    t->CopyEntries(map);
+    map.insert(std::make_pair(snapshot->GetServiceReference(i), snapshot->GetService(i)));
   }
 }
 
 template<class S, class TTT>
 bool ServiceTracker<S,TTT>::IsEmpty() const
 {
-  _TrackedService* t = d->Tracked();
-  if (t == 0)
-  { /* if ServiceTracker is not open */
-    return true;
-  }
-  {
-    US_UNUSED(typename _TrackedService::Lock(t));
-    return t->IsEmpty();
-  }
+  return ServiceTrackerBase::IsEmpty();
 }
 
 template<class S, class TTT>
 typename ServiceTracker<S,TTT>::T
 ServiceTracker<S,TTT>::AddingService(const ServiceReferenceType& reference)
 {
-  return TTT::ConvertToTrackedType(d->context->GetService(reference));
+  return TTT::ConvertToTrackedType(GetModuleContext()->GetService(reference));
 }
 
 template<class S, class TTT>
@@ -457,7 +256,70 @@ void ServiceTracker<S,TTT>::ModifiedService(const ServiceReferenceType& /*refere
 template<class S, class TTT>
 void ServiceTracker<S,TTT>::RemovedService(const ServiceReferenceType& reference, T /*service*/)
 {
-  d->context->UngetService(reference);
+  GetModuleContext()->UngetService(reference);
+}
+
+template<class S, class TTT>
+void* ServiceTracker<S,TTT>::AddingObject(const ServiceReferenceBase& reference)
+{
+  const ServiceReferenceType typedReference(reference);
+  T object = customizer->AddingService(typedReference);
+  if (!TTT::IsValid(object))
+  {
+    return NULL;
+  }
+  return new _Entry(typedReference, object);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::ModifiedObject(void* object)
+{
+  const _Entry* entry = static_cast<const _Entry*>(object);
+  customizer->ModifiedService(entry->reference, entry->object);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::RemovedObject(void* object)
+{
+  const _Entry* entry = static_cast<const _Entry*>(object);
+  customizer->RemovedService(entry->reference, entry->object);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::CopyObject(const void* object, void* service) const
+{
+  *static_cast<T*>(service) = static_cast<const _Entry*>(object)->object;
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::CopyReference(const void* object, void* reference) const
+{
+  *static_cast<ServiceReferenceType*>(reference) = static_cast<const _Entry*>(object)->reference;
+}
+
+template<class S, class TTT>
+ServiceTrackerSnapshotBase* ServiceTracker<S,TTT>::CreateSnapshot(int trackingCount) const
+{
+  return new SnapshotType(trackingCount);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::ServiceAvailable(void* callback, const void* object)
+{
+  ServiceAvailableCallback<S,T>* availableCallback = static_cast<ServiceAvailableCallback<S,T>*>(callback);
+  if (object == NULL)
+  { /* the tracker was closed */
+    availableCallback->ServiceAvailable(ServiceReferenceType(), TTT::DefaultValue());
+    return;
+  }
+  const _Entry* entry = static_cast<const _Entry*>(object);
+  availableCallback->ServiceAvailable(entry->reference, entry->object);
+}
+
+template<class S, class TTT>
+void ServiceTracker<S,TTT>::DeleteObject(void* object)
+{
+  delete static_cast<_Entry*>(object);
 }
 
 US_END_NAMESPACE
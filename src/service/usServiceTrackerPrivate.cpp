@@ -0,0 +1,366 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceTrackerPrivate.h"
+
+#include "usTrackedService_p.h"
+#include "usModuleContext.h"
+#include "usLDAPFilter.h"
+#include "usServiceSelectionPolicy.h"
+#include "usServiceExecutor_p.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+
+US_BEGIN_NAMESPACE
+
+const bool ServiceTrackerPrivate::DEBUG_OUTPUT = true;
+
+ServiceTrackerPrivate::ServiceTrackerPrivate(
+    ServiceTrackerBase* st, ModuleContext* context,
+    const ServiceReferenceBase& reference,
+    const std::string& interfaceId,
+    ObjectDeleter objectDeleter)
+  : context(context), trackReference(reference), interfaceId(interfaceId),
+    objectDeleter(objectDeleter), trackedService(0), cachedService(), q_ptr(st)
+{
+  this->SetLockName("ServiceTracker");
+  std::stringstream ss;
+  ss << "(" << ServiceConstants::SERVICE_ID() << "="
+     << any_cast<long>(reference.GetProperty(ServiceConstants::SERVICE_ID())) << ")";
+  this->listenerFilter = ss.str();
+  try
+  {
+    this->filter = LDAPFilter(listenerFilter);
+  }
+  catch (const std::invalid_argument& e)
+  {
+    /*
+     * we could only get this exception if the ServiceReference was
+     * invalid
+     */
+    std::invalid_argument ia(std::string("unexpected std::invalid_argument exception: ") + e.what());
+    throw ia;
+  }
+}
+
+ServiceTrackerPrivate::ServiceTrackerPrivate(
+    ServiceTrackerBase* st,
+    ModuleContext* context, const std::string& clazz,
+    const std::string& interfaceId,
+    ObjectDeleter objectDeleter)
+      : context(context), trackClass(clazz), trackReference(),
+        interfaceId(interfaceId), objectDeleter(objectDeleter),
+        trackedService(0), cachedService(), q_ptr(st)
+{
+  this->SetLockName("ServiceTracker");
+  this->listenerFilter = std::string("(") + US_PREPEND_NAMESPACE(ServiceConstants)::OBJECTCLASS() + "="
+                        + clazz + ")";
+  try
+  {
+    this->filter = LDAPFilter(listenerFilter);
+  }
+  catch (const std::invalid_argument& e)
+  {
+    /*
+     * we could only get this exception if the clazz argument was
+     * malformed
+     */
+    std::invalid_argument ia(
+        std::string("unexpected std::invalid_argument exception: ") + e.what());
+    throw ia;
+  }
+}
+
+ServiceTrackerPrivate::ServiceTrackerPrivate(
+    ServiceTrackerBase* st,
+    ModuleContext* context, const LDAPFilter& filter,
+    const std::string& interfaceId,
+    ObjectDeleter objectDeleter)
+      : context(context), filter(filter),
+        listenerFilter(filter.ToString()), trackReference(),
+        interfaceId(interfaceId), objectDeleter(objectDeleter),
+        trackedService(0), cachedService(), q_ptr(st)
+{
+  this->SetLockName("ServiceTracker");
+  if (context == 0)
+  {
+    throw std::invalid_argument("The module context cannot be null.");
+  }
+}
+
+ServiceTrackerPrivate::~ServiceTrackerPrivate()
+{
+  MutexLock lock(cacheMutex);
+  ReleaseServiceLoads_unlocked();
+}
+
+std::vector<ServiceReferenceU> ServiceTrackerPrivate::GetInitialReferences(
+  const std::string& className, const LDAPFilter& filter)
+{
+  std::vector<ServiceReferenceU> result;
+  std::vector<ServiceReferenceU> refs = context->GetServiceReferences(className, filter);
+  for(std::vector<ServiceReferenceU>::const_iterator iter = refs.begin();
+      iter != refs.end(); ++iter)
+  {
+    if (IsConvertible(*iter))
+    {
+      result.push_back(*iter);
+    }
+  }
+  return result;
+}
+
+bool ServiceTrackerPrivate::IsConvertible(const ServiceReferenceBase& reference) const
+{
+  if (!reference) return false;
+  return interfaceId.empty() || reference.IsConvertibleTo(interfaceId);
+}
+
+ServiceTrackerPrivate::Snapshot*
+ServiceTrackerPrivate::CreateSnapshot_unlocked(TrackedService* t)
+{
+  std::vector<RankedObject> ranked;
+  t->GetRanked(ranked);
+  Snapshot* snapshot = q_ptr->CreateSnapshot(t->GetTrackingCount());
+  if (ranked.empty())
+  {
+    return snapshot;
+  }
+  const int highestRanking = ranked.front().first.ranking;
+  // the services are in the order of GetServiceReferences()
+  std::sort(ranked.begin(), ranked.end(), &ServiceTrackerPrivate::CompareServiceIds);
+
+  snapshot->services.reserve(ranked.size());
+  snapshot->objects.reserve(ranked.size());
+  snapshot->loads.reserve(ranked.size());
+
+  MutexLock lock(cacheMutex);
+  // the load statistics of services which are no longer tracked are dropped
+  ServiceLoadMap loads;
+  for (std::vector<RankedObject>::const_iterator iter = ranked.begin();
+       iter != ranked.end(); ++iter)
+  {
+    TrackedObject* object = iter->second.Data();
+    object->ref.Ref(); /* the snapshot's reference */
+    snapshot->objects.push_back(object);
+    snapshot->services.push_back(object->object);
+
+    ServiceLoad* load = NULL;
+    ServiceLoadMap::iterator loadIter = serviceLoads.find(iter->first.id);
+    if (loadIter == serviceLoads.end())
+    {
+      load = new ServiceLoad(iter->first.id);
+      load->ref.Ref();
+    }
+    else
+    {
+      load = loadIter->second;
+      serviceLoads.erase(loadIter);
+    }
+    loads.insert(std::make_pair(iter->first.id, load));
+    load->ref.Ref(); /* the snapshot's reference */
+    snapshot->loads.push_back(load);
+    if (iter->first.ranking == highestRanking)
+    {
+      snapshot->candidates.push_back(load);
+      snapshot->candidateIndices.push_back(snapshot->services.size() - 1);
+    }
+  }
+  ReleaseServiceLoads_unlocked();
+  serviceLoads.swap(loads);
+  return snapshot;
+}
+
+bool ServiceTrackerPrivate::CompareServiceIds(const RankedObject& a, const RankedObject& b)
+{
+  return a.first.id < b.first.id;
+}
+
+void ServiceTrackerPrivate::ReleaseServiceLoads_unlocked()
+{
+  for (ServiceLoadMap::const_iterator iter = serviceLoads.begin();
+       iter != serviceLoads.end(); ++iter)
+  {
+    if (!iter->second->ref.Deref()) delete iter->second;
+  }
+  serviceLoads.clear();
+}
+
+TrackedService* ServiceTrackerPrivate::Tracked() const
+{
+  return trackedService;
+}
+
+void ServiceTrackerPrivate::Modified()
+{
+  SetCache(NULL, -1); /* clear cached value */
+  SetSnapshot(NULL);
+  US_DEBUG(DEBUG_OUTPUT) << "ServiceTracker::Modified(): " << filter;
+}
+
+TrackedObjectPointer ServiceTrackerPrivate::GetHighestRankedObject()
+{
+  TrackedObjectPointer object = GetCache();
+  if (object)
+  {
+    US_DEBUG(DEBUG_OUTPUT) << "ServiceTracker::getService[cached]:" << filter;
+    return object;
+  }
+  US_DEBUG(DEBUG_OUTPUT) << "ServiceTracker::getService:" << filter;
+
+  TrackedService* t = Tracked();
+  if (t == 0)
+  { /* if ServiceTracker is not open */
+    return object;
+  }
+  TrackedService::Lock lock(t); US_UNUSED(lock);
+  /* the tracked items are ordered by ranking and id, the highest
+   * ranking (lowest id) item is at the front */
+  object = t->GetHighestRanked();
+  if (object)
+  {
+    SetCache(object.Data(), t->GetTrackingCount());
+  }
+  return object;
+}
+
+TrackedObjectPointer ServiceTrackerPrivate::GetCache() const
+{
+  TrackedObjectPointer cache;
+  cachedService.Load(cache);
+  return cache;
+}
+
+void ServiceTrackerPrivate::SetCache(TrackedObject* cache, int trackingCount)
+{
+  MutexLock lock(cacheMutex);
+  if (cache != NULL)
+  {
+    // A concurrent modification already cleared the cache, this
+    // object may be stale. It is not published, the caller keeps
+    // its own reference.
+    TrackedService* t = Tracked();
+    if (t == 0 || t->GetTrackingCount() != trackingCount)
+    {
+      return;
+    }
+  }
+  cachedService.Store(cache);
+}
+
+ExplicitlySharedDataPointer<const ServiceTrackerPrivate::Snapshot>
+ServiceTrackerPrivate::GetSnapshot() const
+{
+  ExplicitlySharedDataPointer<const Snapshot> snapshot;
+  trackedSnapshot.Load(snapshot);
+  return snapshot;
+}
+
+void ServiceTrackerPrivate::SetSnapshot(Snapshot* snapshot)
+{
+  MutexLock lock(cacheMutex);
+  if (snapshot != NULL)
+  {
+    // A concurrent modification already cleared the snapshot, never
+    // publish one which is already stale.
+    TrackedService* t = Tracked();
+    if (t == 0 || t->GetTrackingCount() != snapshot->GetTrackingCount())
+    {
+      return;
+    }
+  }
+  trackedSnapshot.Store(snapshot);
+}
+
+void ServiceTrackerPrivate::WhenAvailable(const AvailableCallback& callback)
+{
+  {
+    MutexLock lock(availableCallbacksMutex);
+    availableCallbacks.push_back(callback);
+  }
+
+  /* a service may have been tracked before the callback was added */
+  TrackedObjectPointer object = GetHighestRankedObject();
+  if (object && RemoveAvailableCallback(callback.callback))
+  {
+    CallAvailable(callback, object->object);
+  }
+}
+
+bool ServiceTrackerPrivate::RemoveAvailableCallback(void* callback)
+{
+  MutexLock lock(availableCallbacksMutex);
+  for (std::list<AvailableCallback>::iterator iter = availableCallbacks.begin();
+       iter != availableCallbacks.end(); ++iter)
+  {
+    if (iter->callback == callback)
+    {
+      availableCallbacks.erase(iter);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ServiceTrackerPrivate::NotifyAvailable(const TrackedObject* object)
+{
+  std::list<AvailableCallback> callbacks;
+  {
+    MutexLock lock(availableCallbacksMutex);
+    if (availableCallbacks.empty()) return;
+    callbacks.swap(availableCallbacks);
+  }
+  for (std::list<AvailableCallback>::const_iterator iter = callbacks.begin();
+       iter != callbacks.end(); ++iter)
+  {
+    try
+    {
+      CallAvailable(*iter, object ? object->object : NULL);
+    }
+    catch (const std::exception& e)
+    {
+      US_WARN << "ServiceAvailableCallback threw an exception: " << e.what();
+    }
+  }
+}
+
+void ServiceTrackerPrivate::CallAvailable(const AvailableCallback& callback, const void* object)
+{
+  switch (callback.type)
+  {
+  case AVAILABLE_WAITER:
+    static_cast<ServiceAvailableWaiter*>(callback.callback)->ServiceAvailable();
+    break;
+  case AVAILABLE_FUTURE:
+  {
+    ServiceFuturePrivate* future = static_cast<ServiceFuturePrivate*>(callback.callback);
+    future->Done();
+    if (!future->ref.Deref()) delete future;
+    break;
+  }
+  default:
+    q_ptr->ServiceAvailable(callback.callback, object);
+  }
+}
+
+US_END_NAMESPACE
@@ -24,34 +24,88 @@
 #define USSERVICETRACKERPRIVATE_H
 
 #include "usServiceReference.h"
+#include "usServiceTracker.h"
 #include "usLDAPFilter.h"
+#include "usModuleAbstractTracked_p.h"
+#include "usUtils_p.h"
+
+#include <list>
 
 
 US_BEGIN_NAMESPACE
 
+class TrackedService;
+
+/**
+ * A callback which a thread can block on, used by
+ * ServiceTracker::WaitForService.
+ */
+class ServiceAvailableWaiter : public MultiThreaded<MutexLockingStrategy, WaitCondition>
+{
+
+public:
+
+  ServiceAvailableWaiter()
+    : notified(false)
+  {}
+
+  void ServiceAvailable()
+  {
+    Lock lock(this); US_UNUSED(lock);
+    notified = true;
+    this->NotifyAll();
+  }
+
+  /**
+   * Blocks until this waiter was notified or the deadline passed.
+   *
+   * @return <code>true</code> if this waiter was notified.
+   */
+  bool WaitNotified(const Deadline& deadline)
+  {
+    Lock lock(this); US_UNUSED(lock);
+#ifdef US_ENABLE_THREADING_SUPPORT
+    unsigned long remaining = 0;
+    while (!notified && deadline.Remaining(remaining))
+    {
+      if (!this->Wait(remaining)) break;
+    }
+#else
+    US_UNUSED(deadline);
+#endif
+    return notified;
+  }
+
+private:
+
+  bool notified;
+};
+
 /**
  * \ingroup MicroServices
  */
-template<class S, class TTT>
-class ServiceTrackerPrivate : MultiThreaded<>
+class ServiceTrackerPrivate : MultiThreaded<SharedMutexLockingStrategy>
 {
 
 public:
 
-  typedef typename TTT::TrackedType T;
+  typedef ServiceTrackerBase::ObjectDeleter ObjectDeleter;
 
-  ServiceTrackerPrivate(ServiceTracker<S,TTT>* st,
+  ServiceTrackerPrivate(ServiceTrackerBase* st,
                         ModuleContext* context,
-                        const ServiceReference<S>& reference,
-                        ServiceTrackerCustomizer<S,T>* customizer);
+                        const ServiceReferenceBase& reference,
+                        const std::string& interfaceId,
+                        ObjectDeleter objectDeleter);
 
-  ServiceTrackerPrivate(ServiceTracker<S,TTT>* st,
+  ServiceTrackerPrivate(ServiceTrackerBase* st,
                         ModuleContext* context, const std::string& clazz,
-                        ServiceTrackerCustomizer<S,T>* customizer);
+                        const std::string& interfaceId,
+                        ObjectDeleter objectDeleter);
 
-  ServiceTrackerPrivate(ServiceTracker<S,TTT>* st,
+  ServiceTrackerPrivate(ServiceTrackerBase* st,
                         ModuleContext* context, const LDAPFilter& filter,
-                        ServiceTrackerCustomizer<S,T>* customizer);
+                        const std::string& interfaceId,
+                        ObjectDeleter objectDeleter);
 
   ~ServiceTrackerPrivate();
 
@@ -61,16 +115,30 @@ public:
    *
    * @param className The class name with which the service was registered, or
    *        <code>null</code> for all services.
-   * @param filterString The filter criteria or <code>null</code> for all
-   *        services.
+   * @param filter The filter criteria or an invalid <code>LDAPFilter</code>
+   *        for all services.
    * @return The list of initial <code>ServiceReference</code>s.
-   * @throws std::invalid_argument If the specified filterString has an
-   *         invalid syntax.
    */
-  std::vector<ServiceReference<S> > GetInitialReferences(const std::string& className,
-                                                         const std::string& filterString);
+  std::vector<ServiceReferenceU> GetInitialReferences(const std::string& className,
+                                                      const LDAPFilter& filter);
+
+  /**
+   * Returns <code>true</code> if <code>reference</code> is valid and can be
+   * converted to a reference of the tracked interface.
+   */
+  bool IsConvertible(const ServiceReferenceBase& reference) const;
+
+  typedef ServiceTrackerSnapshotBase Snapshot;
+
+  /**
+   * Creates a snapshot of the services tracked by <code>t</code>. The
+   * caller must be synchronized on <code>t</code>.
+   */
+  Snapshot* CreateSnapshot_unlocked(TrackedService* t);
+
+  typedef ModuleAbstractTracked::RankedObject RankedObject;
 
-  void GetServiceReferences_unlocked(std::vector<ServiceReference<S> >& refs, TrackedService<S,TTT>* t) const;
+  static bool CompareServiceIds(const RankedObject& a, const RankedObject& b);
 
   /* set this to true to compile in debug messages */
   static const bool DEBUG_OUTPUT; // = false;
@@ -86,11 +154,6 @@ public:
    */
   LDAPFilter filter;
 
-  /**
-   * The <code>ServiceTrackerCustomizer</code> for this tracker.
-   */
-  ServiceTrackerCustomizer<S,T>* customizer;
-
   /**
    * Filter string for use when adding the ServiceListener. If this field is
    * set, then certain optimizations can be taken since we don't have a user
@@ -108,13 +171,27 @@ public:
    * Reference to be tracked. If this field is set, then we are tracking a
    * single ServiceReference.
    */
-  ServiceReference<S> trackReference;
+  ServiceReferenceU trackReference;
+
+  /**
+   * The interface id of the typed <code>ServiceTracker</code>, or an empty
+   * string if it tracks services of any type. Services which cannot be
+   * converted to this interface are not tracked.
+   */
+  const std::string interfaceId;
+
+  /**
+   * Deletes the objects created by the typed <code>ServiceTracker</code>.
+   * Snapshots may outlive the tracker, so the objects do not call back
+   * into it.
+   */
+  const ObjectDeleter objectDeleter;
 
   /**
    * Tracked services: <code>ServiceReference</code> -> customized Object and
    * <code>ServiceListenerEntry</code> object
    */
-  TrackedService<S,TTT>* trackedService;
+  TrackedService* trackedService;
 
   /**
    * Accessor method for the current TrackedService object. This method is only
@@ -123,7 +200,7 @@ public:
    *
    * @return The current Tracked object.
    */
-  TrackedService<S,TTT>* Tracked() const;
+  TrackedService* Tracked() const;
 
   /**
    * Called by the TrackedService object whenever the set of tracked services is
@@ -137,36 +214,146 @@ public:
   void Modified();
 
   /**
-   * Cached ServiceReference for getServiceReference.
+   * Returns the object of the highest ranking tracked service, from the
+   * cache if possible, or a null pointer if no service is tracked.
    */
-  mutable ServiceReference<S> cachedReference;
+  TrackedObjectPointer GetHighestRankedObject();
 
   /**
-   * Cached service object for GetService.
+   * Returns a handle to the cached object of the highest ranking tracked
+   * service or a null handle. Does not lock.
    */
-  mutable T cachedService;
+  TrackedObjectPointer GetCache() const;
 
+  /**
+   * Publishes <code>cache</code> as the object of the highest ranking
+   * service, unless the set of tracked services has been modified since
+   * <code>trackingCount</code> was read.
+   */
+  void SetCache(TrackedObject* cache, int trackingCount);
 
-private:
+  /**
+   * Cached object of the highest ranking service for GetServiceReference
+   * and GetService, replaced with cacheMutex held.
+   */
+  PublishedPointer<TrackedObject> cachedService;
+
+  /**
+   * Serializes publishing the cache and snapshots.
+   */
+  Mutex cacheMutex;
 
-  inline ServiceTracker<S,TTT>* q_func()
+  /**
+   * Returns a handle to the current snapshot of all tracked services, or
+   * a null handle. Does not lock.
+   */
+  ExplicitlySharedDataPointer<const Snapshot> GetSnapshot() const;
+
+  /**
+   * Publishes a new snapshot, unless the set of tracked services has been
+   * modified since it was created. A NULL <code>snapshot</code> clears the
+   * published one.
+   */
+  void SetSnapshot(Snapshot* snapshot);
+
+  /**
+   * The snapshot of all tracked services for GetTrackedSnapshot,
+   * replaced with cacheMutex held.
+   */
+  PublishedPointer<Snapshot> trackedSnapshot;
+
+  typedef std::map<long int, ServiceLoad*> ServiceLoadMap;
+
+  /**
+   * The load statistics of the tracked services by service id, guarded by
+   * cacheMutex. They are kept across snapshots and the tracker holds one
+   * reference to each.
+   */
+  ServiceLoadMap serviceLoads;
+
+  /**
+   * Releases the references of this tracker to the load statistics.
+   */
+  void ReleaseServiceLoads_unlocked();
+
+  /**
+   * The policy used by SelectService, or NULL to select the highest
+   * ranked service.
+   */
+  AtomicPointer<ServiceSelectionPolicy> selectionPolicy;
+
+  /**
+   * The kinds of objects notified when a service becomes available.
+   */
+  enum AvailableCallbackType
   {
-    return static_cast<ServiceTracker<S,TTT> *>(q_ptr);
-  }
+    /** A ServiceAvailableCallback registered with WhenAvailable */
+    AVAILABLE_CALLBACK,
+    /** A ServiceAvailableWaiter of WaitForService */
+    AVAILABLE_WAITER,
+    /** A ServiceFuturePrivate returned by WhenAvailable, holding one reference */
+    AVAILABLE_FUTURE
+  };
 
-  inline const ServiceTracker<S,TTT>* q_func() const
+  /**
+   * A callback registered with WhenAvailable, or a waiter of
+   * WaitForService.
+   */
+  struct AvailableCallback
   {
-    return static_cast<const ServiceTracker<S,TTT> *>(q_ptr);
-  }
+    AvailableCallback(void* callback, AvailableCallbackType type)
+      : callback(callback), type(type)
+    {}
 
-  friend class ServiceTracker<S,TTT>;
+    void* callback;
+    AvailableCallbackType type;
+  };
 
-  ServiceTracker<S,TTT> * const q_ptr;
+  /**
+   * Registers a callback to be notified once by NotifyAvailable(). If a
+   * service is already being tracked, the callback is notified before
+   * this method returns.
+   */
+  void WhenAvailable(const AvailableCallback& callback);
+
+  /**
+   * Removes a callback which has not been notified yet.
+   *
+   * @return <code>false</code> if the callback was not registered or is
+   *         being notified.
+   */
+  bool RemoveAvailableCallback(void* callback);
+
+  /**
+   * Calls and removes all registered callbacks. This method must not be
+   * called while synchronized on the tracker or its tracked services.
+   *
+   * @param object The object of the available service, or NULL if the
+   *        tracker was closed.
+   */
+  void NotifyAvailable(const TrackedObject* object);
+
+  /**
+   * Guards availableCallbacks.
+   */
+  Mutex availableCallbacksMutex;
+
+  /**
+   * Callbacks waiting for a service to become tracked.
+   */
+  std::list<AvailableCallback> availableCallbacks;
+
+
+private:
+
+  void CallAvailable(const AvailableCallback& callback, const void* object);
+
+  friend class ServiceTrackerBase;
+
+  ServiceTrackerBase * const q_ptr;
 
 };
 
 US_END_NAMESPACE
 
-#include "usServiceTrackerPrivate.tpp"
-
 #endif // USSERVICETRACKERPRIVATE_H
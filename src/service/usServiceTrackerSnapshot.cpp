@@ -0,0 +1,47 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usServiceTrackerSnapshot.h"
+
+#include "usModuleAbstractTracked_p.h"
+
+US_BEGIN_NAMESPACE
+
+ServiceTrackerSnapshotBase::ServiceTrackerSnapshotBase(int trackingCount)
+  : trackingCount(trackingCount)
+{
+}
+
+ServiceTrackerSnapshotBase::~ServiceTrackerSnapshotBase()
+{
+  for (std::vector<TrackedObject*>::const_iterator iter = objects.begin();
+       iter != objects.end(); ++iter)
+  {
+    if (!(*iter)->ref.Deref()) delete *iter;
+  }
+  for (std::vector<ServiceLoad*>::const_iterator iter = loads.begin();
+       iter != loads.end(); ++iter)
+  {
+    if (!(*iter)->ref.Deref()) delete *iter;
+  }
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,251 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+
+#ifndef USSERVICETRACKERSNAPSHOT_H
+#define USSERVICETRACKERSNAPSHOT_H
+
+#include "usServiceReference.h"
+#include "usServiceSelectionPolicy.h"
+#include "usSharedData.h"
+
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4251)
+#endif
+
+US_BEGIN_NAMESPACE
+
+class TrackedObject;
+
+/// \cond
+/*
+ * The object stored by a ServiceTracker for a tracked service. It is
+ * created by the typed ServiceTracker and only passed as void* to the
+ * non-template implementation.
+ */
+template<class S, class T>
+struct ServiceTrackerEntry
+{
+  ServiceTrackerEntry(const ServiceReference<S>& reference, const T& object)
+    : reference(reference), object(object)
+  {}
+
+  const ServiceReference<S> reference;
+  const T object;
+};
+/// \endcond
+
+/**
+ * \ingroup MicroServices
+ *
+ * The part of a <code>ServiceTrackerSnapshot</code> which does not depend
+ * on the type of the tracked services.
+ *
+ * \remarks This class is thread safe.
+ * @see ServiceTrackerSnapshot
+ */
+class US_EXPORT ServiceTrackerSnapshotBase : public SharedData
+{
+
+public:
+
+  virtual ~ServiceTrackerSnapshotBase();
+
+  /**
+   * @return The number of services which were tracked when this snapshot
+   *         was taken.
+   */
+  std::size_t Size() const
+  {
+    return services.size();
+  }
+
+  /**
+   * @return \c true if no services were tracked when this snapshot was taken.
+   */
+  bool IsEmpty() const
+  {
+    return services.empty();
+  }
+
+  /**
+   * The load statistics of the tracked services, in the order of
+   * <code>ServiceTracker::GetServiceReferences()</code>.
+   */
+  const std::vector<ServiceLoad*>& GetServiceLoads() const
+  {
+    return loads;
+  }
+
+  /**
+   * The load statistics of the services with the highest service ranking,
+   * ordered by ascending service id. These are the candidates of a
+   * <code>ServiceSelectionPolicy</code>.
+   */
+  const std::vector<ServiceLoad*>& GetCandidates() const
+  {
+    return candidates;
+  }
+
+  /**
+   * The tracking count of the <code>ServiceTracker</code> when this
+   * snapshot was taken.
+   */
+  int GetTrackingCount() const
+  {
+    return trackingCount;
+  }
+
+protected:
+
+  ServiceTrackerSnapshotBase(int trackingCount);
+
+  const void* GetObject(std::size_t index) const
+  {
+    return services[index];
+  }
+
+private:
+
+  friend class ServiceTrackerPrivate;
+  friend class ServiceTrackerBase;
+
+  std::vector<const void*> services;
+  std::vector<TrackedObject*> objects;
+  std::vector<ServiceLoad*> loads;
+  std::vector<ServiceLoad*> candidates;
+  // the index of each candidate in services
+  std::vector<std::size_t> candidateIndices;
+  const int trackingCount;
+
+  // purposely not implemented
+  ServiceTrackerSnapshotBase(const ServiceTrackerSnapshotBase&);
+  ServiceTrackerSnapshotBase& operator=(const ServiceTrackerSnapshotBase&);
+};
+
+/**
+ * \ingroup MicroServices
+ *
+ * An immutable snapshot of the services tracked by a <code>ServiceTracker</code>.
+ *
+ * <p>
+ * A snapshot is returned by <code>ServiceTracker::GetTrackedSnapshot</code>.
+ * It is shared by all callers until the set of tracked services is modified,
+ * after which the next call returns a new snapshot. Callers which hold on to
+ * a snapshot keep it alive, but it does not change when the tracker does.
+ *
+ * <p>
+ * Iterate over a snapshot with Size(), GetServiceReference(std::size_t) and
+ * GetService(std::size_t), which neither allocate nor synchronize.
+ *
+ * \tparam S The type of the service being tracked
+ * \tparam T The type of the tracked object.
+ * \remarks This class is thread safe.
+ * @see ServiceTracker::GetTrackedSnapshot
+ */
+template<class S, class T = S*>
+class ServiceTrackerSnapshot : public ServiceTrackerSnapshotBase
+{
+
+public:
+
+  typedef S ServiceType;
+  typedef T TrackedType;
+  typedef ServiceReference<ServiceType> ServiceReferenceType;
+
+  /**
+   * The reference of a tracked service. The references are in the order of
+   * <code>ServiceTracker::GetServiceReferences()</code>.
+   *
+   * @param index The index of the service, less than Size().
+   */
+  const ServiceReferenceType& GetServiceReference(std::size_t index) const
+  {
+    return GetEntry(index)->reference;
+  }
+
+  /**
+   * The tracked object of the service with the reference returned by
+   * <code>GetServiceReference(index)</code>.
+   *
+   * @param index The index of the service, less than Size().
+   */
+  const TrackedType& GetService(std::size_t index) const
+  {
+    return GetEntry(index)->object;
+  }
+
+  /**
+   * Copies the references of the tracked services, in the order of
+   * <code>ServiceTracker::GetServiceReferences()</code>.
+   */
+  std::vector<ServiceReferenceType> GetServiceReferences() const
+  {
+    std::vector<ServiceReferenceType> references;
+    references.reserve(Size());
+    for (std::size_t i = 0; i < Size(); ++i)
+    {
+      references.push_back(GetServiceReference(i));
+    }
+    return references;
+  }
+
+  /**
+   * Copies the tracked objects, in the same order as the references returned
+   * by GetServiceReferences().
+   */
+  std::vector<TrackedType> GetServices() const
+  {
+    std::vector<TrackedType> services;
+    services.reserve(Size());
+    for (std::size_t i = 0; i < Size(); ++i)
+    {
+      services.push_back(GetService(i));
+    }
+    return services;
+  }
+
+private:
+
+  template<class S2, class TTT> friend class ServiceTracker;
+
+  typedef ServiceTrackerEntry<S,T> Entry;
+
+  ServiceTrackerSnapshot(int trackingCount)
+    : ServiceTrackerSnapshotBase(trackingCount)
+  {}
+
+  const Entry* GetEntry(std::size_t index) const
+  {
+    return static_cast<const Entry*>(GetObject(index));
+  }
+};
+
+US_END_NAMESPACE
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif // USSERVICETRACKERSNAPSHOT_H
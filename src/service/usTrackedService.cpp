@@ -19,18 +19,20 @@
 
 =============================================================================*/
 
+#include "usTrackedService_p.h"
+
+#include "usServiceTracker.h"
+#include "usServiceTrackerPrivate.h"
+
 US_BEGIN_NAMESPACE
 
-template<class S, class TTT>
-TrackedService<S,TTT>::TrackedService(ServiceTracker<S,TTT>* serviceTracker,
-                  ServiceTrackerCustomizer<S,T>* customizer)
-  : serviceTracker(serviceTracker), customizer(customizer)
+TrackedService::TrackedService(ServiceTrackerBase* serviceTracker)
+  : serviceTracker(serviceTracker)
 {
 
 }
 
-template<class S, class TTT>
-void TrackedService<S,TTT>::ServiceChanged(const ServiceEvent event)
+void TrackedService::ServiceChanged(const ServiceEvent event)
 {
   /*
    * Check if we had a delayed call (which could happen when we
@@ -41,10 +43,10 @@ void TrackedService<S,TTT>::ServiceChanged(const ServiceEvent event)
     return;
   }
 
-  ServiceReference<S> reference = event.GetServiceReference(InterfaceType<S>());
+  ServiceReferenceU reference = event.GetServiceReference();
   US_DEBUG(serviceTracker->d->DEBUG_OUTPUT) << "TrackedService::ServiceChanged["
                                             << event.GetType() << "]: " << reference;
-  if (!reference)
+  if (!serviceTracker->d->IsConvertible(reference))
   {
     return;
   }
@@ -94,35 +96,57 @@ void TrackedService<S,TTT>::ServiceChanged(const ServiceEvent event)
   }
 }
 
-template<class S, class TTT>
-void TrackedService<S,TTT>::Modified()
+void TrackedService::Modified()
 {
-  Superclass::Modified(); /* increment the modification count */
+  ModuleAbstractTracked::Modified(); /* increment the modification count */
   serviceTracker->d->Modified();
 }
 
-template<class S, class TTT>
-typename TrackedService<S,TTT>::T
-TrackedService<S,TTT>::CustomizerAdding(ServiceReference<S> item,
-                                        const ServiceEvent& /*related*/)
+TrackedObjectPointer TrackedService::CustomizerAdding(ServiceReferenceU item,
+                                                      const ServiceEvent& /*related*/)
+{
+  void* object = serviceTracker->AddingObject(item);
+  if (object == NULL)
+  {
+    return TrackedObjectPointer();
+  }
+  return TrackedObjectPointer(new TrackedObject(object, serviceTracker->d->objectDeleter));
+}
+
+void TrackedService::CustomizerModified(ServiceReferenceU /*item*/,
+                                        const ServiceEvent& /*related*/,
+                                        const TrackedObjectPointer& object)
 {
-  return customizer->AddingService(item);
+  serviceTracker->ModifiedObject(object->object);
 }
 
-template<class S, class TTT>
-void TrackedService<S,TTT>::CustomizerModified(ServiceReference<S> item,
-                                               const ServiceEvent& /*related*/,
-                                               T object)
+void TrackedService::CustomizerRemoved(ServiceReferenceU /*item*/,
+                                       const ServiceEvent& /*related*/,
+                                       const TrackedObjectPointer& object)
 {
-  customizer->ModifiedService(item, object);
+  serviceTracker->RemovedObject(object->object);
 }
 
-template<class S, class TTT>
-void TrackedService<S,TTT>::CustomizerRemoved(ServiceReference<S> item,
-                                              const ServiceEvent& /*related*/,
-                                              T object)
+void TrackedService::ItemAdded(ServiceReferenceU /*item*/, const TrackedObjectPointer& object)
 {
-  customizer->RemovedService(item, object);
+  serviceTracker->d->NotifyAvailable(object.ConstData());
+}
+
+TrackedService::RankingKey TrackedService::GetRankingKey(ServiceReferenceU item) const
+{
+  int ranking = 0;
+  long int id = 0;
+  Any rankingAny = item.GetProperty(ServiceConstants::SERVICE_RANKING());
+  if (rankingAny.Type() == typeid(int))
+  {
+    ranking = any_cast<int>(rankingAny);
+  }
+  Any idAny = item.GetProperty(ServiceConstants::SERVICE_ID());
+  if (idAny.Type() == typeid(long int))
+  {
+    id = any_cast<long int>(idAny);
+  }
+  return RankingKey(ranking, id);
 }
 
 US_END_NAMESPACE
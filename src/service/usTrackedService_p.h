@@ -29,21 +29,19 @@
 
 US_BEGIN_NAMESPACE
 
+class ServiceTrackerBase;
+
 /**
  * This class is not intended to be used directly. It is exported to support
  * the CppMicroServices module system.
  */
-template<class S, class TTT>
 class TrackedService : public TrackedServiceListener,
-    public ModuleAbstractTracked<ServiceReference<S>, TTT, ServiceEvent>
+    public ModuleAbstractTracked
 {
 
 public:
 
-  typedef typename TTT::TrackedType T;
-
-  TrackedService(ServiceTracker<S,TTT>* serviceTracker,
-                 ServiceTrackerCustomizer<S,T>* customizer);
+  TrackedService(ServiceTrackerBase* serviceTracker);
 
   /**
    * Method connected to service events for the
@@ -56,10 +54,7 @@ public:
 
 private:
 
-  typedef ModuleAbstractTracked<ServiceReference<S>, TTT, ServiceEvent> Superclass;
-
-  ServiceTracker<S,TTT>* serviceTracker;
-  ServiceTrackerCustomizer<S,T>* customizer;
+  ServiceTrackerBase* serviceTracker;
 
   /**
    * Increment the tracking count and tell the tracker there was a
@@ -78,7 +73,7 @@ private:
    * @return Customized object for the tracked item or <code>null</code>
    *         if the item is not to be tracked.
    */
-  T CustomizerAdding(ServiceReference<S> item, const ServiceEvent& related);
+  TrackedObjectPointer CustomizerAdding(ServiceReferenceU item, const ServiceEvent& related);
 
   /**
    * Call the specific customizer modified method. This method must not be
@@ -88,8 +83,8 @@ private:
    * @param related Action related object.
    * @param object Customized object for the tracked item.
    */
-  void CustomizerModified(ServiceReference<S> item,
-                          const ServiceEvent& related, T object) ;
+  void CustomizerModified(ServiceReferenceU item,
+                          const ServiceEvent& related, const TrackedObjectPointer& object) ;
 
   /**
    * Call the specific customizer removed method. This method must not be
@@ -99,12 +94,27 @@ private:
    * @param related Action related object.
    * @param object Customized object for the tracked item.
    */
-  void CustomizerRemoved(ServiceReference<S> item,
-                         const ServiceEvent& related, T object) ;
+  void CustomizerRemoved(ServiceReferenceU item,
+                         const ServiceEvent& related, const TrackedObjectPointer& object) ;
+
+  /**
+   * Notify the tracker's availability callbacks about the added service.
+   *
+   * @param item Tracked item.
+   * @param object Customized object for the tracked item.
+   */
+  void ItemAdded(ServiceReferenceU item, const TrackedObjectPointer& object);
+
+  /**
+   * Read the service ranking and service id of the specified reference.
+   *
+   * @param item Tracked item.
+   * @return The ranking key of the tracked item.
+   */
+  RankingKey GetRankingKey(ServiceReferenceU item) const;
+
 };
 
 US_END_NAMESPACE
 
-#include "usTrackedService.tpp"
-
 #endif // USTRACKEDSERVICE_H
@@ -34,8 +34,10 @@ DEALINGS IN THE SOFTWARE.
 #define US_ANY_H
 
 #include <algorithm>
+#include <new>
 #include <typeinfo>
 #include <sstream>
+#include <string>
 #include <vector>
 #include <list>
 #include <map>
@@ -50,12 +52,84 @@ std::string any_value_to_string(const T& val);
 US_EXPORT std::string any_value_to_string(const std::vector<std::string>& val);
 US_EXPORT std::string any_value_to_string(const std::list<std::string>& val);
 
+class Any;
+
+/**
+ * \ingroup MicroServicesUtils
+ *
+ * Tags for the value types commonly used as service properties. Code
+ * which handles these types can switch on Any::TypeTag() instead of
+ * comparing <code>std::type_info</code> objects. All other types are
+ * tagged with <code>ANY_TYPE_OTHER</code>.
+ */
+enum AnyTypeTag
+{
+  ANY_TYPE_EMPTY = 0,
+  ANY_TYPE_BOOL,
+  ANY_TYPE_CHAR,
+  ANY_TYPE_SHORT,
+  ANY_TYPE_INT,
+  ANY_TYPE_LONG,
+  ANY_TYPE_LONG_LONG,
+  ANY_TYPE_UNSIGNED_CHAR,
+  ANY_TYPE_UNSIGNED_SHORT,
+  ANY_TYPE_UNSIGNED_INT,
+  ANY_TYPE_UNSIGNED_LONG,
+  ANY_TYPE_UNSIGNED_LONG_LONG,
+  ANY_TYPE_FLOAT,
+  ANY_TYPE_DOUBLE,
+  ANY_TYPE_STRING,
+  ANY_TYPE_STRING_VECTOR,
+  ANY_TYPE_STRING_LIST,
+  ANY_TYPE_ANY_VECTOR,
+  ANY_TYPE_OTHER
+};
+
+/**
+ * \ingroup MicroServicesUtils
+ *
+ * Maps a type to its AnyTypeTag.
+ */
+template<typename T>
+struct any_type_tag { static const AnyTypeTag value = ANY_TYPE_OTHER; };
+
+#define US_ANY_TYPE_TAG(type, tag) \
+  template<> struct any_type_tag<type > { static const AnyTypeTag value = tag; };
+
+US_ANY_TYPE_TAG(bool, ANY_TYPE_BOOL)
+US_ANY_TYPE_TAG(char, ANY_TYPE_CHAR)
+US_ANY_TYPE_TAG(short, ANY_TYPE_SHORT)
+US_ANY_TYPE_TAG(int, ANY_TYPE_INT)
+US_ANY_TYPE_TAG(long int, ANY_TYPE_LONG)
+US_ANY_TYPE_TAG(long long int, ANY_TYPE_LONG_LONG)
+US_ANY_TYPE_TAG(unsigned char, ANY_TYPE_UNSIGNED_CHAR)
+US_ANY_TYPE_TAG(unsigned short, ANY_TYPE_UNSIGNED_SHORT)
+US_ANY_TYPE_TAG(unsigned int, ANY_TYPE_UNSIGNED_INT)
+US_ANY_TYPE_TAG(unsigned long int, ANY_TYPE_UNSIGNED_LONG)
+US_ANY_TYPE_TAG(unsigned long long int, ANY_TYPE_UNSIGNED_LONG_LONG)
+US_ANY_TYPE_TAG(float, ANY_TYPE_FLOAT)
+US_ANY_TYPE_TAG(double, ANY_TYPE_DOUBLE)
+US_ANY_TYPE_TAG(std::string, ANY_TYPE_STRING)
+US_ANY_TYPE_TAG(std::vector<std::string>, ANY_TYPE_STRING_VECTOR)
+US_ANY_TYPE_TAG(std::list<std::string>, ANY_TYPE_STRING_LIST)
+US_ANY_TYPE_TAG(std::vector<Any>, ANY_TYPE_ANY_VECTOR)
+
+#undef US_ANY_TYPE_TAG
+
 /**
  * \ingroup MicroServicesUtils
  *
  * An Any class represents a general type and is capable of storing any type, supporting type-safe extraction
  * of the internally stored data.
  *
+ * Values of the scalar types and <code>std::string</code> listed in AnyTypeTag are
+ * stored inside the Any object itself, without a separate heap allocation.
+ *
+ * \note The inline storage makes <code>sizeof(Any)</code> larger than in
+ * CppMicroServices 2.1 and earlier (one pointer). This is a binary incompatible
+ * change: code passing Any objects across a library boundary must be rebuilt
+ * against this header.
+ *
  * Code taken from the Boost 1.46.1 library. Original copyright by Kevlin Henney. Modified for CppMicroServices.
  */
 class Any
@@ -65,7 +139,7 @@ public:
   /**
    * Creates an empty any type.
    */
-  Any(): _content(0)
+  Any(): _content(0), _tag(ANY_TYPE_EMPTY)
   { }
 
   /**
@@ -81,7 +155,9 @@ public:
    */
   template <typename ValueType>
   Any(const ValueType& value)
-    : _content(new Holder<ValueType>(value))
+    : _content(IsInlineType<ValueType>::value ? new (_storage.buffer) Holder<ValueType>(value)
+                                               : new Holder<ValueType>(value))
+    , _tag(any_type_tag<ValueType>::value)
   { }
 
   /**
@@ -90,22 +166,34 @@ public:
    * \param other The Any to copy
    */
   Any(const Any& other)
-    : _content(other._content ? other._content->Clone() : 0)
+    : _content(other._content ? other._content->Clone(other.IsInline() ? _storage.buffer : 0) : 0)
+    , _tag(other._tag)
   { }
 
   ~Any()
   {
-    delete _content;
+    Destroy();
   }
 
   /**
    * Swaps the content of the two Anys.
    *
+   * This function does not throw.
+   *
    * \param rhs The Any to swap this Any with.
    */
   Any& Swap(Any& rhs)
   {
-    std::swap(_content, rhs._content);
+    if (this == &rhs) return *this;
+
+    // inline content cannot be exchanged by swapping pointers; it is
+    // relocated through a scratch buffer instead, which does not throw
+    Storage scratch;
+    Placeholder* content = IsInline() ? _content->Relocate(scratch.buffer) : _content;
+    _content = rhs.IsInline() ? rhs._content->Relocate(_storage.buffer) : rhs._content;
+    rhs._content = (content && static_cast<void*>(content) == static_cast<void*>(scratch.buffer))
+        ? content->Relocate(rhs._storage.buffer) : content;
+    std::swap(_tag, rhs._tag);
     return *this;
   }
 
@@ -168,6 +256,16 @@ public:
     return _content ? _content->Type() : typeid(void);
   }
 
+  /**
+   * Returns the tag of the stored content. If the Any is empty
+   * <code>ANY_TYPE_EMPTY</code> is returned, for types without a
+   * dedicated tag <code>ANY_TYPE_OTHER</code>.
+   */
+  AnyTypeTag TypeTag() const
+  {
+    return _tag;
+  }
+
 private:
 
   class Placeholder
@@ -179,7 +277,13 @@ private:
     virtual std::string ToString() const = 0;
 
     virtual const std::type_info& Type() const = 0;
-    virtual Placeholder* Clone() const = 0;
+
+    // Copies the content into buffer or, if buffer is NULL, onto the heap
+    virtual Placeholder* Clone(void* buffer) const = 0;
+
+    // Moves inline content into buffer without throwing and destroys this
+    // placeholder. Only called for content stored inside an Any.
+    virtual Placeholder* Relocate(void* buffer) = 0;
   };
 
   template <typename ValueType>
@@ -200,9 +304,14 @@ private:
       return typeid(ValueType);
     }
 
-    virtual Placeholder* Clone() const
+    virtual Placeholder* Clone(void* buffer) const
+    {
+      return buffer ? new (buffer) Holder(_held) : new Holder(_held);
+    }
+
+    virtual Placeholder* Relocate(void* buffer)
     {
-      return new Holder(_held);
+      return Relocator<ValueType, IsInlineType<ValueType>::value>::Relocate(this, buffer);
     }
 
     ValueType _held;
@@ -211,6 +320,58 @@ private:
     Holder& operator=(const Holder &);
   };
 
+  // Relocation for the inline types, which are default constructible
+  // and have a non-throwing swap
+  template <typename ValueType, bool Inline>
+  struct Relocator
+  {
+    static Holder<ValueType>* Relocate(Holder<ValueType>* holder, void* buffer)
+    {
+      Holder<ValueType>* relocated = new (buffer) Holder<ValueType>(ValueType());
+      std::swap(relocated->_held, holder->_held);
+      holder->~Holder<ValueType>();
+      return relocated;
+    }
+  };
+
+  template <typename ValueType>
+  struct Relocator<ValueType, false>
+  {
+    static Holder<ValueType>* Relocate(Holder<ValueType>*, void*)
+    {
+      return 0;
+    }
+  };
+
+  // Storage for inline content, aligned for the scalar types and pointers
+  union Storage
+  {
+    double d;
+    long long int ll;
+    void* p;
+    char buffer[sizeof(void*) + sizeof(std::string)];
+  };
+
+  template <typename ValueType>
+  struct IsInlineType
+  {
+    static const bool value = any_type_tag<ValueType>::value <= ANY_TYPE_STRING &&
+                              sizeof(Holder<ValueType>) <= sizeof(Storage);
+  };
+
+  bool IsInline() const
+  {
+    return _content && static_cast<const void*>(_content) == static_cast<const void*>(_storage.buffer);
+  }
+
+  void Destroy()
+  {
+    if (IsInline()) _content->~Placeholder();
+    else delete _content;
+    _content = 0;
+    _tag = ANY_TYPE_EMPTY;
+  }
+
 private:
     template <typename ValueType>
     friend ValueType* any_cast(Any*);
@@ -219,6 +380,8 @@ private:
     friend ValueType* unsafe_any_cast(Any*);
 
     Placeholder* _content;
+    AnyTypeTag _tag;
+    Storage _storage;
 };
 
 class BadAnyCastException : public std::bad_cast
@@ -258,9 +421,12 @@ private:
 template <typename ValueType>
 ValueType* any_cast(Any* operand)
 {
-  return operand && operand->Type() == typeid(ValueType)
-      ? &static_cast<Any::Holder<ValueType>*>(operand->_content)->_held
-      : 0;
+  if (!operand) return 0;
+  // tagged types are identified without comparing type_info objects
+  const bool match = any_type_tag<ValueType>::value != ANY_TYPE_OTHER
+      ? operand->_tag == any_type_tag<ValueType>::value
+      : operand->Type() == typeid(ValueType);
+  return match ? &static_cast<Any::Holder<ValueType>*>(operand->_content)->_held : 0;
 }
 
 /**
@@ -66,11 +66,7 @@ public:
    *
    */
   inline operator int() const
-  {
-    IntType curr(0);
-    AtomicAssign(curr);
-    return curr;
-  }
+  { return static_cast<int>(Load()); }
 
 };
 
@@ -21,30 +21,65 @@
 
 #include "usLDAPProp.h"
 
+#include "usLDAPExpr_p.h"
+
 #include <stdexcept>
 
 US_BEGIN_NAMESPACE
 
+namespace {
+
+bool IsEmptyValue(const Any& any)
+{
+  return any.Empty() ||
+      (any.Type() == typeid(std::string) && ref_any_cast<std::string>(any).empty());
+}
+
+LDAPExpr MakeNot(const LDAPExpr& expr)
+{
+  return LDAPExpr(LDAPExpr::NOT, std::vector<LDAPExpr>(1, expr));
+}
+
+}
+
 LDAPPropExpr::LDAPPropExpr(const std::string& expr)
-  : m_ldapExpr(expr)
+  : m_ldapExpr(new LDAPExpr(expr.empty() ? LDAPExpr() : LDAPExpr(expr)))
 {}
 
+LDAPPropExpr::LDAPPropExpr(const LDAPExpr& expr)
+  : m_ldapExpr(new LDAPExpr(expr))
+{}
+
+LDAPPropExpr::LDAPPropExpr(const LDAPPropExpr& other)
+  : m_ldapExpr(new LDAPExpr(*other.m_ldapExpr))
+{}
+
+LDAPPropExpr::~LDAPPropExpr()
+{
+  delete m_ldapExpr;
+}
+
 LDAPPropExpr& LDAPPropExpr::operator!()
 {
-  if (m_ldapExpr.empty()) return *this;
+  if (m_ldapExpr->IsNull()) return *this;
 
-  m_ldapExpr = "(!" + m_ldapExpr + ")";
+  *m_ldapExpr = MakeNot(*m_ldapExpr);
   return *this;
 }
 
 LDAPPropExpr::operator std::string() const
 {
-  return m_ldapExpr;
+  return m_ldapExpr->IsNull() ? std::string() : m_ldapExpr->ToString();
 }
 
 bool LDAPPropExpr::IsNull() const
 {
-  return m_ldapExpr.empty();
+  return m_ldapExpr->IsNull();
+}
+
+const LDAPExpr& LDAPPropExpr::GetExpr() const
+{
+  return *m_ldapExpr;
 }
 
 
@@ -57,66 +92,71 @@ LDAPProp::LDAPProp(const std::string& property)
 LDAPPropExpr LDAPProp::operator==(const std::string& s) const
 {
   if (s.empty()) return LDAPPropExpr(s);
-  return LDAPPropExpr("(" + m_property + "=" + s + ")");
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, s));
 }
 
 LDAPPropExpr LDAPProp::operator==(const us::Any& any) const
 {
-  return operator==(any.ToString());
+  if (IsEmptyValue(any)) return LDAPPropExpr(std::string());
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, any));
 }
 
 LDAPProp::operator LDAPPropExpr () const
 {
-  return LDAPPropExpr("(" + m_property + "=*)");
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, std::string("*")));
 }
 
 LDAPPropExpr LDAPProp::operator!() const
 {
-  return LDAPPropExpr("(!(" + m_property + "=*))");
+  return LDAPPropExpr(MakeNot(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, std::string("*"))));
 }
 
 LDAPPropExpr LDAPProp::operator!=(const std::string& s) const
 {
   if (s.empty()) return LDAPPropExpr(s);
-  return LDAPPropExpr("(!(" + m_property + "=" + s + "))");
+  return LDAPPropExpr(MakeNot(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, s)));
 }
 
 LDAPPropExpr LDAPProp::operator!=(const us::Any& any) const
 {
-  return operator!=(any.ToString());
+  if (IsEmptyValue(any)) return LDAPPropExpr(std::string());
+  return LDAPPropExpr(MakeNot(LDAPExpr::MakeSimple(LDAPExpr::EQ, m_property, any)));
 }
 
 LDAPPropExpr LDAPProp::operator>=(const std::string& s) const
 {
   if (s.empty()) return LDAPPropExpr(s);
-  return LDAPPropExpr("(" + m_property + ">=" + s + ")");
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::GE, m_property, s));
 }
 
 LDAPPropExpr LDAPProp::operator>=(const us::Any& any) const
 {
-  return operator>=(any.ToString());
+  if (IsEmptyValue(any)) return LDAPPropExpr(std::string());
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::GE, m_property, any));
 }
 
 LDAPPropExpr LDAPProp::operator<=(const std::string& s) const
 {
   if (s.empty()) return LDAPPropExpr(s);
-  return LDAPPropExpr("(" + m_property + "<=" + s + ")");
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::LE, m_property, s));
 }
 
 LDAPPropExpr LDAPProp::operator<=(const us::Any& any) const
 {
-  return operator<=(any.ToString());
+  if (IsEmptyValue(any)) return LDAPPropExpr(std::string());
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::LE, m_property, any));
 }
 
 LDAPPropExpr LDAPProp::Approx(const std::string& s) const
 {
   if (s.empty()) return LDAPPropExpr(s);
-  return LDAPPropExpr("(" + m_property + "~=" + s + ")");
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::APPROX, m_property, s));
 }
 
 LDAPPropExpr LDAPProp::Approx(const us::Any& any) const
 {
-  return Approx(any.ToString());
+  if (IsEmptyValue(any)) return LDAPPropExpr(std::string());
+  return LDAPPropExpr(LDAPExpr::MakeSimple(LDAPExpr::APPROX, m_property, any));
 }
 
 US_END_NAMESPACE
@@ -125,12 +165,18 @@ us::LDAPPropExpr operator&&(const us::LDAPPropExpr& left, const us::LDAPPropExpr
 {
   if (left.IsNull()) return right;
   if (right.IsNull()) return left;
-  return us::LDAPPropExpr("(&" + static_cast<std::string>(left) + static_cast<std::string>(right) + ")");
+  std::vector<us::LDAPExpr> args;
+  args.push_back(left.GetExpr());
+  args.push_back(right.GetExpr());
+  return us::LDAPPropExpr(us::LDAPExpr(us::LDAPExpr::AND, args));
 }
 
 us::LDAPPropExpr operator||(const us::LDAPPropExpr& left, const us::LDAPPropExpr& right)
 {
   if (left.IsNull()) return right;
   if (right.IsNull()) return left;
-  return us::LDAPPropExpr("(|" + static_cast<std::string>(left) + static_cast<std::string>(right) + ")");
+  std::vector<us::LDAPExpr> args;
+  args.push_back(left.GetExpr());
+  args.push_back(right.GetExpr());
+  return us::LDAPPropExpr(us::LDAPExpr(us::LDAPExpr::OR, args));
 }
@@ -25,6 +25,8 @@
 #include <usConfig.h>
 #include <usAny.h>
 
+#include <sstream>
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -32,6 +34,34 @@
 
 US_BEGIN_NAMESPACE
 
+class LDAPExpr;
+
+/// \cond
+// Converts the operands of LDAPProp operators. Types without an AnyTypeTag
+// are formatted with operator<<, so they need not be copyable into an Any.
+template<bool Tagged>
+struct LDAPPropValue
+{
+  template<class T>
+  static Any ToAny(const T& value)
+  {
+    std::stringstream ss;
+    ss << value;
+    return Any(ss.str());
+  }
+};
+
+template<>
+struct LDAPPropValue<true>
+{
+  template<class T>
+  static Any ToAny(const T& value)
+  {
+    return Any(value);
+  }
+};
+/// \endcond
+
 /// \cond
 class US_EXPORT LDAPPropExpr
 {
@@ -39,17 +69,25 @@ public:
 
   explicit LDAPPropExpr(const std::string& expr);
 
+  explicit LDAPPropExpr(const LDAPExpr& expr);
+
+  LDAPPropExpr(const LDAPPropExpr& other);
+
+  ~LDAPPropExpr();
+
   LDAPPropExpr& operator!();
 
   operator std::string() const;
 
   bool IsNull() const;
 
+  const LDAPExpr& GetExpr() const;
+
 private:
 
   LDAPPropExpr& operator=(const LDAPPropExpr&);
 
-  std::string m_ldapExpr;
+  LDAPExpr* m_ldapExpr;
 };
 /// \endcond
 
@@ -58,6 +96,14 @@ private:
  *
  * A fluent API for creating LDAP filter strings.
  *
+ * The expressions are compiled while they are built, there is no need to
+ * format and re-parse a filter string. Values of boolean and numeric
+ * types are kept as such and are compared with boolean and numeric
+ * service properties directly. Pass the expression to
+ * LDAPFilter::LDAPFilter(const LDAPPropExpr&) to use the compiled form,
+ * e.g. with ServiceTracker or ModuleContext::GetServiceReferences(const std::string&, const LDAPFilter&).
+ * The expressions are still convertible to a filter string.
+ *
  * Examples for creating LDAPFilter objects:
  * \code
  * // This creates the filter "(&(name=Ben)(!(count=1)))"
@@ -68,6 +114,9 @@ private:
  *
  * // This creates the filter "(&(ge>=-3)(approx~=hi))"
  * LDAPFilter filter(LDAPProp("ge") >= -3 && LDAPProp("approx").Approx("hi"));
+ *
+ * // The integer 8080 is compared with the "port" property without string conversions
+ * std::vector<ServiceReferenceU> refs = context->GetServiceReferences("", LDAPFilter(LDAPProp("port") >= 8080));
  * \endcode
  *
  * \sa LDAPFilter
@@ -86,7 +135,10 @@ public:
   /**
    * LDAP equality '='
    *
-   * @param s A type convertible to std::string.
+   * @param s A std::string, us::Any or a value of another type. Values of the
+   *        types listed in AnyTypeTag are compared as typed values, values
+   *        of other types are written to a std::ostream and compared as
+   *        strings.
    * @return A LDAP expression object.
    *
    * @{
@@ -96,9 +148,7 @@ public:
   template<class T>
   LDAPPropExpr operator==(const T& s) const
   {
-    std::stringstream ss;
-    ss << s;
-    return LDAPPropExpr("(" + m_property + "=" + ss.str() + ")");
+    return operator==(ToAny(s));
   }
   /// @}
 
@@ -124,7 +174,10 @@ public:
    * \endcode
    * leads to the same string "(!(attr=val))".
    *
-   * @param s A type convertible to std::string.
+   * @param s A std::string, us::Any or a value of another type. Values of the
+   *        types listed in AnyTypeTag are compared as typed values, values
+   *        of other types are written to a std::ostream and compared as
+   *        strings.
    * @return A LDAP expression object.
    *
    * @{
@@ -134,16 +187,17 @@ public:
   template<class T>
   LDAPPropExpr operator!=(const T& s) const
   {
-    std::stringstream ss;
-    ss << s;
-    return operator!=(ss.str());
+    return operator!=(ToAny(s));
   }
   /// @}
 
   /**
    * LDAP greater or equal '>='
    *
-   * @param s A type convertible to std::string.
+   * @param s A std::string, us::Any or a value of another type. Values of the
+   *        types listed in AnyTypeTag are compared as typed values, values
+   *        of other types are written to a std::ostream and compared as
+   *        strings.
    * @return A LDAP expression object.
    *
    * @{
@@ -153,16 +207,17 @@ public:
   template<class T>
   LDAPPropExpr operator>=(const T& s) const
   {
-    std::stringstream ss;
-    ss << s;
-    return operator>=(ss.str());
+    return operator>=(ToAny(s));
   }
   /// @}
 
   /**
    * LDAP less or equal '<='
    *
-   * @param s A type convertible to std::string.
+   * @param s A std::string, us::Any or a value of another type. Values of the
+   *        types listed in AnyTypeTag are compared as typed values, values
+   *        of other types are written to a std::ostream and compared as
+   *        strings.
    * @return A LDAP expression object.
    *
    * @{
@@ -172,16 +227,17 @@ public:
   template<class T>
   LDAPPropExpr operator<=(const T& s) const
   {
-    std::stringstream ss;
-    ss << s;
-    return operator<=(ss.str());
+    return operator<=(ToAny(s));
   }
   /// @}
 
   /**
    * LDAP approximation '~='
    *
-   * @param s A type convertible to std::string.
+   * @param s A std::string, us::Any or a value of another type. Values of the
+   *        types listed in AnyTypeTag are compared as typed values, values
+   *        of other types are written to a std::ostream and compared as
+   *        strings.
    * @return A LDAP expression object.
    *
    * @{
@@ -191,14 +247,23 @@ public:
   template<class T>
   LDAPPropExpr Approx(const T& s) const
   {
-    std::stringstream ss;
-    ss << s;
-    return Approx(ss.str());
+    return Approx(ToAny(s));
   }
   /// @}
 
 private:
 
+  template<class T>
+  static us::Any ToAny(const T& value)
+  {
+    return LDAPPropValue<any_type_tag<T>::value != ANY_TYPE_OTHER>::ToAny(value);
+  }
+
+  static us::Any ToAny(const char* value)
+  {
+    return us::Any(std::string(value));
+  }
+
   LDAPProp& operator=(const LDAPProp&);
 
   std::string m_property;
@@ -0,0 +1,484 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usLockProfiler.h"
+
+#include "usThreads_p.h"
+#include "usStaticInit_p.h"
+#include "usUtils_p.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+US_BEGIN_NAMESPACE
+
+#ifdef US_LOCK_PROFILING
+
+namespace {
+
+// Bucket i counts times below 2^i microseconds, the last bucket is open
+const int HISTOGRAM_BUCKETS = 24;
+
+int HistogramBucket(long long nanos)
+{
+  long long micros = nanos / 1000;
+  int bucket = 0;
+  while (micros > 0 && bucket < HISTOGRAM_BUCKETS - 1)
+  {
+    micros >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+struct SiteStatistics
+{
+  SiteStatistics() : acquisitions(0), contended(0), waitTime(0) {}
+
+  long long acquisitions;
+  long long contended;
+  long long waitTime;
+};
+
+/**
+ * A 64 bit statistic which is updated without a lock. The updates are
+ * relaxed, a report taken while locks are in use may mix values from
+ * slightly different points in time.
+ */
+class ProfileCounter
+{
+public:
+
+  ProfileCounter() : m_Value(0) {}
+
+  void Add(long long value)
+  {
+#if defined(US_ATOMIC_STD)
+    m_Value.fetch_add(value, std::memory_order_relaxed);
+#elif defined(_MSC_VER)
+    InterlockedExchangeAdd64(&m_Value, value);
+#elif defined(__GNUC__)
+    __sync_fetch_and_add(&m_Value, value);
+#else
+    MutexLock lock(m_Mutex);
+    m_Value += value;
+#endif
+  }
+
+  void Max(long long value)
+  {
+#if defined(US_ATOMIC_STD)
+    long long curr = m_Value.load(std::memory_order_relaxed);
+    while (curr < value &&
+           !m_Value.compare_exchange_weak(curr, value, std::memory_order_relaxed))
+    {}
+#elif defined(_MSC_VER)
+    long long curr = m_Value;
+    while (curr < value)
+    {
+      const long long prev = InterlockedCompareExchange64(&m_Value, value, curr);
+      if (prev == curr) break;
+      curr = prev;
+    }
+#elif defined(__GNUC__)
+    long long curr = m_Value;
+    while (curr < value)
+    {
+      const long long prev = __sync_val_compare_and_swap(&m_Value, curr, value);
+      if (prev == curr) break;
+      curr = prev;
+    }
+#else
+    MutexLock lock(m_Mutex);
+    m_Value = std::max(m_Value, value);
+#endif
+  }
+
+  long long Load() const
+  {
+#if defined(US_ATOMIC_STD)
+    return m_Value.load(std::memory_order_relaxed);
+#elif defined(_MSC_VER) || defined(__GNUC__)
+    return m_Value;
+#else
+    MutexLock lock(m_Mutex);
+    return m_Value;
+#endif
+  }
+
+  void Reset()
+  {
+#if defined(US_ATOMIC_STD)
+    m_Value.store(0, std::memory_order_relaxed);
+#elif defined(_MSC_VER) || defined(__GNUC__)
+    m_Value = 0;
+#else
+    MutexLock lock(m_Mutex);
+    m_Value = 0;
+#endif
+  }
+
+private:
+
+#if defined(US_ATOMIC_STD)
+  std::atomic<long long> m_Value;
+#elif defined(_MSC_VER)
+  volatile LONGLONG m_Value;
+#elif defined(__GNUC__)
+  volatile long long m_Value;
+#else
+  long long m_Value;
+  mutable Mutex m_Mutex;
+#endif
+
+  // purposely not implemented
+  ProfileCounter(const ProfileCounter&);
+  ProfileCounter& operator=(const ProfileCounter&);
+};
+
+// The statistics of one acquisition site. Sites are only ever added.
+struct SiteNode
+{
+  SiteNode(const char* site, SiteNode* next) : site(site), next(next) {}
+
+  const char* const site;
+  SiteNode* const next;
+  ProfileCounter acquisitions;
+  ProfileCounter contended;
+  ProfileCounter waitTime;
+};
+
+}
+
+// Updated without a lock on every acquisition and release of a profiled
+// mutex, so profiling does not serialize the threads it observes.
+struct LockProfile
+{
+  LockProfile(const std::string& name)
+    : name(name)
+  {}
+
+  void Clear()
+  {
+    acquisitions.Reset();
+    contended.Reset();
+    waitTime.Reset();
+    maxWaitTime.Reset();
+    holds.Reset();
+    holdTime.Reset();
+    maxHoldTime.Reset();
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+      waitHistogram[i].Reset();
+      holdHistogram[i].Reset();
+    }
+    // the sites are kept, they are reported once they are used again
+    for (SiteNode* node = sites.Load(); node; node = node->next)
+    {
+      node->acquisitions.Reset();
+      node->contended.Reset();
+      node->waitTime.Reset();
+    }
+  }
+
+  SiteNode* FindSite(const char* site) const
+  {
+    for (SiteNode* node = sites.Load(); node; node = node->next)
+    {
+      if (node->site == site) return node;
+    }
+    return NULL;
+  }
+
+  SiteNode* GetSite(const char* site)
+  {
+    SiteNode* node = FindSite(site);
+    if (node == NULL)
+    {
+      MutexLock lock(mutex);
+      node = FindSite(site);
+      if (node == NULL)
+      {
+        node = new SiteNode(site, sites.Load());
+        sites.Store(node);
+      }
+    }
+    return node;
+  }
+
+  const std::string name;
+
+  // Only serializes adding sites. Not named, so it is not profiled itself.
+  Mutex mutex;
+
+  ProfileCounter acquisitions;
+  ProfileCounter contended;
+  ProfileCounter waitTime;
+  ProfileCounter maxWaitTime;
+  ProfileCounter holds;
+  ProfileCounter holdTime;
+  ProfileCounter maxHoldTime;
+  ProfileCounter waitHistogram[HISTOGRAM_BUCKETS];
+  ProfileCounter holdHistogram[HISTOGRAM_BUCKETS];
+
+  // Sites are string literals, they are merged by content in the report
+  AtomicPointer<SiteNode> sites;
+};
+
+namespace {
+
+struct LockProfilesPrivate : public MultiThreaded<>
+{
+  typedef std::map<std::string, LockProfile*> ProfileMap;
+
+  // The profiles are never deleted, because named locks may be used
+  // until the very end of static destruction.
+  ProfileMap profiles;
+};
+
+}
+
+US_GLOBAL_STATIC(LockProfilesPrivate, lockProfilesPrivate)
+
+LockProfile* LockProfiling::GetProfile(const char* name)
+{
+  if (name == NULL) return NULL;
+
+  LockProfilesPrivate* profiles = lockProfilesPrivate();
+  if (profiles == NULL) return NULL;
+
+  LockProfilesPrivate::Lock lock(profiles);
+  US_UNUSED(lock);
+  LockProfile*& profile = profiles->profiles[name];
+  if (profile == NULL)
+  {
+    profile = new LockProfile(name);
+  }
+  return profile;
+}
+
+long long LockProfiling::Now()
+{
+  return GetMonotonicTime();
+}
+
+long long LockProfiling::Acquired(LockProfile* profile, const char* site, long long waitStart)
+{
+  const long long now = Now();
+  const long long wait = waitStart ? now - waitStart : 0;
+
+  profile->acquisitions.Add(1);
+  if (waitStart)
+  {
+    profile->contended.Add(1);
+    profile->waitTime.Add(wait);
+    profile->maxWaitTime.Max(wait);
+  }
+  profile->waitHistogram[HistogramBucket(wait)].Add(1);
+  if (site)
+  {
+    SiteNode* siteStats = profile->GetSite(site);
+    siteStats->acquisitions.Add(1);
+    if (waitStart)
+    {
+      siteStats->contended.Add(1);
+      siteStats->waitTime.Add(wait);
+    }
+  }
+  return now;
+}
+
+void LockProfiling::Released(LockProfile* profile, long long acquiredAt, long long releasedAt)
+{
+  if (acquiredAt == 0) return;
+  const long long hold = releasedAt - acquiredAt;
+
+  profile->holds.Add(1);
+  profile->holdTime.Add(hold);
+  profile->maxHoldTime.Max(hold);
+  profile->holdHistogram[HistogramBucket(hold)].Add(1);
+}
+
+namespace {
+
+// A copy of the statistics of one lock, taken for the report
+struct LockProfileSnapshot
+{
+  std::string name;
+  long long acquisitions;
+  long long contended;
+  long long waitTime;
+  long long maxWaitTime;
+  long long holds;
+  long long holdTime;
+  long long maxHoldTime;
+  std::vector<long long> waitHistogram;
+  std::vector<long long> holdHistogram;
+  std::map<std::string, SiteStatistics> sites;
+};
+
+bool MoreContended(const LockProfileSnapshot& a, const LockProfileSnapshot& b)
+{
+  if (a.waitTime != b.waitTime) return a.waitTime > b.waitTime;
+  if (a.contended != b.contended) return a.contended > b.contended;
+  return a.acquisitions > b.acquisitions;
+}
+
+bool SiteMoreContended(const std::pair<std::string, SiteStatistics>& a,
+                       const std::pair<std::string, SiteStatistics>& b)
+{
+  if (a.second.waitTime != b.second.waitTime) return a.second.waitTime > b.second.waitTime;
+  return a.second.acquisitions > b.second.acquisitions;
+}
+
+void PrintHistogram(std::ostream& os, const char* label, const std::vector<long long>& histogram)
+{
+  os << "  " << label << " histogram (us):";
+  for (std::size_t i = 0; i < histogram.size(); ++i)
+  {
+    if (histogram[i] == 0) continue;
+    if (i + 1 == histogram.size())
+    {
+      os << " >=" << (1LL << (i - 1)) << ": " << histogram[i];
+    }
+    else
+    {
+      os << " <" << (1LL << i) << ": " << histogram[i];
+    }
+  }
+  os << "\n";
+}
+
+}
+
+#endif // US_LOCK_PROFILING
+
+bool LockProfiler::IsEnabled()
+{
+#ifdef US_LOCK_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void LockProfiler::Report(std::ostream& os, std::size_t maxLocks)
+{
+#ifdef US_LOCK_PROFILING
+  std::vector<LockProfileSnapshot> snapshots;
+  LockProfilesPrivate* profiles = lockProfilesPrivate();
+  if (profiles != NULL)
+  {
+    LockProfilesPrivate::Lock lock(profiles);
+    US_UNUSED(lock);
+    for (LockProfilesPrivate::ProfileMap::const_iterator iter = profiles->profiles.begin(),
+         iterEnd = profiles->profiles.end(); iter != iterEnd; ++iter)
+    {
+      const LockProfile* profile = iter->second;
+      if (profile->acquisitions.Load() == 0) continue;
+
+      LockProfileSnapshot snapshot;
+      snapshot.name = profile->name;
+      snapshot.acquisitions = profile->acquisitions.Load();
+      snapshot.contended = profile->contended.Load();
+      snapshot.waitTime = profile->waitTime.Load();
+      snapshot.maxWaitTime = profile->maxWaitTime.Load();
+      snapshot.holds = profile->holds.Load();
+      snapshot.holdTime = profile->holdTime.Load();
+      snapshot.maxHoldTime = profile->maxHoldTime.Load();
+      for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+      {
+        snapshot.waitHistogram.push_back(profile->waitHistogram[i].Load());
+        snapshot.holdHistogram.push_back(profile->holdHistogram[i].Load());
+      }
+      for (const SiteNode* node = profile->sites.Load(); node; node = node->next)
+      {
+        const long long acquisitions = node->acquisitions.Load();
+        if (acquisitions == 0) continue;
+        SiteStatistics& siteStats = snapshot.sites[node->site];
+        siteStats.acquisitions += acquisitions;
+        siteStats.contended += node->contended.Load();
+        siteStats.waitTime += node->waitTime.Load();
+      }
+      snapshots.push_back(snapshot);
+    }
+  }
+
+  std::sort(snapshots.begin(), snapshots.end(), MoreContended);
+  const std::size_t count = std::min(maxLocks, snapshots.size());
+
+  os << "Lock profile: " << count << " of " << snapshots.size()
+     << " locks, ordered by total wait time\n";
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const LockProfileSnapshot& snapshot = snapshots[i];
+    os << snapshot.name << "\n"
+       << "  acquisitions: " << snapshot.acquisitions
+       << ", contended: " << snapshot.contended << "\n"
+       << "  wait (us): total " << snapshot.waitTime / 1000
+       << ", max " << snapshot.maxWaitTime / 1000 << "\n";
+    if (snapshot.holds > 0)
+    {
+      os << "  hold (us): total " << snapshot.holdTime / 1000
+         << ", max " << snapshot.maxHoldTime / 1000
+         << ", mean " << snapshot.holdTime / snapshot.holds / 1000 << "\n";
+    }
+    PrintHistogram(os, "wait", snapshot.waitHistogram);
+    if (snapshot.holds > 0)
+    {
+      PrintHistogram(os, "hold", snapshot.holdHistogram);
+    }
+
+    std::vector<std::pair<std::string, SiteStatistics> > sites(snapshot.sites.begin(), snapshot.sites.end());
+    std::sort(sites.begin(), sites.end(), SiteMoreContended);
+    for (std::size_t j = 0; j < sites.size(); ++j)
+    {
+      os << "  at " << sites[j].first
+         << ": acquisitions " << sites[j].second.acquisitions
+         << ", contended " << sites[j].second.contended
+         << ", wait (us) " << sites[j].second.waitTime / 1000 << "\n";
+    }
+  }
+#else
+  US_UNUSED(maxLocks);
+  os << "Lock profiling is not enabled\n";
+#endif
+}
+
+void LockProfiler::Reset()
+{
+#ifdef US_LOCK_PROFILING
+  LockProfilesPrivate* profiles = lockProfilesPrivate();
+  if (profiles == NULL) return;
+
+  LockProfilesPrivate::Lock lock(profiles);
+  US_UNUSED(lock);
+  for (LockProfilesPrivate::ProfileMap::const_iterator iter = profiles->profiles.begin(),
+       iterEnd = profiles->profiles.end(); iter != iterEnd; ++iter)
+  {
+    iter->second->Clear();
+  }
+#endif
+}
+
+US_END_NAMESPACE
@@ -0,0 +1,79 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+
+#ifndef USLOCKPROFILER_H
+#define USLOCKPROFILER_H
+
+#include "usConfig.h"
+
+#include <cstddef>
+#include <ostream>
+
+US_BEGIN_NAMESPACE
+
+/**
+ * \ingroup MicroServices
+ *
+ * Reports contention statistics of the locks used internally by the
+ * CppMicroServices library.
+ *
+ * Statistics are only recorded if the library has been configured with
+ * threading support and the \e US_ENABLE_LOCK_PROFILING option. Otherwise
+ * the locks contain no profiling code and the report is empty.
+ *
+ * Locks with the same name, e.g. the locks of all service registrations,
+ * share their statistics. For each lock the number of acquisitions, the
+ * number of contended acquisitions and histograms of the wait and hold
+ * times are recorded. Acquisitions which are tagged with their source
+ * location are additionally broken down by call site.
+ *
+ * \remarks This class is thread safe.
+ */
+class US_EXPORT LockProfiler
+{
+public:
+
+  /**
+   * \return \c true if lock profiling has been configured into the
+   * CppMicroServices library, \c false otherwise.
+   */
+  static bool IsEnabled();
+
+  /**
+   * Writes the statistics of the most contended locks to \c os, ordered
+   * by their accumulated wait time.
+   *
+   * @param os The stream to write the report to.
+   * @param maxLocks The maximum number of locks to report.
+   */
+  static void Report(std::ostream& os, std::size_t maxLocks = 10);
+
+  /**
+   * Discards all statistics recorded so far.
+   */
+  static void Reset();
+
+};
+
+US_END_NAMESPACE
+
+#endif // USLOCKPROFILER_H
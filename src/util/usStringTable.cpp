@@ -0,0 +1,152 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include "usStringTable_p.h"
+
+#include <cctype>
+
+US_BEGIN_NAMESPACE
+
+StringTable::Table::Table(std::size_t capacity)
+  : capacity(capacity)
+  , slots(new AtomicPointer<const Entry>[capacity])
+  , ids(new AtomicPointer<const Entry>[capacity / 2])
+{
+}
+
+StringTable::Table::~Table()
+{
+  delete[] slots;
+  delete[] ids;
+}
+
+StringTable::StringTable(bool caseInsensitive)
+  : caseInsensitive(caseInsensitive)
+  , table(new Table(64))
+{
+}
+
+StringTable::~StringTable()
+{
+  delete table.Load();
+  for (std::vector<Table*>::iterator i = retiredTables.begin(); i != retiredTables.end(); ++i)
+  {
+    delete *i;
+  }
+  for (std::vector<const Entry*>::iterator i = entries.begin(); i != entries.end(); ++i)
+  {
+    delete *i;
+  }
+}
+
+int StringTable::Intern(const std::string& str)
+{
+  const int id = Find(str);
+  if (id > -1) return id;
+
+  Lock lock(this); US_UNUSED(lock);
+  Table* current = table.Load();
+  const std::size_t hash = Hash(str);
+
+  // another thread may have added str in the meantime
+  const std::size_t mask = current->capacity - 1;
+  for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+  {
+    const Entry* entry = current->slots[slot].Load();
+    if (entry == NULL) break;
+    if (entry->hash == hash && Equals(entry->str, str)) return entry->id;
+  }
+
+  const Entry* entry = new Entry(str, hash, static_cast<int>(entries.size()));
+  entries.push_back(entry);
+
+  // keep the load factor at or below one half
+  if (entries.size() > current->capacity / 2)
+  {
+    Table* grown = new Table(current->capacity * 2);
+    for (std::vector<const Entry*>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+    {
+      Insert(grown, *i);
+    }
+    retiredTables.push_back(current);
+    table.Store(grown);
+  }
+  else
+  {
+    Insert(current, entry);
+  }
+  return entry->id;
+}
+
+int StringTable::Find(const std::string& str) const
+{
+  const Table* current = table.Load();
+  const std::size_t hash = Hash(str);
+  const std::size_t mask = current->capacity - 1;
+  for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+  {
+    const Entry* entry = current->slots[slot].Load();
+    if (entry == NULL) return -1;
+    if (entry->hash == hash && Equals(entry->str, str)) return entry->id;
+  }
+}
+
+const std::string& StringTable::GetString(int id) const
+{
+  return table.Load()->ids[id].Load()->str;
+}
+
+void StringTable::Insert(Table* table, const Entry* entry)
+{
+  // publish the id first, readers may look it up as soon as they find the entry
+  table->ids[entry->id].Store(entry);
+  const std::size_t mask = table->capacity - 1;
+  std::size_t slot = entry->hash & mask;
+  while (table->slots[slot].Load() != NULL) slot = (slot + 1) & mask;
+  table->slots[slot].Store(entry);
+}
+
+std::size_t StringTable::Hash(const std::string& str) const
+{
+  // FNV-1a
+  std::size_t hash = static_cast<std::size_t>(2166136261u);
+  for (std::string::const_iterator i = str.begin(), end = str.end(); i != end; ++i)
+  {
+    const unsigned char c = static_cast<unsigned char>(*i);
+    hash ^= static_cast<std::size_t>(caseInsensitive ? std::tolower(c) : c);
+    hash *= static_cast<std::size_t>(16777619u);
+  }
+  return hash;
+}
+
+bool StringTable::Equals(const std::string& s1, const std::string& s2) const
+{
+  if (!caseInsensitive) return s1 == s2;
+  if (s1.size() != s2.size()) return false;
+  for (std::size_t i = 0; i < s1.size(); ++i)
+  {
+    if (std::tolower(static_cast<unsigned char>(s1[i])) != std::tolower(static_cast<unsigned char>(s2[i])))
+      return false;
+  }
+  return true;
+}
+
+US_END_NAMESPACE
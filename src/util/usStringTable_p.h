@@ -0,0 +1,126 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USSTRINGTABLE_P_H
+#define USSTRINGTABLE_P_H
+
+#include "usThreads_p.h"
+
+#include <string>
+#include <vector>
+
+US_BEGIN_NAMESPACE
+
+/**
+ * This class is not part of the public API.
+ *
+ * A table assigning small, stable ids to strings. Ids are dense and
+ * start at zero. Looking up an id or the string of an id does not lock
+ * or allocate, only adding a string locks. Strings are never removed, so
+ * only strings from long-lived sources like service registrations and
+ * compiled filters should be added.
+ */
+class StringTable : private MultiThreaded<>
+{
+
+public:
+
+  /**
+   * @param caseInsensitive If <code>true</code>, strings differing only
+   *        in case share the same id and GetString() returns the first
+   *        spelling which was added.
+   */
+  explicit StringTable(bool caseInsensitive);
+
+  ~StringTable();
+
+  /**
+   * Returns the id of \c str, adding it to the table if necessary.
+   */
+  int Intern(const std::string& str);
+
+  /**
+   * Returns the id of \c str or -1 if it was not added to the table.
+   */
+  int Find(const std::string& str) const;
+
+  /**
+   * Returns the string of an id returned by Intern() or Find().
+   */
+  const std::string& GetString(int id) const;
+
+private:
+
+  struct Entry
+  {
+    Entry(const std::string& str, std::size_t hash, int id)
+      : str(str), hash(hash), id(id)
+    {}
+
+    const std::string str;
+    const std::size_t hash;
+    const int id;
+  };
+
+  /*
+   * Open addressing hash table with linear probing. The slots and the
+   * id index are only ever filled, a full table is replaced by a copy
+   * of twice the capacity. Replaced tables are kept until the string
+   * table is destroyed, since readers may still use them.
+   */
+  struct Table
+  {
+    explicit Table(std::size_t capacity);
+    ~Table();
+
+    const std::size_t capacity;
+    AtomicPointer<const Entry>* const slots;
+    AtomicPointer<const Entry>* const ids;
+
+  private:
+
+    // purposely not implemented
+    Table(const Table&);
+    Table& operator=(const Table&);
+  };
+
+  std::size_t Hash(const std::string& str) const;
+
+  bool Equals(const std::string& s1, const std::string& s2) const;
+
+  static void Insert(Table* table, const Entry* entry);
+
+  const bool caseInsensitive;
+
+  AtomicPointer<Table> table;
+
+  // guarded by the lock
+  std::vector<const Entry*> entries;
+  std::vector<Table*> retiredTables;
+
+  // purposely not implemented
+  StringTable(const StringTable&);
+  StringTable& operator=(const StringTable&);
+};
+
+US_END_NAMESPACE
+
+#endif // USSTRINGTABLE_P_H
@@ -25,6 +25,9 @@
 
 #include <usConfig.h>
 
+#include <cstddef>
+#include <vector>
+
 #ifdef US_ENABLE_THREADING_SUPPORT
 
   // Atomic compiler intrinsics
@@ -65,12 +68,27 @@
     #define US_THREADS_MUTEX_DELETE(x)    ::CloseHandle (x)
     #define US_THREADS_MUTEX_LOCK(x)      ::WaitForSingleObject (x, INFINITE)
     #define US_THREADS_MUTEX_UNLOCK(x)    ::ReleaseMutex (x)
+    #define US_THREADS_MUTEX_TRYLOCK(x)   (::WaitForSingleObject (x, 0) == WAIT_OBJECT_0)
     #define US_THREADS_LONG               LONG
 
+    // No reader/writer lock available on all supported Windows versions,
+    // shared locks are exclusive
+    #define US_THREADS_SHARED_MUTEX(x)           HANDLE x;
+    #define US_THREADS_SHARED_MUTEX_INIT(x)
+    #define US_THREADS_SHARED_MUTEX_CTOR(x)      : x(::CreateMutex(NULL, FALSE, NULL))
+    #define US_THREADS_SHARED_MUTEX_DELETE(x)    ::CloseHandle (x)
+    #define US_THREADS_SHARED_MUTEX_LOCK(x)      ::WaitForSingleObject (x, INFINITE)
+    #define US_THREADS_SHARED_MUTEX_LOCK_SHARED(x) ::WaitForSingleObject (x, INFINITE)
+    #define US_THREADS_SHARED_MUTEX_UNLOCK(x)    ::ReleaseMutex (x)
+    #define US_THREADS_SHARED_MUTEX_TRYLOCK(x)   (::WaitForSingleObject (x, 0) == WAIT_OBJECT_0)
+    #define US_THREADS_SHARED_MUTEX_TRYLOCK_SHARED(x) (::WaitForSingleObject (x, 0) == WAIT_OBJECT_0)
+
     #define US_ATOMIC_OPTIMIZATION
     #define US_ATOMIC_INCREMENT(x)        IntType n = InterlockedIncrement(x)
     #define US_ATOMIC_DECREMENT(x)        IntType n = InterlockedDecrement(x)
     #define US_ATOMIC_ASSIGN(l, r)        InterlockedExchange(l, r)
+    #define US_ATOMIC_EXCHANGE(x, v)      IntType n = InterlockedExchange(x, v)
+    #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) bool n = InterlockedCompareExchange(x, v, e) == (e)
 
   #elif defined(US_PLATFORM_POSIX)
 
@@ -82,6 +100,17 @@
     #define US_THREADS_MUTEX_DELETE(x)    ::pthread_mutex_destroy (&x)
     #define US_THREADS_MUTEX_LOCK(x)      ::pthread_mutex_lock (&x)
     #define US_THREADS_MUTEX_UNLOCK(x)    ::pthread_mutex_unlock (&x)
+    #define US_THREADS_MUTEX_TRYLOCK(x)   (::pthread_mutex_trylock (&x) == 0)
+
+    #define US_THREADS_SHARED_MUTEX(x)           pthread_rwlock_t x;
+    #define US_THREADS_SHARED_MUTEX_INIT(x)      ::pthread_rwlock_init(&x, 0)
+    #define US_THREADS_SHARED_MUTEX_CTOR(x)      : x()
+    #define US_THREADS_SHARED_MUTEX_DELETE(x)    ::pthread_rwlock_destroy (&x)
+    #define US_THREADS_SHARED_MUTEX_LOCK(x)      ::pthread_rwlock_wrlock (&x)
+    #define US_THREADS_SHARED_MUTEX_LOCK_SHARED(x) ::pthread_rwlock_rdlock (&x)
+    #define US_THREADS_SHARED_MUTEX_UNLOCK(x)    ::pthread_rwlock_unlock (&x)
+    #define US_THREADS_SHARED_MUTEX_TRYLOCK(x)   (::pthread_rwlock_trywrlock (&x) == 0)
+    #define US_THREADS_SHARED_MUTEX_TRYLOCK_SHARED(x) (::pthread_rwlock_tryrdlock (&x) == 0)
 
     #define US_ATOMIC_OPTIMIZATION
     #if defined(US_ATOMIC_OPTIMIZATION_APPLE)
@@ -90,17 +119,29 @@
         #define US_ATOMIC_INCREMENT(x)    IntType n = OSAtomicIncrement64Barrier(x)
         #define US_ATOMIC_DECREMENT(x)    IntType n = OSAtomicDecrement64Barrier(x)
         #define US_ATOMIC_ASSIGN(l, v)    OSAtomicCompareAndSwap64Barrier(*l, v, l)
+        #define US_ATOMIC_EXCHANGE(x, v)  IntType n;                                        \
+                                          do { n = *(x); }                                  \
+                                          while (!OSAtomicCompareAndSwap64Barrier(n, v, x))
+        #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) bool n = OSAtomicCompareAndSwap64Barrier(e, v, x)
       #else
         #define US_THREADS_LONG           volatile int32_t
         #define US_ATOMIC_INCREMENT(x)    IntType n = OSAtomicIncrement32Barrier(x)
         #define US_ATOMIC_DECREMENT(x)    IntType n = OSAtomicDecrement32Barrier(x)
         #define US_ATOMIC_ASSIGN(l, v)    OSAtomicCompareAndSwap32Barrier(*l, v, l)
+        #define US_ATOMIC_EXCHANGE(x, v)  IntType n;                                        \
+                                          do { n = *(x); }                                  \
+                                          while (!OSAtomicCompareAndSwap32Barrier(n, v, x))
+        #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) bool n = OSAtomicCompareAndSwap32Barrier(e, v, x)
       #endif
     #elif defined(US_ATOMIC_OPTIMIZATION_GNUC)
       #define US_THREADS_LONG             _Atomic_word
       #define US_ATOMIC_INCREMENT(x)      IntType n = __sync_add_and_fetch(x, 1)
       #define US_ATOMIC_DECREMENT(x)      IntType n = __sync_add_and_fetch(x, -1)
       #define US_ATOMIC_ASSIGN(l, v)      __sync_val_compare_and_swap(l, *l, v)
+      // __sync_lock_test_and_set is only an acquire barrier
+      #define US_ATOMIC_EXCHANGE(x, v)    __sync_synchronize();                 \
+                                          IntType n = __sync_lock_test_and_set(x, v)
+      #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) bool n = __sync_bool_compare_and_swap(x, e, v)
     #else
       #define US_THREADS_LONG             long
       #undef US_ATOMIC_OPTIMIZATION
@@ -113,6 +154,14 @@
       #define US_ATOMIC_ASSIGN(l, v)      m_AtomicMtx.Lock();  \
                                           *l = v;              \
                                           m_AtomicMtx.Unlock()
+      #define US_ATOMIC_EXCHANGE(x, v)    m_AtomicMtx.Lock();  \
+                                          IntType n = *(x);    \
+                                          *(x) = v;            \
+                                          m_AtomicMtx.Unlock()
+      #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) m_AtomicMtx.Lock();      \
+                                          bool n = *(x) == (e);    \
+                                          if (n) *(x) = v;         \
+                                          m_AtomicMtx.Unlock()
     #endif
 
   #endif
@@ -128,15 +177,88 @@
   #define US_THREADS_MUTEX_UNLOCK(x)
   #define US_THREADS_LONG int
 
+  #define US_THREADS_SHARED_MUTEX(x)
+  #define US_THREADS_SHARED_MUTEX_INIT(x)
+  #define US_THREADS_SHARED_MUTEX_CTOR(x)
+  #define US_THREADS_SHARED_MUTEX_DELETE(x)
+  #define US_THREADS_SHARED_MUTEX_LOCK(x)
+  #define US_THREADS_SHARED_MUTEX_LOCK_SHARED(x)
+  #define US_THREADS_SHARED_MUTEX_UNLOCK(x)
+
   #define US_ATOMIC_INCREMENT(x)        IntType n = ++(*x);
   #define US_ATOMIC_DECREMENT(x)        IntType n = --(*x);
   #define US_ATOMIC_ASSIGN(l, r)        *l = r;
+  #define US_ATOMIC_EXCHANGE(x, v)      IntType n = *(x); *(x) = v;
+  #define US_ATOMIC_COMPARE_AND_SWAP(x, e, v) bool n = *(x) == (e); if (n) *(x) = v;
+
+#endif
+
+// C++11 atomics are preferred over the platform specific intrinsics
+#if defined(US_ENABLE_THREADING_SUPPORT) && defined(US_HAVE_STD_ATOMIC)
+  #include <atomic>
+  #define US_ATOMIC_STD
+#endif
+
+// Full memory barrier, for publishing objects to readers which do not lock
+#if !defined(US_ENABLE_THREADING_SUPPORT)
+  #define US_MEMORY_BARRIER()
+#elif defined(_MSC_VER)
+  #define US_MEMORY_BARRIER()           MemoryBarrier()
+#elif defined(__GNUC__)
+  #define US_MEMORY_BARRIER()           __sync_synchronize()
+#else
+  // no barrier intrinsic known, rely on the ordering of volatile accesses
+  #define US_MEMORY_BARRIER()
+#endif
 
+// Lock profiling, see LockProfiler
+#if defined(US_ENABLE_THREADING_SUPPORT) && defined(US_ENABLE_LOCK_PROFILING)
+  #define US_LOCK_PROFILING
+  #define US_LOCK_SITE_STR2(x)          #x
+  #define US_LOCK_SITE_STR(x)           US_LOCK_SITE_STR2(x)
+  // Tags a lock acquisition with the current source location
+  #define US_LOCK_SITE                  __FILE__ ":" US_LOCK_SITE_STR(__LINE__)
+#else
+  #define US_LOCK_SITE                  0
 #endif
 
 
 US_BEGIN_NAMESPACE
 
+#ifdef US_LOCK_PROFILING
+
+struct LockProfile;
+
+/**
+ * Hooks used by Mutex and SharedMutex to record contention statistics.
+ * Times are in nanoseconds from an arbitrary, monotonic origin.
+ */
+struct US_EXPORT LockProfiling
+{
+  /**
+   * Returns the statistics shared by all locks called <code>name</code>,
+   * or NULL if the profiler is not available anymore.
+   */
+  static LockProfile* GetProfile(const char* name);
+
+  static long long Now();
+
+  /**
+   * Records an acquisition. <code>waitStart</code> is the time at which
+   * the thread started to block, or zero if the lock was free.
+   *
+   * \return The acquisition time.
+   */
+  static long long Acquired(LockProfile* profile, const char* site, long long waitStart);
+
+  /**
+   * Records the hold time of an exclusive acquisition.
+   */
+  static void Released(LockProfile* profile, long long acquiredAt, long long releasedAt);
+};
+
+#endif
+
 class Mutex
 {
 public:
@@ -144,6 +266,10 @@ public:
   Mutex() US_THREADS_MUTEX_CTOR(m_Mtx)
   {
     US_THREADS_MUTEX_INIT(m_Mtx);
+#ifdef US_LOCK_PROFILING
+    m_Profile = NULL;
+    m_AcquiredAt = 0;
+#endif
   }
 
   ~Mutex()
@@ -151,12 +277,49 @@ public:
     US_THREADS_MUTEX_DELETE(m_Mtx);
   }
 
-  void Lock()
+  /**
+   * Names the mutex for the lock profiler. Mutexes with the same name
+   * share their statistics. Unnamed mutexes are not profiled.
+   */
+  void SetName(const char* name)
+  {
+#ifdef US_LOCK_PROFILING
+    m_Profile = LockProfiling::GetProfile(name);
+#else
+    US_UNUSED(name);
+#endif
+  }
+
+  void Lock(const char* site = 0)
   {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      long long waitStart = 0;
+      if (!US_THREADS_MUTEX_TRYLOCK(m_Mtx))
+      {
+        waitStart = LockProfiling::Now();
+        US_THREADS_MUTEX_LOCK(m_Mtx);
+      }
+      m_AcquiredAt = LockProfiling::Acquired(m_Profile, site, waitStart);
+      return;
+    }
+#endif
+    US_UNUSED(site);
     US_THREADS_MUTEX_LOCK(m_Mtx);
   }
   void Unlock()
   {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      const long long acquiredAt = m_AcquiredAt;
+      const long long releasedAt = LockProfiling::Now();
+      US_THREADS_MUTEX_UNLOCK(m_Mtx);
+      LockProfiling::Released(m_Profile, acquiredAt, releasedAt);
+      return;
+    }
+#endif
     US_THREADS_MUTEX_UNLOCK(m_Mtx);
   }
 
@@ -164,12 +327,145 @@ private:
 
   template<class Host> friend class WaitCondition;
 
+  // Called by WaitCondition, the mutex is not held while waiting
+  void BeforeWait()
+  {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      LockProfiling::Released(m_Profile, m_AcquiredAt, LockProfiling::Now());
+    }
+#endif
+  }
+  void AfterWait()
+  {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      m_AcquiredAt = LockProfiling::Now();
+    }
+#endif
+  }
+
   // Copy-constructor not implemented.
   Mutex(const Mutex &);
   // Copy-assignement operator not implemented.
   Mutex & operator = (const Mutex &);
 
   US_THREADS_MUTEX(m_Mtx)
+
+#ifdef US_LOCK_PROFILING
+  LockProfile* m_Profile;
+  // only written by the thread holding the mutex
+  long long m_AcquiredAt;
+#endif
+};
+
+/**
+ * A reader/writer mutex. Any number of threads may hold the mutex
+ * in shared mode, as long as no thread holds it exclusively.
+ */
+class SharedMutex
+{
+public:
+
+  SharedMutex() US_THREADS_SHARED_MUTEX_CTOR(m_Mtx)
+  {
+    US_THREADS_SHARED_MUTEX_INIT(m_Mtx);
+#ifdef US_LOCK_PROFILING
+    m_Profile = NULL;
+    m_AcquiredAt = 0;
+#endif
+  }
+
+  ~SharedMutex()
+  {
+    US_THREADS_SHARED_MUTEX_DELETE(m_Mtx);
+  }
+
+  /**
+   * Names the mutex for the lock profiler, see Mutex::SetName().
+   */
+  void SetName(const char* name)
+  {
+#ifdef US_LOCK_PROFILING
+    m_Profile = LockProfiling::GetProfile(name);
+#else
+    US_UNUSED(name);
+#endif
+  }
+
+  void Lock(const char* site = 0)
+  {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      long long waitStart = 0;
+      if (!US_THREADS_SHARED_MUTEX_TRYLOCK(m_Mtx))
+      {
+        waitStart = LockProfiling::Now();
+        US_THREADS_SHARED_MUTEX_LOCK(m_Mtx);
+      }
+      m_AcquiredAt = LockProfiling::Acquired(m_Profile, site, waitStart);
+      return;
+    }
+#endif
+    US_UNUSED(site);
+    US_THREADS_SHARED_MUTEX_LOCK(m_Mtx);
+  }
+  void Unlock()
+  {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      const long long acquiredAt = m_AcquiredAt;
+      const long long releasedAt = LockProfiling::Now();
+      US_THREADS_SHARED_MUTEX_UNLOCK(m_Mtx);
+      LockProfiling::Released(m_Profile, acquiredAt, releasedAt);
+      return;
+    }
+#endif
+    US_THREADS_SHARED_MUTEX_UNLOCK(m_Mtx);
+  }
+
+  // Hold times are only recorded for exclusive locks
+  void LockShared(const char* site = 0)
+  {
+#ifdef US_LOCK_PROFILING
+    if (m_Profile)
+    {
+      long long waitStart = 0;
+      if (!US_THREADS_SHARED_MUTEX_TRYLOCK_SHARED(m_Mtx))
+      {
+        waitStart = LockProfiling::Now();
+        US_THREADS_SHARED_MUTEX_LOCK_SHARED(m_Mtx);
+      }
+      LockProfiling::Acquired(m_Profile, site, waitStart);
+      return;
+    }
+#endif
+    US_UNUSED(site);
+    US_THREADS_SHARED_MUTEX_LOCK_SHARED(m_Mtx);
+  }
+  void UnlockShared()
+  {
+    US_THREADS_SHARED_MUTEX_UNLOCK(m_Mtx);
+  }
+
+private:
+
+  // Copy-constructor not implemented.
+  SharedMutex(const SharedMutex &);
+  // Copy-assignement operator not implemented.
+  SharedMutex & operator = (const SharedMutex &);
+
+  US_THREADS_SHARED_MUTEX(m_Mtx)
+
+#ifdef US_LOCK_PROFILING
+  LockProfile* m_Profile;
+  // only written by the thread holding the mutex exclusively
+  long long m_AcquiredAt;
+#endif
 };
 
 class MutexLock
@@ -177,7 +473,7 @@ class MutexLock
 public:
   typedef Mutex MutexType;
 
-  MutexLock(MutexType& mtx) : m_Mtx(&mtx) { m_Mtx->Lock(); }
+  MutexLock(MutexType& mtx, const char* site = 0) : m_Mtx(&mtx) { m_Mtx->Lock(site); }
   ~MutexLock() { m_Mtx->Unlock(); }
 
 private:
@@ -188,57 +484,397 @@ private:
   MutexLock& operator=(const MutexLock&);
 };
 
+/**
+ * Identifies a thread, e.g. to detect that a thread re-enters an operation
+ * which it started itself.
+ */
+class ThreadId
+{
+public:
+
+  static ThreadId Current()
+  {
+    ThreadId id;
+#if !defined(US_ENABLE_THREADING_SUPPORT)
+    id.m_Id = 0;
+#elif defined(US_PLATFORM_WINDOWS)
+    id.m_Id = ::GetCurrentThreadId();
+#else
+    id.m_Id = ::pthread_self();
+#endif
+    return id;
+  }
+
+  bool operator==(const ThreadId& other) const
+  {
+#if defined(US_ENABLE_THREADING_SUPPORT) && defined(US_PLATFORM_POSIX)
+    return ::pthread_equal(m_Id, other.m_Id) != 0;
+#else
+    return m_Id == other.m_Id;
+#endif
+  }
+
+  bool operator!=(const ThreadId& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+
+#if !defined(US_ENABLE_THREADING_SUPPORT)
+  int m_Id;
+#elif defined(US_PLATFORM_WINDOWS)
+  DWORD m_Id;
+#else
+  pthread_t m_Id;
+#endif
+};
+
+/**
+ * An integer counter which is incremented and decremented atomically.
+ *
+ * Increments are full barriers with every backend: the interlocked and
+ * __sync intrinsics are, and with std::atomic they are sequentially
+ * consistent. Callers rely on this to order an increment before a later
+ * load of another flag (see ServiceReferenceBasePrivate::GetSingletonService).
+ * Decrements have acquire-release semantics, Exchange() is a full barrier
+ * and Load() is an acquire load.
+ */
 class AtomicCounter
 {
 public:
 
+#ifdef US_ATOMIC_STD
+  typedef int IntType;
+#else
   typedef US_THREADS_LONG IntType;
+#endif
 
   AtomicCounter(int value = 0)
     : m_Counter(value)
   {}
 
+  AtomicCounter(const AtomicCounter& other)
+    : m_Counter(other.Load())
+  {}
+
+  AtomicCounter& operator=(const AtomicCounter& other)
+  {
+#ifdef US_ATOMIC_STD
+    m_Counter.store(other.Load(), std::memory_order_release);
+#else
+    m_Counter = other.Load();
+#endif
+    return *this;
+  }
+
+  /**
+   * Increments the counter and returns the new value.
+   */
   IntType AtomicIncrement() const
   {
+#ifdef US_ATOMIC_STD
+    return m_Counter.fetch_add(1, std::memory_order_seq_cst) + 1;
+#else
     US_ATOMIC_INCREMENT(&m_Counter);
     return n;
+#endif
   }
 
-  IntType AtomicIncrement(volatile IntType& lval) const
+  /**
+   * Decrements the counter and returns the new value.
+   */
+  IntType AtomicDecrement() const
   {
-    US_ATOMIC_INCREMENT(&lval);
+#ifdef US_ATOMIC_STD
+    // the thread dropping the last reference must see all writes made
+    // by the threads which dropped theirs before
+    return m_Counter.fetch_sub(1, std::memory_order_acq_rel) - 1;
+#else
+    US_ATOMIC_DECREMENT(&m_Counter);
     return n;
+#endif
   }
 
-  IntType AtomicDecrement() const
+  /**
+   * Sets the counter to \c value and returns the previous value. This is
+   * a full barrier.
+   */
+  IntType Exchange(IntType value) const
   {
-    US_ATOMIC_DECREMENT(&m_Counter);
+#ifdef US_ATOMIC_STD
+    return m_Counter.exchange(value, std::memory_order_seq_cst);
+#else
+    US_ATOMIC_EXCHANGE(&m_Counter, value);
     return n;
+#endif
   }
 
-  IntType AtomicDecrement(volatile IntType& lval) const
+  /**
+   * Sets the counter to \c desired if it is equal to \c expected. Returns
+   * \c true if the counter was changed. This is a full barrier.
+   */
+  bool CompareAndSwap(IntType expected, IntType desired) const
   {
-    US_ATOMIC_DECREMENT(&lval);
+#ifdef US_ATOMIC_STD
+    return m_Counter.compare_exchange_strong(expected, desired, std::memory_order_seq_cst);
+#else
+    US_ATOMIC_COMPARE_AND_SWAP(&m_Counter, expected, desired);
     return n;
+#endif
   }
 
-  void AtomicAssign(volatile IntType& lval) const
+  /**
+   * Decrements the counter unless it is zero or negative. Returns the
+   * new value, or -1 if the counter was not changed.
+   */
+  IntType AtomicDecrementIfPositive() const
   {
-    US_ATOMIC_ASSIGN(&lval, m_Counter);
+    for (IntType value = Load(); value > 0; value = Load())
+    {
+      if (CompareAndSwap(value, value - 1)) return value - 1;
+    }
+    return -1;
   }
 
-  void AtomicAssign(volatile IntType& lval, const IntType val) const
+  /**
+   * Returns the current value. The load is sequentially consistent with
+   * the other operations of all atomic counters.
+   */
+  IntType Load() const
   {
-    US_ATOMIC_ASSIGN(&lval, val);
+#ifdef US_ATOMIC_STD
+    return m_Counter.load(std::memory_order_seq_cst);
+#else
+    IntType curr(0);
+    US_ATOMIC_ASSIGN(&curr, m_Counter);
+    return curr;
+#endif
   }
 
+private:
+
+#ifdef US_ATOMIC_STD
+  mutable std::atomic<IntType> m_Counter;
+#else
   mutable IntType m_Counter;
+#endif
+
+#if !defined(US_ATOMIC_OPTIMIZATION) && !defined(US_ATOMIC_STD)
+  mutable Mutex m_AtomicMtx;
+#endif
+};
+
+/**
+ * A boolean flag which is read and written without a lock. Loads and
+ * stores are sequentially consistent, so a store followed by a full
+ * barrier operation on another variable (e.g. AtomicCounter::Exchange())
+ * is never observed in the opposite order.
+ */
+class AtomicFlag
+{
+public:
+
+  explicit AtomicFlag(bool value = false)
+    : m_Flag(value)
+  {}
+
+  bool Load() const
+  {
+#ifdef US_ATOMIC_STD
+    return m_Flag.load(std::memory_order_seq_cst);
+#else
+    US_MEMORY_BARRIER();
+    const bool value = m_Flag;
+    US_MEMORY_BARRIER();
+    return value;
+#endif
+  }
+
+  void Store(bool value)
+  {
+#ifdef US_ATOMIC_STD
+    m_Flag.store(value, std::memory_order_seq_cst);
+#else
+    US_MEMORY_BARRIER();
+    m_Flag = value;
+    US_MEMORY_BARRIER();
+#endif
+  }
 
 private:
 
-#if !defined(US_ATOMIC_OPTIMIZATION)
-  mutable Mutex m_AtomicMtx;
+#ifdef US_ATOMIC_STD
+  std::atomic<bool> m_Flag;
+#else
+  volatile bool m_Flag;
 #endif
+
+  // purposely not implemented
+  AtomicFlag(const AtomicFlag&);
+  AtomicFlag& operator=(const AtomicFlag&);
+};
+
+/**
+ * A pointer which is published with release semantics and read with
+ * acquire semantics, so readers see the pointee fully constructed
+ * without taking a lock.
+ */
+template<class T>
+class AtomicPointer
+{
+public:
+
+  AtomicPointer(T* value = NULL)
+    : m_Pointer(value)
+  {}
+
+  T* Load() const
+  {
+#ifdef US_ATOMIC_STD
+    return m_Pointer.load(std::memory_order_acquire);
+#else
+    T* value = m_Pointer;
+    US_MEMORY_BARRIER();
+    return value;
+#endif
+  }
+
+  void Store(T* value)
+  {
+#ifdef US_ATOMIC_STD
+    m_Pointer.store(value, std::memory_order_release);
+#else
+    US_MEMORY_BARRIER();
+    m_Pointer = value;
+#endif
+  }
+
+private:
+
+  // purposely not implemented
+  AtomicPointer(const AtomicPointer&);
+  AtomicPointer& operator=(const AtomicPointer&);
+
+#ifdef US_ATOMIC_STD
+  std::atomic<T*> m_Pointer;
+#else
+  T* volatile m_Pointer;
+#endif
+};
+
+/**
+ * A pointer to a reference counted object, e.g. derived from SharedData,
+ * which is loaded without a lock while a writer may replace it.
+ *
+ * The publisher holds one reference to the published object. A replaced
+ * object is retired and its reference is released once no reader can be
+ * about to take a reference to it. Readers announce themselves in one of
+ * two generations and a writer starts a new generation before it waits
+ * for the readers of the previous one. Retired objects are therefore
+ * released by a later Store() once the readers which were active when
+ * they were retired are done, even if new readers keep arriving.
+ *
+ * Calls to Store() must be serialized by the caller. The destructor
+ * releases all objects and must not run concurrently with a reader.
+ */
+template<class T>
+class PublishedPointer
+{
+public:
+
+  PublishedPointer()
+    : m_Generation(0)
+  {}
+
+  ~PublishedPointer()
+  {
+    T* value = m_Pointer.Load();
+    if (value != NULL) m_Pending.push_back(value);
+    Release(m_Waiting);
+    Release(m_Pending);
+  }
+
+  /**
+   * Assigns the published object, or NULL, to \c handle, which takes a
+   * reference to it (e.g. an ExplicitlySharedDataPointer). Does not lock.
+   */
+  template<class Handle>
+  void Load(Handle& handle) const
+  {
+    const AtomicCounter* readers = NULL;
+    for (;;)
+    {
+      const AtomicCounter::IntType generation = m_Generation.Load();
+      readers = &m_Readers[generation & 1];
+      readers->AtomicIncrement();
+      if (m_Generation.Load() == generation) break;
+      // a writer started a new generation and may not see this reader
+      readers->AtomicDecrement();
+    }
+    handle = m_Pointer.Load();
+    readers->AtomicDecrement();
+  }
+
+  /**
+   * Returns the published object without taking a reference. Only safe
+   * for the thread which serializes the calls to Store().
+   */
+  T* Get() const
+  {
+    return m_Pointer.Load();
+  }
+
+  /**
+   * Publishes \c value, or NULL, and retires the previous object.
+   */
+  void Store(T* value)
+  {
+    if (value != NULL) value->ref.Ref();
+    T* old = m_Pointer.Load();
+    m_Pointer.Store(value);
+    if (old != NULL) m_Pending.push_back(old);
+
+    // Objects retired before the last generation change are released
+    // when the readers of the previous generation are done. At most two
+    // rounds are needed to also release the objects retired since.
+    for (int round = 0; round < 2; ++round)
+    {
+      const AtomicCounter::IntType previous = (m_Generation.Load() + 1) & 1;
+      if (m_Readers[previous].Load() != 0) return;
+      Release(m_Waiting);
+      if (m_Pending.empty()) return;
+      m_Waiting.swap(m_Pending);
+      // readers which load the generation after this load the new object
+      m_Generation.AtomicIncrement();
+    }
+  }
+
+private:
+
+  static void Release(std::vector<T*>& objects)
+  {
+    for (typename std::vector<T*>::iterator iter = objects.begin();
+         iter != objects.end(); ++iter)
+    {
+      if (!(*iter)->ref.Deref()) delete *iter;
+    }
+    objects.clear();
+  }
+
+  // purposely not implemented
+  PublishedPointer(const PublishedPointer&);
+  PublishedPointer& operator=(const PublishedPointer&);
+
+  AtomicPointer<T> m_Pointer;
+  AtomicCounter m_Generation;
+  AtomicCounter m_Readers[2];
+
+  // retired since the last generation change
+  std::vector<T*> m_Pending;
+
+  // retired before the last generation change
+  std::vector<T*> m_Waiting;
 };
 
 class MutexLockingStrategy
@@ -257,6 +893,18 @@ public:
 #endif
   {}
 
+  /**
+   * Names the lock for the lock profiler, see Mutex::SetName().
+   */
+  void SetLockName(const char* name)
+  {
+#ifdef US_ENABLE_THREADING_SUPPORT
+    m_Mtx.SetName(name);
+#else
+    US_UNUSED(name);
+#endif
+  }
+
   class Lock;
   friend class Lock;
 
@@ -266,15 +914,15 @@ public:
 
 #ifdef US_ENABLE_THREADING_SUPPORT
     // Lock object
-    explicit Lock(const MutexLockingStrategy& host) : m_Host(host)
+    explicit Lock(const MutexLockingStrategy& host, const char* site = 0) : m_Host(host)
     {
-      m_Host.m_Mtx.Lock();
+      m_Host.m_Mtx.Lock(site);
     }
 
     // Lock object
-    explicit Lock(const MutexLockingStrategy* host) : m_Host(*host)
+    explicit Lock(const MutexLockingStrategy* host, const char* site = 0) : m_Host(*host)
     {
-      m_Host.m_Mtx.Lock();
+      m_Host.m_Mtx.Lock(site);
     }
 
     // Unlock object
@@ -283,8 +931,8 @@ public:
       m_Host.m_Mtx.Unlock();
     }
 #else
-    explicit Lock(const MutexLockingStrategy&) {}
-    explicit Lock(const MutexLockingStrategy*) {}
+    explicit Lock(const MutexLockingStrategy&, const char* = 0) {}
+    explicit Lock(const MutexLockingStrategy*, const char* = 0) {}
 #endif
 
   private:
@@ -305,6 +953,130 @@ protected:
 #endif
 };
 
+/**
+ * A locking strategy based on a SharedMutex. The Lock guard acquires
+ * the mutex exclusively and must be used for modifications, the
+ * SharedLock guard may be used by concurrent readers.
+ *
+ * Shared locks are not recursive and cannot be upgraded. This strategy
+ * cannot be combined with the WaitCondition strategy.
+ */
+class SharedMutexLockingStrategy
+{
+public:
+
+  SharedMutexLockingStrategy()
+#ifdef US_ENABLE_THREADING_SUPPORT
+    : m_Mtx()
+#endif
+  {}
+
+  SharedMutexLockingStrategy(const SharedMutexLockingStrategy&)
+#ifdef US_ENABLE_THREADING_SUPPORT
+    : m_Mtx()
+#endif
+  {}
+
+  /**
+   * Names the lock for the lock profiler, see Mutex::SetName().
+   */
+  void SetLockName(const char* name)
+  {
+#ifdef US_ENABLE_THREADING_SUPPORT
+    m_Mtx.SetName(name);
+#else
+    US_UNUSED(name);
+#endif
+  }
+
+  class Lock;
+  friend class Lock;
+  class SharedLock;
+  friend class SharedLock;
+
+  class Lock
+  {
+  public:
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+    // Lock object exclusively
+    explicit Lock(const SharedMutexLockingStrategy& host, const char* site = 0) : m_Host(host)
+    {
+      m_Host.m_Mtx.Lock(site);
+    }
+
+    // Lock object exclusively
+    explicit Lock(const SharedMutexLockingStrategy* host, const char* site = 0) : m_Host(*host)
+    {
+      m_Host.m_Mtx.Lock(site);
+    }
+
+    // Unlock object
+    ~Lock()
+    {
+      m_Host.m_Mtx.Unlock();
+    }
+#else
+    explicit Lock(const SharedMutexLockingStrategy&, const char* = 0) {}
+    explicit Lock(const SharedMutexLockingStrategy*, const char* = 0) {}
+#endif
+
+  private:
+
+    // private by design
+    Lock();
+    Lock(const Lock&);
+    Lock& operator=(const Lock&);
+#ifdef US_ENABLE_THREADING_SUPPORT
+    const SharedMutexLockingStrategy& m_Host;
+#endif
+  };
+
+  class SharedLock
+  {
+  public:
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+    // Lock object for reading
+    explicit SharedLock(const SharedMutexLockingStrategy& host, const char* site = 0) : m_Host(host)
+    {
+      m_Host.m_Mtx.LockShared(site);
+    }
+
+    // Lock object for reading
+    explicit SharedLock(const SharedMutexLockingStrategy* host, const char* site = 0) : m_Host(*host)
+    {
+      m_Host.m_Mtx.LockShared(site);
+    }
+
+    // Unlock object
+    ~SharedLock()
+    {
+      m_Host.m_Mtx.UnlockShared();
+    }
+#else
+    explicit SharedLock(const SharedMutexLockingStrategy&, const char* = 0) {}
+    explicit SharedLock(const SharedMutexLockingStrategy*, const char* = 0) {}
+#endif
+
+  private:
+
+    // private by design
+    SharedLock();
+    SharedLock(const SharedLock&);
+    SharedLock& operator=(const SharedLock&);
+#ifdef US_ENABLE_THREADING_SUPPORT
+    const SharedMutexLockingStrategy& m_Host;
+#endif
+  };
+
+protected:
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+  mutable SharedMutex m_Mtx;
+#endif
+};
+
 class NoLockingStrategy
 {
 };
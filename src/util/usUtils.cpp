@@ -29,9 +29,14 @@
 #include <cctype>
 #include <algorithm>
 
+#ifdef US_PLATFORM_APPLE
+  #include <mach/mach_time.h>
+#endif
+
 #ifdef US_PLATFORM_POSIX
   #include <errno.h>
   #include <string.h>
+  #include <time.h>
   #include <dlfcn.h>
   #include <dirent.h>
 #else
@@ -235,6 +240,32 @@ std::string GetLastErrorStr()
 #endif
 }
 
+long long GetMonotonicTime()
+{
+#ifdef US_PLATFORM_APPLE
+  static mach_timebase_info_data_t timeBase = { 0, 0 };
+  if (timeBase.denom == 0)
+  {
+    mach_timebase_info(&timeBase);
+  }
+  return static_cast<long long>(mach_absolute_time() * timeBase.numer / timeBase.denom);
+#elif defined(US_PLATFORM_POSIX)
+  timespec current;
+  clock_gettime(CLOCK_MONOTONIC, &current);
+  return static_cast<long long>(current.tv_sec) * 1000000000 + current.tv_nsec;
+#else
+  static LARGE_INTEGER frequency = { { 0, 0 } };
+  if (frequency.QuadPart == 0)
+  {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER current;
+  QueryPerformanceCounter(&current);
+  return static_cast<long long>(current.QuadPart / frequency.QuadPart * 1000000000 +
+                                current.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#endif
+}
+
 static MsgHandler handler = 0;
 
 MsgHandler installMsgHandler(MsgHandler h)
@@ -49,4 +49,54 @@ US_EXPORT std::string GetLastErrorStr();
 
 US_END_NAMESPACE
 
+//-------------------------------------------------------------------
+// Time
+//-------------------------------------------------------------------
+
+US_BEGIN_NAMESPACE
+
+/**
+ * Returns the time in nanoseconds from an arbitrary, monotonic origin.
+ */
+US_EXPORT long long GetMonotonicTime();
+
+/**
+ * The point in time at which a timed wait gives up. Waits which loop on
+ * spurious or unrelated wake-ups pass the remaining time on each
+ * iteration, so the total wait does not exceed the original timeout.
+ * A timeout of zero means no deadline, like in WaitCondition::Wait().
+ */
+class Deadline
+{
+public:
+
+  explicit Deadline(unsigned long timeoutMillis)
+    : m_Infinite(timeoutMillis == 0)
+    , m_Time(m_Infinite ? 0 : GetMonotonicTime() + timeoutMillis * 1000000LL)
+  {}
+
+  /**
+   * Computes the time left until the deadline, rounded up to milliseconds.
+   *
+   * @param millis Set to the time left, or to 0 if there is no deadline.
+   * @return <code>false</code> if the deadline has passed.
+   */
+  bool Remaining(unsigned long& millis) const
+  {
+    millis = 0;
+    if (m_Infinite) return true;
+    const long long left = m_Time - GetMonotonicTime();
+    if (left <= 0) return false;
+    millis = static_cast<unsigned long>((left + 999999) / 1000000);
+    return true;
+  }
+
+private:
+
+  bool m_Infinite;
+  long long m_Time;
+};
+
+US_END_NAMESPACE
+
 #endif // USUTILS_H
@@ -95,6 +95,8 @@ private:
 
   bool Wait(Mutex* mutex, unsigned long time = 0);
 
+  bool WaitUnprofiled(Mutex& mutex, unsigned long time);
+
   #ifdef US_PLATFORM_POSIX
   pthread_cond_t m_WaitCondition;
   #else
@@ -238,6 +240,16 @@ bool WaitCondition<MutexHost>::Wait(Mutex* mutex, unsigned long timeoutMillis)
 
 template<class MutexHost>
 bool WaitCondition<MutexHost>::Wait(Mutex& mutex, unsigned long timeoutMillis)
+{
+  // the mutex is released while waiting, which must not count as hold time
+  mutex.BeforeWait();
+  const bool result = WaitUnprofiled(mutex, timeoutMillis);
+  mutex.AfterWait();
+  return result;
+}
+
+template<class MutexHost>
+bool WaitCondition<MutexHost>::WaitUnprofiled(Mutex& mutex, unsigned long timeoutMillis)
 {
   #ifdef US_PLATFORM_POSIX
     struct timespec ts, * pts = 0;
@@ -0,0 +1,182 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include <usAny.h>
+
+#include "usTestingMacros.h"
+
+#include <ostream>
+
+US_USE_NAMESPACE
+
+namespace {
+
+// A type which is held on the heap and counts its live instances
+struct CountedValue
+{
+  CountedValue(int value) : value(value) { ++instances; }
+  CountedValue(const CountedValue& other) : value(other.value) { ++instances; }
+  ~CountedValue() { --instances; }
+
+  int value;
+
+  static int instances;
+
+private:
+  CountedValue& operator=(const CountedValue&);
+};
+
+int CountedValue::instances = 0;
+
+std::ostream& operator<<(std::ostream& os, const CountedValue& cv)
+{
+  return os << cv.value;
+}
+
+const std::string longText = "A string which is too long for the small string buffer";
+
+}
+
+void TestAnyTypeTags()
+{
+  US_TEST_CONDITION(Any(42).TypeTag() == ANY_TYPE_INT, "test int type tag")
+  US_TEST_CONDITION(Any(longText).TypeTag() == ANY_TYPE_STRING, "test string type tag")
+  US_TEST_CONDITION(Any(std::vector<std::string>(2, "x")).TypeTag() == ANY_TYPE_STRING_VECTOR, "test string vector type tag")
+  US_TEST_CONDITION(Any().TypeTag() == ANY_TYPE_EMPTY, "test empty type tag")
+  US_TEST_CONDITION(Any(std::map<std::string, Any>()).TypeTag() == ANY_TYPE_OTHER, "test untagged type")
+
+  Any value = 1.5;
+  US_TEST_CONDITION(value.TypeTag() == ANY_TYPE_DOUBLE && any_cast<double>(value) == 1.5, "test double value")
+  US_TEST_CONDITION(any_cast<float>(&value) == NULL, "test cast to wrong type")
+}
+
+void TestAnyCopy()
+{
+  Any text(longText);
+  Any copy(text);
+  US_TEST_CONDITION(ref_any_cast<std::string>(copy) == longText, "test copy of inline value")
+  ref_any_cast<std::string>(copy) = "changed";
+  US_TEST_CONDITION(ref_any_cast<std::string>(text) == longText, "test inline copy is independent")
+
+  {
+    Any counted = CountedValue(7);
+    Any countedCopy(counted);
+    US_TEST_CONDITION(CountedValue::instances == 2, "test copy of heap value")
+    US_TEST_CONDITION(any_cast<CountedValue>(countedCopy).value == 7, "test heap value copy")
+  }
+  US_TEST_CONDITION(CountedValue::instances == 0, "test destruction of heap values")
+
+  Any empty;
+  Any emptyCopy(empty);
+  US_TEST_CONDITION(emptyCopy.Empty() && emptyCopy.TypeTag() == ANY_TYPE_EMPTY, "test copy of empty value")
+}
+
+void TestAnySwap()
+{
+  {
+    Any inlineValue(longText);
+    Any heapValue = CountedValue(3);
+
+    inlineValue.Swap(heapValue);
+    US_TEST_CONDITION(inlineValue.Type() == typeid(CountedValue) && any_cast<CountedValue>(inlineValue).value == 3,
+                      "test swap of inline with heap value")
+    US_TEST_CONDITION(heapValue.TypeTag() == ANY_TYPE_STRING && ref_any_cast<std::string>(heapValue) == longText,
+                      "test swap of heap with inline value")
+    US_TEST_CONDITION(CountedValue::instances == 1, "test no heap value leaked by swap")
+
+    heapValue.Swap(inlineValue);
+    US_TEST_CONDITION(heapValue.Type() == typeid(CountedValue) && ref_any_cast<std::string>(inlineValue) == longText,
+                      "test swap back")
+    US_TEST_CONDITION(CountedValue::instances == 1, "test no heap value leaked by swap back")
+
+    Any other = CountedValue(4);
+    heapValue.Swap(other);
+    US_TEST_CONDITION(any_cast<CountedValue>(heapValue).value == 4 && any_cast<CountedValue>(other).value == 3,
+                      "test swap of heap values")
+
+    Any small = 42;
+    small.Swap(inlineValue);
+    US_TEST_CONDITION(any_cast<int>(inlineValue) == 42 && ref_any_cast<std::string>(small) == longText,
+                      "test swap of inline values")
+
+    Any empty;
+    empty.Swap(small);
+    US_TEST_CONDITION(small.Empty() && ref_any_cast<std::string>(empty) == longText, "test swap of empty with inline value")
+    small.Swap(other);
+    US_TEST_CONDITION(other.Empty() && any_cast<CountedValue>(small).value == 3, "test swap of empty with heap value")
+
+    inlineValue.Swap(inlineValue);
+    US_TEST_CONDITION(any_cast<int>(inlineValue) == 42, "test self swap of inline value")
+    small.Swap(small);
+    US_TEST_CONDITION(any_cast<CountedValue>(small).value == 3, "test self swap of heap value")
+
+    // inline strings are relocated, not copied, so swapping cannot throw
+    const char* text = ref_any_cast<std::string>(empty).data();
+    empty.Swap(inlineValue);
+    US_TEST_CONDITION(ref_any_cast<std::string>(inlineValue).data() == text, "test swap does not copy inline string")
+  }
+  US_TEST_CONDITION(CountedValue::instances == 0, "test destruction after swaps")
+}
+
+void TestAnyAssign()
+{
+  {
+    Any value(longText);
+    value = CountedValue(5);
+    US_TEST_CONDITION(ref_any_cast<CountedValue>(value).value == 5 && CountedValue::instances == 1,
+                      "test assignment of heap value to inline value")
+    value = std::string("text");
+    US_TEST_CONDITION(ref_any_cast<std::string>(value) == "text" && CountedValue::instances == 0,
+                      "test assignment of inline value to heap value")
+
+    Any heapValue = CountedValue(6);
+    value = heapValue;
+    US_TEST_CONDITION(ref_any_cast<CountedValue>(value).value == 6 && CountedValue::instances == 2,
+                      "test assignment of heap Any to inline Any")
+    Any inlineValue(longText);
+    value = inlineValue;
+    US_TEST_CONDITION(ref_any_cast<std::string>(value) == longText && CountedValue::instances == 1,
+                      "test assignment of inline Any to heap Any")
+
+    const Any& alias = value;
+    value = alias;
+    US_TEST_CONDITION(ref_any_cast<std::string>(value) == longText, "test self assignment of inline value")
+    const Any& heapAlias = heapValue;
+    heapValue = heapAlias;
+    US_TEST_CONDITION(any_cast<CountedValue>(heapValue).value == 6, "test self assignment of heap value")
+
+    value = Any();
+    US_TEST_CONDITION(value.Empty() && value.TypeTag() == ANY_TYPE_EMPTY, "test assignment of empty value")
+  }
+  US_TEST_CONDITION(CountedValue::instances == 0, "test destruction after assignments")
+}
+
+int usAnyTest(int /*argc*/, char* /*argv*/[])
+{
+  US_TEST_BEGIN("AnyTest");
+
+  TestAnyTypeTags();
+  TestAnyCopy();
+  TestAnySwap();
+  TestAnyAssign();
+
+  US_TEST_END()
+}
@@ -24,6 +24,7 @@
 
 #include "usTestingMacros.h"
 
+#include <sstream>
 #include <stdexcept>
 
 US_USE_NAMESPACE
@@ -157,11 +158,116 @@ void TestLDAPExpressions()
   US_TEST_CONDITION(filter1 == filter2, "test null expressions")
 }
 
+// A streamable value which cannot be held by us::Any
+class StreamableVersion
+{
+public:
+  StreamableVersion(int major, int minor) : major(major), minor(minor) {}
+
+  friend std::ostream& operator<<(std::ostream& os, const StreamableVersion& v)
+  {
+    return os << v.major << '.' << v.minor;
+  }
+
+private:
+  StreamableVersion(const StreamableVersion&);
+  StreamableVersion& operator=(const StreamableVersion&);
+
+  int major;
+  int minor;
+};
+
+void TestStreamableLDAPExpressions()
+{
+  ServiceProperties props;
+  props["version"] = std::string("1.2");
+
+  const StreamableVersion version(1, 2);
+  LDAPFilter filter(LDAPProp("version") == version);
+  US_TEST_CONDITION(filter.ToString() == "(version=1.2)", "test streamed filter string")
+  US_TEST_CONDITION(filter.Match(props), "test streamed value match")
+}
+
+void TestTypedLDAPExpressions()
+{
+  ServiceProperties props;
+  props["port"] = 8080;
+
+  LDAPFilter filter(LDAPProp("port") >= 8080);
+  US_TEST_CONDITION(filter.ToString() == "(port>=8080)", "test compiled filter string")
+  US_TEST_CONDITION(filter == LDAPFilter("(port>=8080)"), "test compiled filter equals parsed filter")
+  US_TEST_CONDITION(filter.Match(props), "test typed integer match")
+  props["port"] = 80;
+  US_TEST_CONDITION(!filter.Match(props), "test typed integer mismatch")
+  props["port"] = 9000L;
+  US_TEST_CONDITION(filter.Match(props), "test typed integer match with different property type")
+  props["port"] = std::string("9000");
+  US_TEST_CONDITION(filter.Match(props), "test typed integer match with string property")
+
+  props.clear();
+  props["count"] = 0u;
+  US_TEST_CONDITION(LDAPFilter(LDAPProp("count") >= -1).Match(props), "test signed value against unsigned property")
+  US_TEST_CONDITION(!LDAPFilter(LDAPProp("count") <= -1).Match(props), "test negative value against unsigned property")
+
+  props["ratio"] = 0.25;
+  US_TEST_CONDITION(LDAPFilter(LDAPProp("ratio") <= 0.5).Match(props), "test typed double match")
+  US_TEST_CONDITION(!LDAPFilter(LDAPProp("ratio") == 1).Match(props), "test typed double mismatch")
+
+  props["enabled"] = true;
+  LDAPFilter boolFilter(LDAPProp("enabled") == true);
+  US_TEST_CONDITION(boolFilter.ToString() == "(enabled=true)", "test compiled bool filter string")
+  US_TEST_CONDITION(boolFilter.Match(props), "test typed bool match")
+  US_TEST_CONDITION(LDAPFilter(boolFilter.ToString()).Match(props), "test parsed bool filter match")
+  US_TEST_CONDITION(!LDAPFilter(LDAPProp("enabled") != true).Match(props), "test typed bool inequality")
+
+  props["cn"] = std::string("Babs Jensen");
+  LDAPFilter wildcard(LDAPProp("cn") == "Babs *" && !LDAPProp("absent"));
+  US_TEST_CONDITION(wildcard.ToString() == "(&(cn=Babs *)(!(absent=*)))", "test compiled wildcard filter string")
+  US_TEST_CONDITION(wildcard.Match(props), "test compiled wildcard match")
+
+  std::vector<Any> list;
+  list.push_back(std::string("x"));
+  list.push_back(42);
+  props["list"] = list;
+  US_TEST_CONDITION(LDAPFilter(LDAPProp("list") == 42).Match(props), "test typed match in std::vector<Any>")
+
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, LDAPFilter(LDAPProp("empty") == std::string()))
+}
+
+void TestPropertyKeyLookup()
+{
+  ServiceProperties props;
+  for (int i = 0; i < 100; ++i)
+  {
+    std::stringstream ss;
+    ss << "Key" << i;
+    props[ss.str()] = i;
+  }
+  props["portable"] = true;
+
+  US_TEST_CONDITION(LDAPFilter("(key42=42)").Match(props), "test case insensitive key lookup")
+  US_TEST_CONDITION(!LDAPFilter("(key42=42)").MatchCase(props), "test case sensitive key lookup with wrong case")
+  US_TEST_CONDITION(LDAPFilter("(Key99=99)").MatchCase(props), "test case sensitive key lookup")
+  US_TEST_CONDITION(!LDAPFilter("(port=*)").Match(props), "test key prefix does not match")
+  US_TEST_CONDITION(!LDAPFilter("(key100=*)").Match(props), "test missing key")
+
+  props["Service.Ranking"] = 5;
+  US_TEST_CONDITION(LDAPFilter("(service.ranking>=5)").Match(props), "test well-known key lookup")
+  US_TEST_CONDITION(!LDAPFilter("(service.ranking>=5)").MatchCase(props), "test case sensitive well-known key lookup")
+  US_TEST_CONDITION(LDAPFilter("(Service.Ranking>=5)").MatchCase(props), "test case sensitive well-known key lookup with same case")
+
+  props["KEY42"] = 1;
+  US_TEST_FOR_EXCEPTION(const std::runtime_error&, LDAPFilter("(key42=42)").Match(props))
+}
+
 int usLDAPFilterTest(int /*argc*/, char* /*argv*/[])
 {
   US_TEST_BEGIN("LDAPFilterTest");
 
   TestLDAPExpressions();
+  TestTypedLDAPExpressions();
+  TestStreamableLDAPExpressions();
+  TestPropertyKeyLookup();
   US_TEST_CONDITION(TestParsing() == EXIT_SUCCESS, "Parsing LDAP expressions: ")
   US_TEST_CONDITION(TestEvaluate() == EXIT_SUCCESS, "Evaluating LDAP expressions: ")
 
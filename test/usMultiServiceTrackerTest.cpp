@@ -0,0 +1,130 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include <usGetModuleContext.h>
+#include <usModuleContext.h>
+#include <usMultiServiceTracker.h>
+#include <usServiceProperties.h>
+
+#include "usTestingMacros.h"
+
+#include <stdexcept>
+
+US_USE_NAMESPACE
+
+struct MultiTrackerInterfaceA {
+  virtual ~MultiTrackerInterfaceA() {}
+};
+US_DECLARE_SERVICE_INTERFACE(MultiTrackerInterfaceA, "org.cppmicroservices.multiservicetrackertest.MultiTrackerInterfaceA")
+
+struct MultiTrackerInterfaceB {
+  virtual ~MultiTrackerInterfaceB() {}
+};
+US_DECLARE_SERVICE_INTERFACE(MultiTrackerInterfaceB, "org.cppmicroservices.multiservicetrackertest.MultiTrackerInterfaceB")
+
+struct MultiTrackerServiceA : public MultiTrackerInterfaceA {};
+struct MultiTrackerServiceB : public MultiTrackerInterfaceB {};
+
+struct CountingListener : public MultiServiceTrackerListener
+{
+  int satisfied;
+  int unsatisfied;
+
+  CountingListener() : satisfied(0), unsatisfied(0) {}
+
+  void DependenciesSatisfied() { ++satisfied; }
+  void DependenciesUnsatisfied() { ++unsatisfied; }
+};
+
+namespace {
+
+void TestDependencies()
+{
+  ModuleContext* mc = GetModuleContext();
+
+  CountingListener listener;
+  MultiServiceTracker tracker(mc, &listener);
+  tracker.AddDependency<MultiTrackerInterfaceA>();
+  tracker.AddDependency<MultiTrackerInterfaceB>(LDAPFilter("(usable=true)"));
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, tracker.AddDependency<MultiTrackerInterfaceA>())
+
+  MultiTrackerServiceA serviceA;
+  ServiceRegistration<MultiTrackerInterfaceA> regA = mc->RegisterService<MultiTrackerInterfaceA>(&serviceA);
+
+  tracker.Open();
+  US_TEST_FOR_EXCEPTION(const std::logic_error&, tracker.AddDependency("org.cppmicroservices.multiservicetrackertest.Other"))
+  US_TEST_CONDITION(!tracker.IsSatisfied(), "Not satisfied without B")
+  US_TEST_CONDITION(tracker.GetServiceReference<MultiTrackerInterfaceA>() == regA.GetReference(), "Initial A tracked")
+  US_TEST_CONDITION(!tracker.GetServiceReference<MultiTrackerInterfaceB>(), "No B tracked")
+  US_TEST_CONDITION(listener.satisfied == 0, "No satisfied notification")
+
+  // B does not match the dependency filter
+  MultiTrackerServiceB serviceB;
+  ServiceRegistration<MultiTrackerInterfaceB> regB = mc->RegisterService<MultiTrackerInterfaceB>(&serviceB);
+  US_TEST_CONDITION(!tracker.IsSatisfied(), "Filtered B not tracked")
+
+  ServiceProperties props;
+  props["usable"] = true;
+  regB.SetProperties(props);
+  US_TEST_CONDITION(tracker.IsSatisfied(), "Satisfied after B modified")
+  US_TEST_CONDITION(listener.satisfied == 1, "Satisfied notification")
+  US_TEST_CONDITION(tracker.GetServiceHandle<MultiTrackerInterfaceB>().Get() == &serviceB, "B handle")
+
+  // A higher ranked A becomes the best service
+  MultiTrackerServiceA serviceA2;
+  ServiceProperties propsA2;
+  propsA2[ServiceConstants::SERVICE_RANKING()] = 5;
+  ServiceRegistration<MultiTrackerInterfaceA> regA2 = mc->RegisterService<MultiTrackerInterfaceA>(&serviceA2, propsA2);
+  US_TEST_CONDITION(tracker.GetServiceReference<MultiTrackerInterfaceA>() == regA2.GetReference(), "Highest ranked A")
+  US_TEST_CONDITION(tracker.GetServiceReferences(us_service_interface_iid<MultiTrackerInterfaceA>()).size() == 2, "Two A tracked")
+  US_TEST_CONDITION(listener.satisfied == 1, "No repeated satisfied notification")
+
+  regA2.Unregister();
+  US_TEST_CONDITION(tracker.GetServiceReference<MultiTrackerInterfaceA>() == regA.GetReference(), "A again the best")
+  regA.Unregister();
+  US_TEST_CONDITION(!tracker.IsSatisfied(), "Unsatisfied without A")
+  US_TEST_CONDITION(listener.unsatisfied == 1, "Unsatisfied notification")
+
+  regA = mc->RegisterService<MultiTrackerInterfaceA>(&serviceA);
+  US_TEST_CONDITION(listener.satisfied == 2, "Satisfied again")
+
+  tracker.Close();
+  US_TEST_CONDITION(listener.unsatisfied == 2, "Unsatisfied on close")
+  int trackingCount = tracker.GetTrackingCount();
+  US_TEST_CONDITION(!tracker.GetServiceReference<MultiTrackerInterfaceA>(), "No A tracked after close")
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, tracker.GetServiceReference("org.cppmicroservices.multiservicetrackertest.Other"))
+
+  regB.Unregister();
+  US_TEST_CONDITION(tracker.GetTrackingCount() == trackingCount, "No tracking after close")
+
+  regA.Unregister();
+}
+
+}
+
+int usMultiServiceTrackerTest(int /*argc*/, char* /*argv*/[])
+{
+  US_TEST_BEGIN("MultiServiceTrackerTest")
+
+  TestDependencies();
+
+  US_TEST_END()
+}
@@ -167,6 +167,14 @@ void TestServiceFactoryPrototypeScope()
                              "GetService()")
 
   svcObjectsVoid.UngetService(prototypeServiceH2Void);
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, svcObjectsVoid.UngetService(prototypeServiceH2Void))
+
+  // an equal copy of the interface map identifies the same service object
+  InterfaceMap prototypeServiceH2Void2 = svcObjectsVoid.GetService();
+  US_TEST_CONDITION_REQUIRED(prototypeServiceH2Void2 != prototypeServiceH2Void, "new prototype service")
+  InterfaceMap prototypeServiceH2Void2Copy(prototypeServiceH2Void2.begin(), prototypeServiceH2Void2.end());
+  svcObjectsVoid.UngetService(prototypeServiceH2Void2Copy);
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, svcObjectsVoid.UngetService(prototypeServiceH2Void2))
 
   TestModuleH2* moduleScopeService2 = mc->GetService(sr1);
   US_TEST_CONDITION(moduleScopeService == moduleScopeService2, "Same service pointer")
@@ -20,9 +20,15 @@
 =============================================================================*/
 
 #include "usTestingMacros.h"
+#include "usTestThread.h"
 
 #include <usGetModuleContext.h>
 #include <usModuleContext.h>
+#include <usLockProfiler.h>
+#include <usModuleSettings.h>
+#include <usServiceTracker.h>
+
+#include <usThreads_p.h>
 
 US_USE_NAMESPACE
 
@@ -169,6 +175,13 @@ struct IPerfTestService
 
 US_DECLARE_SERVICE_INTERFACE(IPerfTestService, "org.cppmicroservices.test.IPerfTestService")
 
+struct IPerfTestTrackedService
+{
+  virtual ~IPerfTestTrackedService() {}
+};
+
+US_DECLARE_SERVICE_INTERFACE(IPerfTestTrackedService, "org.cppmicroservices.test.IPerfTestTrackedService")
+
 
 class ServiceRegistryPerformanceTest
 {
@@ -181,6 +194,8 @@ private:
 
   int nListeners;
   int nServices;
+  int nTrackers;
+  int nTrackedServices;
 
   std::size_t nRegistered;
   std::size_t nUnregistering;
@@ -203,6 +218,8 @@ public:
   void TestModifyServices();
   void TestUnregisterServices();
 
+  void TestOpenTrackers();
+
 private:
 
   std::ostream& Log() const
@@ -255,6 +272,8 @@ ServiceRegistryPerformanceTest::ServiceRegistryPerformanceTest(ModuleContext* co
   : mc(context)
   , nListeners(100)
   , nServices(1000)
+  , nTrackers(10)
+  , nTrackedServices(10000)
   , nRegistered(0)
   , nUnregistering(0)
   , nModified(0)
@@ -407,6 +426,411 @@ void ServiceRegistryPerformanceTest::UnregisterServices()
   regs.clear();
 }
 
+void ServiceRegistryPerformanceTest::TestOpenTrackers()
+{
+  class PerfTestTrackedService : public IPerfTestTrackedService
+  {
+  };
+
+  Log() << "Open " << nTrackers << " service trackers over "
+        << nTrackedServices << " services\n";
+
+  std::vector<PerfTestTrackedService*> trackedServices;
+  std::vector<ServiceRegistration<IPerfTestTrackedService> > trackedRegs;
+  for(int i = 0; i < nTrackedServices; i++)
+  {
+    ServiceProperties props;
+    props[ServiceConstants::SERVICE_RANKING()] = i % 10;
+
+    PerfTestTrackedService* service = new PerfTestTrackedService();
+    trackedServices.push_back(service);
+    trackedRegs.push_back(mc->RegisterService<IPerfTestTrackedService>(service, props));
+  }
+
+  HighPrecisionTimer t;
+  t.Start();
+  bool allTracked = true;
+  for(int i = 0; i < nTrackers; i++)
+  {
+    ServiceTracker<IPerfTestTrackedService> tracker(mc);
+    tracker.Open();
+    allTracked = allTracked && tracker.Size() == nTrackedServices;
+    tracker.Close();
+  }
+  long long ms = t.ElapsedMilli();
+  Log() << "opening " << nTrackers << " trackers took " << ms << "ms\n";
+  US_TEST_CONDITION(allTracked, "Trackers must track all services")
+
+  for(std::size_t i = 0; i < trackedRegs.size(); i++)
+  {
+    trackedRegs[i].Unregister();
+    delete trackedServices[i];
+  }
+}
+
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+
+/**
+ * Measures how the listener registry, the service tracker cache and the
+ * module settings scale when they are read by several threads at once.
+ * Each phase runs the same amount of work with one thread and with
+ * nThreads threads.
+ */
+class ServiceRegistryContentionTest
+{
+
+public:
+
+  ServiceRegistryContentionTest(ModuleContext* context)
+    : mc(context)
+    , nThreads(4)
+    , nListeners(100)
+    , nServices(400)
+    , nRounds(5)
+    , nReads(200000)
+    , nCopies(4000000)
+  {
+  }
+
+  void InitTestCase()
+  {
+    Log() << "adding " << nListeners << " service listeners\n";
+    for (int i = 0; i < nListeners; ++i)
+    {
+      listeners.push_back(new CountingListener(this));
+      mc->AddServiceListener(listeners.back(), &CountingListener::ServiceChanged,
+                             "(perf.service.value>=0)");
+    }
+
+    class PerfTestService : public IPerfTestService
+    {
+    };
+
+    for (int i = 0; i < nServices; ++i)
+    {
+      ServiceProperties props;
+      props["perf.service.value"] = i;
+      services.push_back(new PerfTestService());
+      regs.push_back(mc->RegisterService<IPerfTestService>(services.back(), props));
+    }
+  }
+
+  void CleanupTestCase()
+  {
+    for (std::size_t i = 0; i < regs.size(); ++i)
+    {
+      regs[i].Unregister();
+    }
+    regs.clear();
+    for (std::size_t i = 0; i < services.size(); ++i)
+    {
+      delete services[i];
+    }
+    services.clear();
+    for (std::size_t i = 0; i < listeners.size(); ++i)
+    {
+      mc->RemoveServiceListener(listeners[i], &CountingListener::ServiceChanged);
+      delete listeners[i];
+    }
+    listeners.clear();
+  }
+
+  void TestConcurrentModifyServices()
+  {
+    Log() << "Modify " << nServices << " services " << nRounds << " times with "
+          << nListeners << " listeners\n";
+
+    long long ms1 = ModifyServices(1);
+    long long msN = ModifyServices(nThreads);
+    Log() << "modify took " << ms1 << "ms with 1 thread, " << msN << "ms with "
+          << nThreads << " threads\n";
+  }
+
+  void TestConcurrentTrackerGetService()
+  {
+    Log() << "Get the tracked service " << nReads << " times\n";
+
+    ServiceTracker<IPerfTestService> tracker(mc);
+    tracker.Open();
+    US_TEST_CONDITION_REQUIRED(tracker.GetService() != NULL, "Tracked service")
+
+    long long ms1 = ReadTracker(tracker, 1);
+    long long msN = ReadTracker(tracker, nThreads);
+    Log() << "tracker reads took " << ms1 << "ms with 1 thread, " << msN << "ms with "
+          << nThreads << " threads\n";
+
+    tracker.Close();
+  }
+
+  void TestConcurrentModuleSettings()
+  {
+    Log() << "Read the module settings " << nReads / 10 << " times\n";
+
+    long long ms1 = ReadSettings(1);
+    long long msN = ReadSettings(nThreads);
+    Log() << "settings reads took " << ms1 << "ms with 1 thread, " << msN << "ms with "
+          << nThreads << " threads\n";
+  }
+
+  void TestConcurrentReferenceCopies()
+  {
+#ifdef US_HAVE_STD_ATOMIC
+    Log() << "Copy service references " << nCopies << " times (std::atomic reference counts)\n";
+#else
+    Log() << "Copy service references " << nCopies << " times (intrinsic reference counts)\n";
+#endif
+
+    long long ms1 = CopyReferences(1, true);
+    long long msShared = CopyReferences(nThreads, true);
+    long long msPrivate = CopyReferences(nThreads, false);
+    Log() << "copies took " << ms1 << "ms with 1 thread, " << msShared << "ms with "
+          << nThreads << " threads sharing one reference, " << msPrivate << "ms with "
+          << nThreads << " threads using their own reference\n";
+  }
+
+private:
+
+  class CountingListener
+  {
+  public:
+
+    CountingListener(ServiceRegistryContentionTest* ts) : ts(ts) {}
+
+    void ServiceChanged(const ServiceEvent ev)
+    {
+      if (ev.GetType() == ServiceEvent::MODIFIED)
+      {
+        ts->nModified.AtomicIncrement();
+      }
+    }
+
+  private:
+
+    ServiceRegistryContentionTest* ts;
+  };
+
+  class ModifyThread : public TestThread
+  {
+  public:
+
+    ModifyThread(ServiceRegistryContentionTest* ts, int index, int count)
+      : ts(ts), index(index), count(count)
+    {}
+
+  protected:
+
+    void Run()
+    {
+      for (int round = 0; round < ts->nRounds; ++round)
+      {
+        for (std::size_t i = index; i < ts->regs.size(); i += count)
+        {
+          ServiceProperties props;
+          props["perf.service.value"] = round;
+          ts->regs[i].SetProperties(props);
+        }
+      }
+    }
+
+  private:
+
+    ServiceRegistryContentionTest* ts;
+    int index;
+    int count;
+  };
+
+  class TrackerThread : public TestThread
+  {
+  public:
+
+    TrackerThread(ServiceTracker<IPerfTestService>& tracker, int reads)
+      : misses(0), tracker(tracker), reads(reads)
+    {}
+
+    int misses;
+
+  protected:
+
+    void Run()
+    {
+      for (int i = 0; i < reads; ++i)
+      {
+        if (tracker.GetService() == NULL) ++misses;
+      }
+    }
+
+  private:
+
+    ServiceTracker<IPerfTestService>& tracker;
+    int reads;
+  };
+
+  class SettingsThread : public TestThread
+  {
+  public:
+
+    SettingsThread(int reads) : misses(0), reads(reads) {}
+
+    int misses;
+
+  protected:
+
+    void Run()
+    {
+      for (int i = 0; i < reads; ++i)
+      {
+        if (ModuleSettings::GetAutoLoadPaths().empty()) ++misses;
+      }
+    }
+
+  private:
+
+    int reads;
+  };
+
+  class CopyThread : public TestThread
+  {
+  public:
+
+    CopyThread(const ServiceReference<IPerfTestService>& ref, int copies)
+      : ref(ref), copies(copies)
+    {}
+
+  protected:
+
+    void Run()
+    {
+      for (int i = 0; i < copies; ++i)
+      {
+        // every copy increments and decrements the shared reference count
+        ServiceReference<IPerfTestService> copy(ref);
+        US_UNUSED(copy);
+      }
+    }
+
+  private:
+
+    const ServiceReference<IPerfTestService>& ref;
+    int copies;
+  };
+
+  template<class Thread>
+  long long RunThreads(std::vector<Thread*>& threads)
+  {
+    HighPrecisionTimer t;
+    t.Start();
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      threads[i]->Start();
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      threads[i]->Join();
+    }
+    return t.ElapsedMilli();
+  }
+
+  long long ModifyServices(int count)
+  {
+    nModified = AtomicCounter();
+
+    std::vector<ModifyThread*> threads;
+    for (int i = 0; i < count; ++i)
+    {
+      threads.push_back(new ModifyThread(this, i, count));
+    }
+    long long ms = RunThreads(threads);
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      delete threads[i];
+    }
+
+    US_TEST_CONDITION_REQUIRED(static_cast<long long>(nModified.Load()) ==
+                               static_cast<long long>(nServices) * nRounds * nListeners,
+                               "# MODIFIED events must be same as # of modifications * # of listeners")
+    return ms;
+  }
+
+  long long CopyReferences(int count, bool shared)
+  {
+    std::vector<ServiceReference<IPerfTestService> > refs;
+    for (int i = 0; i < count; ++i)
+    {
+      refs.push_back(regs[shared ? 0 : i].GetReference());
+    }
+
+    std::vector<CopyThread*> threads;
+    for (int i = 0; i < count; ++i)
+    {
+      threads.push_back(new CopyThread(refs[i], nCopies / count));
+    }
+    long long ms = RunThreads(threads);
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      delete threads[i];
+    }
+    return ms;
+  }
+
+  long long ReadTracker(ServiceTracker<IPerfTestService>& tracker, int count)
+  {
+    std::vector<TrackerThread*> threads;
+    for (int i = 0; i < count; ++i)
+    {
+      threads.push_back(new TrackerThread(tracker, nReads / count));
+    }
+    long long ms = RunThreads(threads);
+    int misses = 0;
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      misses += threads[i]->misses;
+      delete threads[i];
+    }
+    US_TEST_CONDITION_REQUIRED(misses == 0, "Tracked service available in all threads")
+    return ms;
+  }
+
+  long long ReadSettings(int count)
+  {
+    std::vector<SettingsThread*> threads;
+    for (int i = 0; i < count; ++i)
+    {
+      threads.push_back(new SettingsThread(nReads / 10 / count));
+    }
+    long long ms = RunThreads(threads);
+    int misses = 0;
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+      misses += threads[i]->misses;
+      delete threads[i];
+    }
+    US_TEST_CONDITION_REQUIRED(misses == 0, "Auto-load paths available in all threads")
+    return ms;
+  }
+
+  std::ostream& Log() const
+  {
+    return std::cout;
+  }
+
+  ModuleContext* mc;
+
+  int nThreads;
+  int nListeners;
+  int nServices;
+  int nRounds;
+  int nReads;
+  int nCopies;
+
+  AtomicCounter nModified;
+
+  std::vector<CountingListener*> listeners;
+  std::vector<IPerfTestService*> services;
+  std::vector<ServiceRegistration<IPerfTestService> > regs;
+};
+
+#endif // US_ENABLE_THREADING_SUPPORT
 
 int usServiceRegistryPerformanceTest(int /*argc*/, char* /*argv*/[])
 {
@@ -418,7 +842,27 @@ int usServiceRegistryPerformanceTest(int /*argc*/, char* /*argv*/[])
   perfTest.TestRegisterServices();
   perfTest.TestModifyServices();
   perfTest.TestUnregisterServices();
+  perfTest.TestOpenTrackers();
   perfTest.CleanupTestCase();
 
+#ifdef US_ENABLE_THREADING_SUPPORT
+  ServiceRegistryContentionTest contentionTest(GetModuleContext());
+  contentionTest.InitTestCase();
+  contentionTest.TestConcurrentModifyServices();
+  contentionTest.TestConcurrentTrackerGetService();
+  contentionTest.TestConcurrentModuleSettings();
+  contentionTest.TestConcurrentReferenceCopies();
+  contentionTest.CleanupTestCase();
+#endif
+
+  if (LockProfiler::IsEnabled())
+  {
+    std::stringstream report;
+    LockProfiler::Report(report);
+    std::cout << report.str();
+    US_TEST_CONDITION(report.str().find("ServiceRegistry::mutex") != std::string::npos,
+                      "Lock profile of the service registry")
+  }
+
   US_TEST_END()
 }
@@ -20,12 +20,21 @@
 =============================================================================*/
 
 #include <usLDAPFilter.h>
+#include <usLDAPProp.h>
 
 #include "usTestingMacros.h"
+#include "usTestThread.h"
 #include <usServiceInterface.h>
 #include <usGetModuleContext.h>
+#include <usModule.h>
 #include <usModuleContext.h>
+#include <usPrototypeServiceFactory.h>
+#include <usServiceObjects.h>
+#include <usServiceHandle.h>
+#include <usServiceTracker.h>
+#include <usServiceFindHook.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 US_USE_NAMESPACE
@@ -126,6 +135,627 @@ int TestServicePropertiesUpdate()
   return EXIT_SUCCESS;
 }
 
+struct TestModifiedListener
+{
+  TestModifiedListener() : modified(0), endMatch(0) {}
+
+  void ServiceChanged(const ServiceEvent event)
+  {
+    if (event.GetType() == ServiceEvent::MODIFIED) ++modified;
+    else if (event.GetType() == ServiceEvent::MODIFIED_ENDMATCH) ++endMatch;
+  }
+
+  int modified;
+  int endMatch;
+};
+
+int TestServicePropertiesDelta()
+{
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+
+  TestServiceA s1;
+  ServiceProperties props;
+  props["Port"] = 80;
+  props["tag"] = std::string("on");
+  props["host"] = std::string("localhost");
+  ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1, props);
+  ServiceReference<ITestServiceA> ref1 = reg1.GetReference();
+  const long int sid = any_cast<long int>(ref1.GetProperty(ServiceConstants::SERVICE_ID()));
+
+  TestModifiedListener listener;
+  context->AddServiceListener(&listener, &TestModifiedListener::ServiceChanged, LDAPProp("tag") == "on");
+
+  ServiceProperties changed;
+  changed["port"] = 8080;
+  changed[ServiceConstants::SERVICE_ID()] = 42L;
+  std::vector<std::string> removed;
+  removed.push_back("TAG");
+  removed.push_back(ServiceConstants::OBJECTCLASS());
+  reg1.UpdateProperties(changed, removed);
+
+  std::vector<std::string> keys;
+  ref1.GetPropertyKeys(keys);
+  US_TEST_CONDITION_REQUIRED(std::find(keys.begin(), keys.end(), "Port") == keys.end(), "Testing replaced key spelling")
+  US_TEST_CONDITION_REQUIRED(std::find(keys.begin(), keys.end(), "port") != keys.end(), "Testing new key spelling")
+  US_TEST_CONDITION_REQUIRED(any_cast<int>(ref1.GetProperty("PORT")) == 8080, "Testing updated property")
+  US_TEST_CONDITION_REQUIRED(ref1.GetProperty("tag").Empty(), "Testing removed property")
+  US_TEST_CONDITION_REQUIRED(any_cast<std::string>(ref1.GetProperty("host")) == "localhost", "Testing unchanged property")
+  US_TEST_CONDITION_REQUIRED(any_cast<long int>(ref1.GetProperty(ServiceConstants::SERVICE_ID())) == sid, "Testing unchanged service id")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReferences<ITestServiceA>().size() == 1, "Testing unchanged object class")
+  US_TEST_CONDITION_REQUIRED(listener.endMatch == 1 && listener.modified == 0, "Testing MODIFIED_ENDMATCH event")
+
+  changed.clear();
+  changed["tag"] = std::string("on");
+  reg1.UpdateProperties(changed);
+  US_TEST_CONDITION_REQUIRED(listener.endMatch == 1 && listener.modified == 1, "Testing MODIFIED event")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReferences<ITestServiceA>(LDAPProp("port") == 8080 && LDAPProp("tag") == "on").size() == 1,
+                             "Testing filter on updated properties")
+
+  changed["Tag"] = std::string("off");
+  US_TEST_FOR_EXCEPTION(const std::runtime_error&, reg1.UpdateProperties(changed))
+  US_TEST_CONDITION_REQUIRED(any_cast<std::string>(ref1.GetProperty("tag")) == "on", "Testing properties unchanged after failed update")
+
+  context->RemoveServiceListener(&listener, &TestModifiedListener::ServiceChanged);
+  reg1.Unregister();
+  US_TEST_FOR_EXCEPTION(const std::logic_error&, reg1.UpdateProperties(changed))
+
+  return EXIT_SUCCESS;
+}
+
+int TestSingletonServiceUseCount()
+{
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+
+  TestServiceA s1;
+  ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1);
+  ServiceReference<ITestServiceA> ref1 = reg1.GetReference();
+
+  std::vector<Module*> modules;
+  ref1.GetUsingModules(modules);
+  US_TEST_CONDITION_REQUIRED(modules.empty(), "Testing unused service")
+  US_TEST_CONDITION_REQUIRED(!context->UngetService(ref1), "Testing unget of unused service")
+
+  US_TEST_CONDITION_REQUIRED(context->GetService(ref1) == &s1, "Testing first service use")
+  US_TEST_CONDITION_REQUIRED(context->GetService(ref1) == &s1, "Testing cached service")
+  ref1.GetUsingModules(modules);
+  US_TEST_CONDITION_REQUIRED(modules.size() == 1 && modules.front() == context->GetModule(), "Testing using modules")
+
+  US_TEST_CONDITION_REQUIRED(!context->UngetService(ref1), "Testing unget with remaining use count")
+  US_TEST_CONDITION_REQUIRED(context->UngetService(ref1), "Testing unget of last use")
+  US_TEST_CONDITION_REQUIRED(!context->UngetService(ref1), "Testing unbalanced unget")
+  modules.clear();
+  ref1.GetUsingModules(modules);
+  US_TEST_CONDITION_REQUIRED(modules.empty(), "Testing service unused after unget")
+
+  US_TEST_CONDITION_REQUIRED(context->GetService(ref1) == &s1, "Testing service use after unget")
+  reg1.Unregister();
+  modules.clear();
+  ref1.GetUsingModules(modules);
+  US_TEST_CONDITION_REQUIRED(modules.empty(), "Testing using modules after unregistration")
+
+  return EXIT_SUCCESS;
+}
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+
+// Gets and ungets a singleton service until it is unregistered or
+// the iterations are done
+class SingletonServiceUser : public TestThread
+{
+
+public:
+
+  SingletonServiceUser(ModuleContext* context, const ServiceReference<ITestServiceA>& ref,
+                       ITestServiceA* service)
+    : wrongService(0), context(context), ref(ref), service(service)
+  {}
+
+  int wrongService;
+
+protected:
+
+  void Run()
+  {
+    for (int i = 0; i < 20000; ++i)
+    {
+      ITestServiceA* s = NULL;
+      try
+      {
+        s = context->GetService(ref);
+      }
+      catch (const std::invalid_argument&)
+      {
+        // the service was unregistered
+        return;
+      }
+      if (s == NULL) continue;
+      if (s != service) ++wrongService;
+      context->UngetService(ref);
+    }
+  }
+
+private:
+
+  ModuleContext* context;
+  ServiceReference<ITestServiceA> ref;
+  ITestServiceA* service;
+};
+
+#endif
+
+int TestConcurrentSingletonServiceUse()
+{
+#ifdef US_ENABLE_THREADING_SUPPORT
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+  const std::size_t threadCount = 4;
+
+  for (int round = 0; round < 5; ++round)
+  {
+    TestServiceA s1;
+    ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1);
+    ServiceReference<ITestServiceA> ref1 = reg1.GetReference();
+
+    // balanced use racing with unbalanced ungets, which must never
+    // drive the use count below zero
+    std::vector<SingletonServiceUser*> users;
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      users.push_back(new SingletonServiceUser(context, ref1, &s1));
+      users.back()->Start();
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+      context->UngetService(ref1);
+    }
+    int wrongService = 0;
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      users[i]->Join();
+      wrongService += users[i]->wrongService;
+      delete users[i];
+    }
+    users.clear();
+    US_TEST_CONDITION_REQUIRED(wrongService == 0, "Testing concurrently used service object")
+    US_TEST_CONDITION_REQUIRED(!context->UngetService(ref1), "Testing use count after concurrent use")
+    US_TEST_CONDITION_REQUIRED(context->GetService(ref1) == &s1, "Testing service use after concurrent use")
+    US_TEST_CONDITION_REQUIRED(context->UngetService(ref1), "Testing balanced use count after concurrent use")
+
+    // use racing with unregistration
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      users.push_back(new SingletonServiceUser(context, ref1, &s1));
+      users.back()->Start();
+    }
+    reg1.Unregister();
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      users[i]->Join();
+      wrongService += users[i]->wrongService;
+      delete users[i];
+    }
+    US_TEST_CONDITION_REQUIRED(wrongService == 0, "Testing service object during unregistration")
+    US_TEST_CONDITION_REQUIRED(!context->UngetService(ref1), "Testing unget after concurrent unregistration")
+    std::vector<Module*> modules;
+    ref1.GetUsingModules(modules);
+    US_TEST_CONDITION_REQUIRED(modules.empty(), "Testing using modules after concurrent unregistration")
+  }
+#endif
+
+  return EXIT_SUCCESS;
+}
+
+int TestServiceHandle()
+{
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+
+  ServiceHandle<ITestServiceA> invalid;
+  US_TEST_CONDITION_REQUIRED(!invalid && invalid.Get() == NULL, "Testing invalid handle")
+
+  TestServiceA s1;
+  ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1);
+  ServiceReference<ITestServiceA> ref1 = reg1.GetReference();
+
+  std::vector<Module*> modules;
+  {
+    ServiceHandle<ITestServiceA> handle = context->GetServiceHandle(ref1);
+    US_TEST_CONDITION_REQUIRED(handle && handle.Get() == &s1, "Testing pinned service")
+    US_TEST_CONDITION_REQUIRED(handle.GetServiceReference() == ref1, "Testing handle reference")
+
+    ServiceHandle<ITestServiceA> copy = handle;
+    US_TEST_CONDITION_REQUIRED(copy.Get() == &s1, "Testing copied handle")
+    ref1.GetUsingModules(modules);
+    US_TEST_CONDITION_REQUIRED(modules.size() == 1, "Testing handle use count")
+  }
+  modules.clear();
+  ref1.GetUsingModules(modules);
+  US_TEST_CONDITION_REQUIRED(modules.empty(), "Testing released handle use count")
+
+  ServiceTracker<ITestServiceA> tracker(context);
+  tracker.Open();
+  ServiceHandle<ITestServiceA> trackedHandle = tracker.GetServiceHandle();
+  US_TEST_CONDITION_REQUIRED(trackedHandle.Get() == &s1, "Testing tracker service handle")
+
+  reg1.Unregister();
+  US_TEST_CONDITION_REQUIRED(!trackedHandle && trackedHandle.Get() == NULL, "Testing handle after unregistration")
+  US_TEST_CONDITION_REQUIRED(!tracker.GetServiceHandle(), "Testing tracker handle without services")
+  tracker.Close();
+
+  return EXIT_SUCCESS;
+}
+
+int TestCompiledFilterLookup()
+{
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+
+  TestServiceA s1;
+  TestServiceA s2;
+  ServiceProperties props;
+  props["port"] = 80;
+  ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1, props);
+  props["port"] = 8080;
+  ServiceRegistration<ITestServiceA> reg2 = context->RegisterService<ITestServiceA>(&s2, props);
+
+  const LDAPFilter filter(LDAPProp("port") >= 8080);
+  std::vector<ServiceReference<ITestServiceA> > refs = context->GetServiceReferences<ITestServiceA>(filter);
+  US_TEST_CONDITION_REQUIRED(refs.size() == 1, "Testing compiled filter lookup")
+  US_TEST_CONDITION_REQUIRED(context->GetService(refs.front()) == &s2, "Testing compiled filter lookup result")
+
+  std::vector<ServiceReferenceU> refsU = context->GetServiceReferences("", LDAPFilter(
+        LDAPProp(ServiceConstants::OBJECTCLASS()) == us_service_interface_iid<ITestServiceA>() &&
+        LDAPProp("port") <= 8080));
+  US_TEST_CONDITION_REQUIRED(refsU.size() == 2, "Testing compiled filter lookup without class name")
+
+  refs = context->GetServiceReferences<ITestServiceA>(LDAPFilter());
+  US_TEST_CONDITION_REQUIRED(refs.size() == 2, "Testing invalid filter lookup")
+
+  reg1.Unregister();
+  reg2.Unregister();
+
+  return EXIT_SUCCESS;
+}
+
+struct TestPooledService : public ITestServiceA
+{
+  TestPooledService() : state(0) {}
+  int state;
+};
+
+struct TestPooledServiceFactory : public PrototypeServiceFactory
+{
+  TestPooledServiceFactory() : created(0), released(0) {}
+
+  InterfaceMap GetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/)
+  {
+    ++created;
+    return MakeInterfaceMap<ITestServiceA>(new TestPooledService);
+  }
+
+  void UngetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/,
+                    const InterfaceMap& service)
+  {
+    ++released;
+    delete static_cast<TestPooledService*>(
+          reinterpret_cast<ITestServiceA*>(service.find(us_service_interface_iid<ITestServiceA>())->second));
+  }
+
+  bool ResetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/,
+                    const InterfaceMap& service)
+  {
+    static_cast<TestPooledService*>(
+          reinterpret_cast<ITestServiceA*>(service.find(us_service_interface_iid<ITestServiceA>())->second))->state = 0;
+    return true;
+  }
+
+  int created;
+  int released;
+};
+
+int TestPrototypeServicePool()
+{
+  ModuleContext* context = GetModuleContext();
+
+  TestPooledServiceFactory factory;
+  ServiceProperties props;
+  props[ServiceConstants::SERVICE_POOL_SIZE()] = 1;
+  ServiceRegistration<ITestServiceA> reg = context->RegisterService<ITestServiceA>(&factory, props);
+
+  ServiceObjects<ITestServiceA> serviceObjects = context->GetServiceObjects(reg.GetReference());
+  ITestServiceA* service1 = serviceObjects.GetService();
+  ITestServiceA* service2 = serviceObjects.GetService();
+  US_TEST_CONDITION_REQUIRED(service1 && service2 && service1 != service2, "Testing distinct prototype instances")
+  static_cast<TestPooledService*>(service1)->state = 42;
+
+  serviceObjects.UngetService(service1);
+  serviceObjects.UngetService(service2);
+  US_TEST_CONDITION(factory.released == 1, "Testing pool size limit")
+
+  ITestServiceA* service3 = serviceObjects.GetService();
+  US_TEST_CONDITION(service3 == service1, "Testing pooled instance reuse")
+  US_TEST_CONDITION(static_cast<TestPooledService*>(service3)->state == 0, "Testing pooled instance reset")
+  US_TEST_CONDITION(factory.created == 2, "Testing factory calls")
+
+  ServicePoolStatistics statistics = reg.GetPoolStatistics();
+  US_TEST_CONDITION(statistics.created == 2 && statistics.reused == 1 && statistics.recycled == 1 &&
+                    statistics.discarded == 1 && statistics.idle == 0, "Testing pool statistics")
+
+  serviceObjects.UngetService(service3);
+  reg.Unregister();
+  US_TEST_CONDITION(factory.released == 2, "Testing release of pooled instances")
+
+  return EXIT_SUCCESS;
+}
+
+int TestManyPrototypeServices()
+{
+  ModuleContext* context = GetModuleContext();
+
+  TestPooledServiceFactory factory;
+  ServiceRegistration<ITestServiceA> reg = context->RegisterService<ITestServiceA>(&factory);
+  ServiceObjects<ITestServiceA> serviceObjects = context->GetServiceObjects(reg.GetReference());
+
+  const std::size_t servicesInUse = context->GetModule()->GetServicesInUse().size();
+  std::vector<ITestServiceA*> services;
+  for (int i = 0; i < 100; ++i)
+  {
+    services.push_back(serviceObjects.GetService());
+  }
+  US_TEST_CONDITION(context->GetModule()->GetServicesInUse().size() == servicesInUse + 1, "Testing prototype services in use")
+
+  // release in a different order than the instances were created
+  for (std::size_t i = 0; i < services.size(); i += 2)
+  {
+    serviceObjects.UngetService(services[i]);
+  }
+  US_TEST_CONDITION(factory.released == 50, "Testing release of every other instance")
+  for (std::size_t i = 0; i < 50; ++i)
+  {
+    services[2*i] = serviceObjects.GetService();
+  }
+  for (std::size_t i = services.size(); i > 0; --i)
+  {
+    serviceObjects.UngetService(services[i-1]);
+  }
+  US_TEST_CONDITION(factory.released == 150 && factory.created == 150, "Testing release of all instances")
+  US_TEST_CONDITION(context->GetModule()->GetServicesInUse().size() == servicesInUse, "Testing prototype services not in use")
+
+  reg.Unregister();
+  return EXIT_SUCCESS;
+}
+
+struct TestReentrantServiceFactory : public ServiceFactory
+{
+  TestReentrantServiceFactory() : usingModules(0) {}
+
+  InterfaceMap GetService(Module* /*module*/, const ServiceRegistrationBase& registration)
+  {
+    // the factory is called without holding a registration lock
+    std::vector<Module*> modules;
+    registration.GetReference().GetUsingModules(modules);
+    usingModules = modules.size();
+    return MakeInterfaceMap<ITestServiceA>(&service);
+  }
+
+  void UngetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/,
+                    const InterfaceMap& /*service*/)
+  {
+  }
+
+  TestPooledService service;
+  std::size_t usingModules;
+};
+
+int TestServiceFactoryOutsideLock()
+{
+  ModuleContext* context = GetModuleContext();
+
+  TestReentrantServiceFactory factory;
+  ServiceRegistration<ITestServiceA> reg = context->RegisterService<ITestServiceA>(&factory);
+  ServiceReference<ITestServiceA> ref = reg.GetReference();
+
+  US_TEST_CONDITION_REQUIRED(context->GetService(ref) == &factory.service, "Testing re-entrant factory")
+  US_TEST_CONDITION(factory.usingModules == 0, "Testing using modules during factory call")
+  US_TEST_CONDITION(context->GetService(ref) == &factory.service, "Testing cached module scope service")
+  US_TEST_CONDITION(context->UngetService(ref) == false, "Testing use count")
+  US_TEST_CONDITION(context->UngetService(ref) == true, "Testing use count")
+
+  reg.Unregister();
+  return EXIT_SUCCESS;
+}
+
+struct TestRecursiveServiceFactory : public ServiceFactory
+{
+  TestRecursiveServiceFactory() : recursiveService(&service) {}
+
+  InterfaceMap GetService(Module* module, const ServiceRegistrationBase& registration)
+  {
+    // getting the service which is being produced must not deadlock
+    ServiceReference<ITestServiceA> ref = registration.GetReference();
+    recursiveService = module->GetModuleContext()->GetService(ref);
+    return MakeInterfaceMap<ITestServiceA>(&service);
+  }
+
+  void UngetService(Module* /*module*/, const ServiceRegistrationBase& /*registration*/,
+                    const InterfaceMap& /*service*/)
+  {
+  }
+
+  TestPooledService service;
+  ITestServiceA* recursiveService;
+};
+
+int TestServiceFactoryRecursion()
+{
+  ModuleContext* context = GetModuleContext();
+
+  TestRecursiveServiceFactory factory;
+  ServiceRegistration<ITestServiceA> reg = context->RegisterService<ITestServiceA>(&factory);
+  ServiceReference<ITestServiceA> ref = reg.GetReference();
+
+  US_TEST_CONDITION_REQUIRED(context->GetService(ref) == &factory.service, "Testing recursive factory")
+  US_TEST_CONDITION(factory.recursiveService == NULL, "Testing recursive get")
+  US_TEST_CONDITION(context->UngetService(ref) == true, "Testing use count")
+
+  reg.Unregister();
+  return EXIT_SUCCESS;
+}
+
+struct TestQueueExecutor : public ServiceExecutor
+{
+  ~TestQueueExecutor()
+  {
+    RunAll();
+  }
+
+  void Execute(ServiceTask* task)
+  {
+    tasks.push_back(task);
+  }
+
+  void RunAll()
+  {
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+    {
+      tasks[i]->Run();
+      delete tasks[i];
+    }
+    tasks.clear();
+  }
+
+  std::vector<ServiceTask*> tasks;
+};
+
+int TestDeferredUnregistration()
+{
+  ModuleContext* context = GetModuleContext();
+
+  TestPooledServiceFactory factory;
+  ServiceRegistration<ITestServiceA> reg = context->RegisterService<ITestServiceA>(&factory);
+  ServiceReference<ITestServiceA> ref = reg.GetReference();
+  ServiceObjects<ITestServiceA> serviceObjects = context->GetServiceObjects(ref);
+  serviceObjects.GetService();
+  serviceObjects.GetService();
+  context->GetService(ref);
+
+  TestQueueExecutor executor;
+  ServiceFuture future = reg.Unregister(&executor);
+  US_TEST_CONDITION(ref.GetModule() == NULL, "Testing service unavailable after unregistration")
+  US_TEST_CONDITION(executor.tasks.size() == 3, "Testing one task per service object")
+  US_TEST_CONDITION(factory.released == 0 && !future.IsDone(), "Testing deferred release")
+  US_TEST_CONDITION(!future.Wait(1), "Testing wait timeout")
+
+  executor.RunAll();
+  US_TEST_CONDITION(factory.released == 3 && future.IsDone() && future.Wait(), "Testing completed release")
+
+  ServiceRegistration<ITestServiceA> reg2 = context->RegisterService<ITestServiceA>(&factory);
+  US_TEST_CONDITION(reg2.Unregister(&executor).IsDone() && executor.tasks.empty(), "Testing unregistration of unused service")
+
+  return EXIT_SUCCESS;
+}
+
+struct TestHidingFindHook : public ServiceFindHook
+{
+  TestHidingFindHook() : calls(0) {}
+
+  void Find(const ModuleContext* /*context*/, const std::string& name,
+            const std::string& /*filter*/, ShrinkableVector<ServiceReferenceBase>& references)
+  {
+    if (name == us_service_interface_iid<ITestServiceA>())
+    {
+      ++calls;
+      references.clear();
+    }
+  }
+
+  int calls;
+};
+
+int TestRegistryEpoch()
+{
+  struct TestServiceA : public ITestServiceA
+  {
+  };
+
+  ModuleContext* context = GetModuleContext();
+  const std::string unrelatedClass = "org.cppmicroservices.testing.Unrelated";
+
+  TestServiceA s1;
+  TestServiceA s2;
+
+  const int epoch = context->GetServiceRegistryEpoch();
+  const int unrelatedEpoch = context->GetServiceRegistryEpoch(unrelatedClass);
+  US_TEST_CONDITION_REQUIRED(!context->GetServiceReference<ITestServiceA>(), "Testing no service")
+
+  ServiceRegistration<ITestServiceA> reg1 = context->RegisterService<ITestServiceA>(&s1);
+  const int classEpoch = context->GetServiceRegistryEpoch<ITestServiceA>();
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch() > epoch, "Testing epoch after registration")
+  US_TEST_CONDITION_REQUIRED(classEpoch == context->GetServiceRegistryEpoch(), "Testing class epoch after registration")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch(unrelatedClass) == unrelatedEpoch, "Testing unrelated class epoch")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg1.GetReference(), "Testing registered service")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg1.GetReference(), "Testing repeated lookup")
+
+  // changes of other classes neither affect the class epoch nor the result
+  InterfaceMap unrelated;
+  unrelated.insert(std::make_pair(unrelatedClass, static_cast<void*>(&s2)));
+  ServiceRegistrationU unrelatedReg = context->RegisterService(unrelated);
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch(unrelatedClass) > classEpoch, "Testing unrelated class epoch after registration")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch<ITestServiceA>() == classEpoch, "Testing unchanged class epoch")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg1.GetReference(), "Testing lookup after unrelated change")
+  unrelatedReg.Unregister();
+
+  ServiceProperties props;
+  props[ServiceConstants::SERVICE_RANKING()] = 10;
+  ServiceRegistration<ITestServiceA> reg2 = context->RegisterService<ITestServiceA>(&s2, props);
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg2.GetReference(), "Testing higher ranked service")
+
+  int lastEpoch = context->GetServiceRegistryEpoch<ITestServiceA>();
+  props[ServiceConstants::SERVICE_RANKING()] = 20;
+  reg1.SetProperties(props);
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch<ITestServiceA>() > lastEpoch, "Testing class epoch after ranking change")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg1.GetReference(), "Testing lookup after ranking change")
+
+  lastEpoch = context->GetServiceRegistryEpoch<ITestServiceA>();
+  props["tag"] = std::string("on");
+  reg1.SetProperties(props);
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch<ITestServiceA>() > lastEpoch, "Testing class epoch after property change")
+
+  {
+    TestHidingFindHook findHook;
+    ServiceRegistration<ServiceFindHook> hookReg = context->RegisterService<ServiceFindHook>(&findHook);
+    US_TEST_CONDITION_REQUIRED(!context->GetServiceReference<ITestServiceA>(), "Testing lookup with find hook")
+    US_TEST_CONDITION_REQUIRED(!context->GetServiceReference<ITestServiceA>(), "Testing repeated lookup with find hook")
+    US_TEST_CONDITION_REQUIRED(findHook.calls == 2, "Testing find hook called for every lookup")
+    hookReg.Unregister();
+  }
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg1.GetReference(), "Testing lookup after find hook removal")
+
+  reg1.Unregister();
+  US_TEST_CONDITION_REQUIRED(context->GetServiceReference<ITestServiceA>() == reg2.GetReference(), "Testing lookup after unregistration")
+  reg2.Unregister();
+  US_TEST_CONDITION_REQUIRED(!context->GetServiceReference<ITestServiceA>(), "Testing lookup without services")
+  US_TEST_CONDITION_REQUIRED(context->GetServiceRegistryEpoch<ITestServiceA>() == context->GetServiceRegistryEpoch(), "Testing class epoch after unregistration")
+
+  return EXIT_SUCCESS;
+}
 
 int usServiceRegistryTest(int /*argc*/, char* /*argv*/[])
 {
@@ -133,6 +763,17 @@ int usServiceRegistryTest(int /*argc*/, char* /*argv*/[])
 
   US_TEST_CONDITION(TestMultipleServiceRegistrations() == EXIT_SUCCESS, "Testing service registrations: ")
   US_TEST_CONDITION(TestServicePropertiesUpdate() == EXIT_SUCCESS, "Testing service property update: ")
+  US_TEST_CONDITION(TestServicePropertiesDelta() == EXIT_SUCCESS, "Testing service property delta update: ")
+  US_TEST_CONDITION(TestSingletonServiceUseCount() == EXIT_SUCCESS, "Testing singleton service use count: ")
+  US_TEST_CONDITION(TestConcurrentSingletonServiceUse() == EXIT_SUCCESS, "Testing concurrent singleton service use: ")
+  US_TEST_CONDITION(TestServiceHandle() == EXIT_SUCCESS, "Testing service handles: ")
+  US_TEST_CONDITION(TestCompiledFilterLookup() == EXIT_SUCCESS, "Testing compiled filter lookup: ")
+  US_TEST_CONDITION(TestPrototypeServicePool() == EXIT_SUCCESS, "Testing prototype service pool: ")
+  US_TEST_CONDITION(TestManyPrototypeServices() == EXIT_SUCCESS, "Testing many prototype services: ")
+  US_TEST_CONDITION(TestServiceFactoryOutsideLock() == EXIT_SUCCESS, "Testing service factory calls without lock: ")
+  US_TEST_CONDITION(TestServiceFactoryRecursion() == EXIT_SUCCESS, "Testing recursive service factory calls: ")
+  US_TEST_CONDITION(TestDeferredUnregistration() == EXIT_SUCCESS, "Testing deferred unregistration: ")
+  US_TEST_CONDITION(TestRegistryEpoch() == EXIT_SUCCESS, "Testing registry epoch: ")
 
   US_TEST_END()
 }
@@ -27,8 +27,11 @@ See LICENSE.txt or http://www.mitk.org for details.
 #include <usSharedLibrary.h>
 
 #include "usServiceControlInterface.h"
+#include "usTestThread.h"
 
 #include <memory>
+#include <set>
+#include <stdexcept>
 
 US_USE_NAMESPACE
 
@@ -66,6 +69,11 @@ struct MyInterfaceTwo {
 };
 US_DECLARE_SERVICE_INTERFACE(MyInterfaceTwo, "org.cppmicroservices.servicetrackertest.MyInterfaceTwo")
 
+struct MyInterfaceThree {
+  virtual ~MyInterfaceThree() {}
+};
+US_DECLARE_SERVICE_INTERFACE(MyInterfaceThree, "org.cppmicroservices.servicetrackertest.MyInterfaceThree")
+
 class MyCustomizer : public us::ServiceTrackerCustomizer<MyInterfaceOne>
 {
 
@@ -119,6 +127,734 @@ void TestFilterString()
   US_TEST_CONDITION(tracker.GetServiceReferences().size() == 1, "tracking count")
 }
 
+struct MyServiceThree : public MyInterfaceThree {};
+
+// The services and the tracker used by the MyInterfaceThree tests. The
+// tracker is not opened, services still registered at the end of a test
+// are unregistered.
+struct TrackerFixture
+{
+  static const std::size_t ServiceCount = 4;
+
+  TrackerFixture()
+    : context(us::GetModuleContext()), tracker(context)
+  {}
+
+  ~TrackerFixture()
+  {
+    tracker.Close();
+    for (std::size_t i = 0; i < ServiceCount; ++i)
+    {
+      if (!regs[i]) continue;
+      try
+      {
+        regs[i].Unregister();
+      }
+      catch (const std::logic_error&)
+      {
+        // unregistered by the test
+      }
+    }
+  }
+
+  us::ServiceRegistration<MyInterfaceThree>& Register(std::size_t i)
+  {
+    regs[i] = context->RegisterService<MyInterfaceThree>(&services[i]);
+    return regs[i];
+  }
+
+  us::ServiceRegistration<MyInterfaceThree>& Register(std::size_t i, int ranking)
+  {
+    us::ServiceProperties props;
+    props[us::ServiceConstants::SERVICE_RANKING()] = ranking;
+    regs[i] = context->RegisterService<MyInterfaceThree>(&services[i], props);
+    return regs[i];
+  }
+
+  us::ModuleContext* context;
+  MyServiceThree services[ServiceCount];
+  us::ServiceRegistration<MyInterfaceThree> regs[ServiceCount];
+  us::ServiceTracker<MyInterfaceThree> tracker;
+};
+
+void TestCachedService()
+{
+  TrackerFixture f;
+  f.Register(0);
+  f.tracker.Open();
+
+  US_TEST_CONDITION_REQUIRED(f.tracker.GetService() == &f.services[0], "Initial service")
+  US_TEST_CONDITION_REQUIRED(f.tracker.GetService() == &f.services[0], "Cached service")
+
+  f.Register(1, 10);
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[1], "Cache invalidated by higher ranked service")
+  US_TEST_CONDITION(f.tracker.GetServiceReference() == f.regs[1].GetReference(), "Cached reference invalidated")
+
+  f.regs[1].Unregister();
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[0], "Cache invalidated by unregistration")
+
+  f.regs[0].Unregister();
+  US_TEST_CONDITION(f.tracker.GetService() == NULL, "No service after unregistration")
+  US_TEST_FOR_EXCEPTION(const us::ServiceException&, f.tracker.GetServiceReference())
+}
+
+void TestRankingOrder()
+{
+  TrackerFixture f;
+  f.tracker.Open();
+
+  f.Register(0);
+  f.Register(1);
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[0], "Equal ranking, lowest id first")
+
+  f.Register(2, 5);
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[2], "Highest ranking first")
+
+  us::ServiceProperties props;
+  props[us::ServiceConstants::SERVICE_RANKING()] = 10;
+  f.regs[1].SetProperties(props);
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[1], "Ranking increase reorders services")
+
+  props[us::ServiceConstants::SERVICE_RANKING()] = -1;
+  f.regs[1].SetProperties(props);
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[2], "Ranking decrease reorders services")
+  US_TEST_CONDITION(f.tracker.Size() == 3, "Ranking changes keep all services tracked")
+
+  f.regs[2].Unregister();
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[0], "Unregistration reorders services")
+
+  f.regs[0].Unregister();
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[1], "Negative ranking service")
+
+  f.regs[1].Unregister();
+  US_TEST_CONDITION(f.tracker.GetService() == NULL, "No service after unregistration")
+  US_TEST_CONDITION(f.tracker.IsEmpty(), "Tracker is empty")
+}
+
+class CountingCustomizer : public us::ServiceTrackerCustomizer<MyInterfaceThree>
+{
+
+public:
+
+  CountingCustomizer(us::ModuleContext* context)
+    : m_context(context), added(0)
+  {}
+
+  virtual MyInterfaceThree* AddingService(const ServiceReferenceType& reference)
+  {
+    ++added;
+    return m_context->GetService(reference);
+  }
+
+  virtual void ModifiedService(const ServiceReferenceType& /*reference*/, MyInterfaceThree* /*service*/)
+  {
+  }
+
+  virtual void RemovedService(const ServiceReferenceType& reference, MyInterfaceThree* /*service*/)
+  {
+    m_context->UngetService(reference);
+  }
+
+private:
+
+  us::ModuleContext* m_context;
+
+public:
+
+  int added;
+};
+
+// Collects tasks until the batch is complete and then runs them, after
+// optionally unregistering a service whose task is still pending.
+struct BatchExecutor : public us::ServiceExecutor
+{
+  BatchExecutor(std::size_t batchSize, us::ServiceRegistration<MyInterfaceThree>* cancel)
+    : batchSize(batchSize), cancel(cancel), executed(0)
+  {}
+
+  void Execute(us::ServiceTask* task)
+  {
+    tasks.push_back(task);
+    if (tasks.size() < batchSize) return;
+
+    if (cancel) cancel->Unregister();
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+    {
+      tasks[i]->Run();
+      delete tasks[i];
+      ++executed;
+    }
+    tasks.clear();
+  }
+
+  std::size_t batchSize;
+  us::ServiceRegistration<MyInterfaceThree>* cancel;
+  std::size_t executed;
+  std::vector<us::ServiceTask*> tasks;
+};
+
+void TestOpenWithExecutor()
+{
+  TrackerFixture f;
+  us::ModuleContext* context = f.context;
+  f.Register(0);
+  f.Register(1);
+  f.Register(2);
+
+  {
+    CountingCustomizer customizer(context);
+    BatchExecutor executor(3, NULL);
+    us::ServiceTracker<MyInterfaceThree> tracker(context, &customizer);
+    tracker.Open(&executor);
+    US_TEST_CONDITION(executor.executed == 3, "One task per initial service")
+    US_TEST_CONDITION(customizer.added == 3 && tracker.Size() == 3, "Initial services tracked")
+    US_TEST_CONDITION(tracker.GetService() == &f.services[0], "Highest ranked initial service")
+  }
+
+  {
+    CountingCustomizer customizer(context);
+    BatchExecutor executor(3, &f.regs[1]);
+    us::ServiceTracker<MyInterfaceThree> tracker(context, &customizer);
+    tracker.Open(&executor);
+    US_TEST_CONDITION(executor.executed == 3, "Cancelled task was run")
+    US_TEST_CONDITION(customizer.added == 2, "Customizer not called for unregistered service")
+    US_TEST_CONDITION(tracker.Size() == 2, "Unregistered service not tracked")
+  }
+}
+
+// Queues the initial task and then makes its service stop and start
+// matching the tracker filter, so it is untracked and tracked again.
+// The customizer runs the queued task while the service is re-added.
+struct RetrackExecutor : public us::ServiceExecutor
+{
+  RetrackExecutor(us::ServiceRegistration<MyInterfaceThree>& reg)
+    : reg(reg)
+  {}
+
+  void Execute(us::ServiceTask* task)
+  {
+    tasks.push_back(task);
+    us::ServiceProperties props;
+    props["tag"] = std::string("off");
+    reg.SetProperties(props);
+    props["tag"] = std::string("on");
+    reg.SetProperties(props);
+    RunTasks();
+  }
+
+  void RunTasks()
+  {
+    std::vector<us::ServiceTask*> pending;
+    pending.swap(tasks);
+    for (std::size_t i = 0; i < pending.size(); ++i)
+    {
+      pending[i]->Run();
+      delete pending[i];
+    }
+  }
+
+  us::ServiceRegistration<MyInterfaceThree>& reg;
+  std::vector<us::ServiceTask*> tasks;
+};
+
+class RetrackCustomizer : public CountingCustomizer
+{
+
+public:
+
+  RetrackCustomizer(us::ModuleContext* context, RetrackExecutor& executor)
+    : CountingCustomizer(context), m_executor(executor)
+  {}
+
+  virtual MyInterfaceThree* AddingService(const ServiceReferenceType& reference)
+  {
+    MyInterfaceThree* service = CountingCustomizer::AddingService(reference);
+    m_executor.RunTasks();
+    return service;
+  }
+
+private:
+
+  RetrackExecutor& m_executor;
+};
+
+void TestStaleInitialTask()
+{
+  TrackerFixture f;
+  us::ModuleContext* context = f.context;
+  us::ServiceProperties props;
+  props["tag"] = std::string("on");
+  f.regs[0] = context->RegisterService<MyInterfaceThree>(&f.services[0], props);
+
+  RetrackExecutor executor(f.regs[0]);
+  RetrackCustomizer customizer(context, executor);
+  us::LDAPFilter filter("(&(" + us::ServiceConstants::OBJECTCLASS() + "=" +
+                        us_service_interface_iid<MyInterfaceThree>() + ")(tag=on))");
+  us::ServiceTracker<MyInterfaceThree> tracker(context, filter, &customizer);
+  tracker.Open(&executor);
+  US_TEST_CONDITION(customizer.added == 1, "Customizer called once for a re-tracked initial service")
+  US_TEST_CONDITION(tracker.Size() == 1 && tracker.GetService() == &f.services[0], "Re-tracked initial service")
+}
+
+struct CountingCallback : public us::ServiceAvailableCallback<MyInterfaceThree>
+{
+  CountingCallback()
+    : called(0), service(NULL)
+  {}
+
+  void ServiceAvailable(const ServiceReferenceType& ref, MyInterfaceThree* s)
+  {
+    ++called;
+    reference = ref;
+    service = s;
+  }
+
+  int called;
+  ServiceReferenceType reference;
+  MyInterfaceThree* service;
+};
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+
+// Gets the tracked service until it is stopped. The first service of the
+// fixture stays registered, so every read must return a tracked service.
+class TrackedServiceReader : public TestThread
+{
+
+public:
+
+  TrackedServiceReader(TrackerFixture& fixture)
+    : reads(0), invalidReads(0), fixture(fixture)
+  {}
+
+  void Stop()
+  {
+    stopped.Store(true);
+  }
+
+  int reads;
+  int invalidReads;
+
+protected:
+
+  void Run()
+  {
+    while (!stopped.Load())
+    {
+      MyInterfaceThree* service = fixture.tracker.GetService();
+      if (service != &fixture.services[0] && service != &fixture.services[1]) ++invalidReads;
+      ++reads;
+    }
+  }
+
+private:
+
+  TrackerFixture& fixture;
+  AtomicFlag stopped;
+};
+
+// Holds tracked snapshots across modifications of the tracker until it is
+// stopped. A held snapshot must stay unchanged while newer ones replace it.
+class SnapshotReader : public TestThread
+{
+
+public:
+
+  SnapshotReader(TrackerFixture& fixture)
+    : reads(0), invalidReads(0), fixture(fixture)
+  {}
+
+  void Stop()
+  {
+    stopped.Store(true);
+  }
+
+  int reads;
+  int invalidReads;
+
+protected:
+
+  void Run()
+  {
+    typedef us::ServiceTracker<MyInterfaceThree>::SnapshotHandle SnapshotHandle;
+    while (!stopped.Load())
+    {
+      SnapshotHandle snapshot = fixture.tracker.GetTrackedSnapshot();
+      const std::vector<MyInterfaceThree*> services = snapshot->GetServices();
+      TestThread::YieldCurrentThread();
+      if (services.empty() || services != snapshot->GetServices() ||
+          snapshot->GetServiceReferences().size() != services.size())
+      {
+        ++invalidReads;
+      }
+      ++reads;
+    }
+  }
+
+private:
+
+  TrackerFixture& fixture;
+  AtomicFlag stopped;
+};
+
+// Registers callbacks and futures with WhenAvailable until it is stopped
+class AvailableCallbackRegistrar : public TestThread
+{
+
+public:
+
+  AvailableCallbackRegistrar(us::ServiceTracker<MyInterfaceThree>& tracker)
+    : tracker(tracker)
+  {}
+
+  ~AvailableCallbackRegistrar()
+  {
+    for (std::size_t i = 0; i < callbacks.size(); ++i)
+    {
+      delete callbacks[i];
+    }
+  }
+
+  void Stop()
+  {
+    stopped.Store(true);
+  }
+
+  std::vector<CountingCallback*> callbacks;
+  std::vector<us::ServiceFuture> futures;
+
+protected:
+
+  void Run()
+  {
+    for (int i = 0; i < 2000 && !stopped.Load(); ++i)
+    {
+      callbacks.push_back(new CountingCallback());
+      tracker.WhenAvailable(callbacks.back());
+      futures.push_back(tracker.WhenAvailable());
+      TestThread::YieldCurrentThread();
+    }
+  }
+
+private:
+
+  us::ServiceTracker<MyInterfaceThree>& tracker;
+  AtomicFlag stopped;
+};
+
+#endif
+
+void TestWhenAvailable()
+{
+  TrackerFixture f;
+  f.tracker.Open();
+
+  US_TEST_FOR_EXCEPTION(const std::invalid_argument&, f.tracker.WhenAvailable(NULL))
+
+  CountingCallback waiting;
+  CountingCallback cancelled;
+  f.tracker.WhenAvailable(&waiting);
+  f.tracker.WhenAvailable(&cancelled);
+  us::ServiceFuture future = f.tracker.WhenAvailable();
+  US_TEST_CONDITION(waiting.called == 0, "Callback not called without service")
+  US_TEST_CONDITION(!future.IsDone(), "Future not done without service")
+  US_TEST_CONDITION(f.tracker.CancelWhenAvailable(&cancelled), "Cancel pending callback")
+  US_TEST_CONDITION(!f.tracker.CancelWhenAvailable(&cancelled), "Cancel removed callback")
+
+  f.Register(0);
+  US_TEST_CONDITION(waiting.called == 1 && waiting.service == &f.services[0], "Callback called for added service")
+  US_TEST_CONDITION(waiting.reference == f.regs[0].GetReference(), "Callback reference")
+  US_TEST_CONDITION(cancelled.called == 0, "Cancelled callback not called")
+  US_TEST_CONDITION(future.IsDone() && future.Wait(), "Future done for added service")
+
+  f.Register(1);
+  US_TEST_CONDITION(waiting.called == 1, "Callback called once")
+
+  CountingCallback available;
+  f.tracker.WhenAvailable(&available);
+  US_TEST_CONDITION(available.called == 1 && available.service == &f.services[0], "Callback called for tracked service")
+  US_TEST_CONDITION(f.tracker.WaitForService(1) == &f.services[0], "Wait for tracked service")
+  US_TEST_CONDITION(f.tracker.WhenAvailable().IsDone(), "Future done for tracked service")
+
+  f.regs[0].Unregister();
+  f.regs[1].Unregister();
+  US_TEST_CONDITION(f.tracker.WaitForService(1) == NULL, "Wait for service timed out")
+
+  CountingCallback closed;
+  f.tracker.WhenAvailable(&closed);
+  us::ServiceFuture closedFuture = f.tracker.WhenAvailable();
+  US_TEST_CONDITION(!closedFuture.IsDone(), "Future not done after unregistration")
+  f.tracker.Close();
+  US_TEST_CONDITION(closedFuture.IsDone() && !f.tracker.GetService(), "Future done on close")
+  US_TEST_CONDITION(closed.called == 1 && !closed.reference && closed.service == NULL, "Callback called on close")
+}
+
+void TestTrackedSnapshot()
+{
+  TrackerFixture f;
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot()->IsEmpty(), "Empty snapshot if not open")
+
+  f.Register(0);
+  f.tracker.Open();
+
+  typedef us::ServiceTracker<MyInterfaceThree>::SnapshotHandle SnapshotHandle;
+  SnapshotHandle snapshot1 = f.tracker.GetTrackedSnapshot();
+  US_TEST_CONDITION(snapshot1->GetServiceReferences().size() == 1, "One tracked reference")
+  US_TEST_CONDITION(snapshot1->GetServices().size() == 1 && snapshot1->GetServices().front() == &f.services[0], "One tracked service")
+  US_TEST_CONDITION(snapshot1->GetTrackingCount() == f.tracker.GetTrackingCount(), "Snapshot tracking count")
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot() == snapshot1, "Unmodified snapshot is shared")
+
+  f.Register(1);
+  SnapshotHandle snapshot2 = f.tracker.GetTrackedSnapshot();
+  US_TEST_CONDITION(snapshot2 != snapshot1, "New snapshot after modification")
+  US_TEST_CONDITION(snapshot2->GetServices().size() == 2, "Two tracked services")
+  US_TEST_CONDITION(snapshot1->GetServices().size() == 1, "Old snapshot unchanged")
+  US_TEST_CONDITION(f.tracker.GetServices().size() == 2, "GetServices uses the snapshot")
+  US_TEST_CONDITION(f.tracker.GetServiceReferences().size() == 2, "GetServiceReferences uses the snapshot")
+
+  f.regs[0].Unregister();
+  f.regs[1].Unregister();
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot()->IsEmpty(), "Empty snapshot without services")
+  US_TEST_CONDITION(snapshot2->GetServices().size() == 2, "Held snapshot outlives modifications")
+
+  f.tracker.Close();
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot()->IsEmpty(), "Empty snapshot after close")
+}
+
+void TestSelectionPolicies()
+{
+  TrackerFixture f;
+  f.Register(3, -1);
+  f.Register(0);
+  f.Register(1);
+  f.Register(2);
+
+  US_TEST_CONDITION(!f.tracker.SelectService(), "No lease if not open")
+  f.tracker.Open();
+
+  typedef us::ServiceLease<MyInterfaceThree> Lease;
+
+  // without a policy, the highest ranked service with the lowest id
+  for (int i = 0; i < 3; ++i)
+  {
+    US_TEST_CONDITION(f.tracker.SelectService().Get() == &f.services[0], "Default selection")
+  }
+
+  // leases update the load statistics of the selected service
+  const us::ServiceLoad* load1 = f.tracker.GetTrackedSnapshot()->GetCandidates().front();
+  unsigned long callCount = load1->GetCallCount();
+  {
+    Lease lease = f.tracker.SelectService();
+    Lease copy = lease;
+    US_TEST_CONDITION(load1->GetInFlight() == 1, "Call in flight")
+    lease.Release();
+    US_TEST_CONDITION(load1->GetInFlight() == 0, "Call ended")
+  }
+  US_TEST_CONDITION(load1->GetCallCount() == callCount + 1, "Call counted once")
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot()->GetCandidates().size() == 3, "Equal ranked candidates")
+
+  us::RoundRobinSelectionPolicy roundRobin;
+  f.tracker.SetSelectionPolicy(&roundRobin);
+  std::set<MyInterfaceThree*> selected;
+  for (int i = 0; i < 3; ++i)
+  {
+    selected.insert(f.tracker.SelectService().Get());
+  }
+  US_TEST_CONDITION(selected.size() == 3 && selected.count(&f.services[3]) == 0, "Round robin selects all candidates")
+
+  us::RandomSelectionPolicy random(42);
+  f.tracker.SetSelectionPolicy(&random);
+  selected.clear();
+  for (int i = 0; i < 100; ++i)
+  {
+    selected.insert(f.tracker.SelectService().Get());
+  }
+  US_TEST_CONDITION(selected.size() == 3 && selected.count(&f.services[3]) == 0, "Random selects all candidates")
+
+  us::LeastInFlightSelectionPolicy leastInFlight;
+  f.tracker.SetSelectionPolicy(&leastInFlight);
+  {
+    Lease first = f.tracker.SelectService();
+    Lease second = f.tracker.SelectService();
+    Lease third = f.tracker.SelectService();
+    selected.clear();
+    selected.insert(first.Get());
+    selected.insert(second.Get());
+    selected.insert(third.Get());
+    US_TEST_CONDITION(selected.size() == 3, "Least in flight spreads concurrent calls")
+  }
+
+  us::PowerOfTwoChoicesSelectionPolicy twoChoices(7);
+  f.tracker.SetSelectionPolicy(&twoChoices);
+  {
+    f.tracker.SetSelectionPolicy(NULL);
+    Lease busy1 = f.tracker.SelectService();
+    Lease busy2 = f.tracker.SelectService();
+    f.tracker.SetSelectionPolicy(&twoChoices);
+    bool avoidsBusiest = true;
+    for (int i = 0; i < 50; ++i)
+    {
+      avoidsBusiest = avoidsBusiest && f.tracker.SelectService().Get() != &f.services[0];
+    }
+    US_TEST_CONDITION(avoidsBusiest, "Power of two choices avoids the busiest service")
+  }
+
+  f.regs[0].Unregister();
+  f.regs[1].Unregister();
+  f.regs[2].Unregister();
+  US_TEST_CONDITION(f.tracker.SelectService().Get() == &f.services[3], "Lower ranked service if no other")
+  f.regs[3].Unregister();
+  US_TEST_CONDITION(!f.tracker.SelectService(), "No lease without services")
+  f.tracker.Close();
+}
+
+void TestConcurrentCachedService()
+{
+#ifdef US_ENABLE_THREADING_SUPPORT
+  const std::size_t threadCount = 4;
+
+  TrackerFixture f;
+  f.Register(0);
+  f.tracker.Open();
+
+  std::vector<TrackedServiceReader*> readers;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    readers.push_back(new TrackedServiceReader(f));
+    readers.back()->Start();
+  }
+
+  // invalidate the cache by registration, ranking changes and
+  // unregistration while the readers use it
+  us::ServiceProperties props;
+  for (int i = 0; i < 500; ++i)
+  {
+    f.Register(1, 10);
+    props[us::ServiceConstants::SERVICE_RANKING()] = -1;
+    f.regs[1].SetProperties(props);
+    props[us::ServiceConstants::SERVICE_RANKING()] = 10;
+    f.regs[1].SetProperties(props);
+    f.regs[1].Unregister();
+  }
+
+  int reads = 0;
+  int invalidReads = 0;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    readers[i]->Stop();
+    readers[i]->Join();
+    reads += readers[i]->reads;
+    invalidReads += readers[i]->invalidReads;
+    delete readers[i];
+  }
+  US_TEST_CONDITION(reads > 0 && invalidReads == 0, "Cached service read concurrently with modifications")
+  US_TEST_CONDITION(f.tracker.GetService() == &f.services[0], "Cache valid after concurrent modifications")
+#endif
+}
+
+void TestConcurrentSnapshots()
+{
+#ifdef US_ENABLE_THREADING_SUPPORT
+  const std::size_t threadCount = 4;
+
+  TrackerFixture f;
+  f.Register(0);
+  f.tracker.Open();
+
+  std::vector<SnapshotReader*> readers;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    readers.push_back(new SnapshotReader(f));
+    readers.back()->Start();
+  }
+
+  // every modification replaces the snapshot the readers may be holding
+  for (int i = 0; i < 500; ++i)
+  {
+    f.Register(1);
+    f.regs[1].Unregister();
+  }
+
+  int reads = 0;
+  int invalidReads = 0;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    readers[i]->Stop();
+    readers[i]->Join();
+    reads += readers[i]->reads;
+    invalidReads += readers[i]->invalidReads;
+    delete readers[i];
+  }
+  US_TEST_CONDITION(reads > 0 && invalidReads == 0, "Held snapshots unchanged by concurrent modifications")
+
+  us::ServiceTracker<MyInterfaceThree>::SnapshotHandle snapshot = f.tracker.GetTrackedSnapshot();
+  US_TEST_CONDITION(snapshot->GetServices().size() == 1 && snapshot->GetServices().front() == &f.services[0],
+                    "Snapshot after concurrent modifications")
+  US_TEST_CONDITION(f.tracker.GetTrackedSnapshot() == snapshot, "Snapshot shared after concurrent modifications")
+#endif
+}
+
+void TestConcurrentClose()
+{
+#ifdef US_ENABLE_THREADING_SUPPORT
+  const std::size_t threadCount = 4;
+
+  for (int round = 0; round < 6; ++round)
+  {
+    TrackerFixture f;
+    f.tracker.Open();
+
+    std::vector<AvailableCallbackRegistrar*> registrars;
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      registrars.push_back(new AvailableCallbackRegistrar(f.tracker));
+      registrars.back()->Start();
+    }
+
+    // the pending callbacks are called either for the added service or
+    // by Close(), the registrars keep adding callbacks meanwhile
+    for (int i = 0; i < 10; ++i)
+    {
+      TestThread::YieldCurrentThread();
+    }
+    if (round % 2) f.Register(0);
+    f.tracker.Close();
+
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      registrars[i]->Stop();
+      registrars[i]->Join();
+    }
+
+    // callbacks added after Close() stay pending until they are cancelled
+    int wrongCalls = 0;
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      for (std::size_t j = 0; j < registrars[i]->callbacks.size(); ++j)
+      {
+        CountingCallback* callback = registrars[i]->callbacks[j];
+        const int pending = f.tracker.CancelWhenAvailable(callback) ? 1 : 0;
+        if (callback->called + pending != 1) ++wrongCalls;
+      }
+    }
+    US_TEST_CONDITION(wrongCalls == 0, "Callbacks called once when racing with Close")
+
+    // completes the futures added after the first Close()
+    f.tracker.Close();
+    int pendingFutures = 0;
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+      for (std::size_t j = 0; j < registrars[i]->futures.size(); ++j)
+      {
+        if (!registrars[i]->futures[j].IsDone()) ++pendingFutures;
+      }
+      delete registrars[i];
+    }
+    US_TEST_CONDITION(pendingFutures == 0, "Futures done after Close")
+  }
+#endif
+}
+
 void TestServiceTracker()
 {
 
@@ -277,6 +1013,16 @@ int usServiceTrackerTest(int /*argc*/, char* /*argv*/[])
   US_TEST_BEGIN("ServiceTrackerTest")
 
   TestFilterString();
+  TestCachedService();
+  TestRankingOrder();
+  TestOpenWithExecutor();
+  TestStaleInitialTask();
+  TestWhenAvailable();
+  TestTrackedSnapshot();
+  TestSelectionPolicies();
+  TestConcurrentCachedService();
+  TestConcurrentSnapshots();
+  TestConcurrentClose();
   TestServiceTracker();
 
   US_TEST_END()
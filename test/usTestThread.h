@@ -0,0 +1,119 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#ifndef USTESTTHREAD_H
+#define USTESTTHREAD_H
+
+#include "usConfig.h"
+
+#include <usThreads_p.h>
+
+#include <stdexcept>
+
+#ifdef US_PLATFORM_POSIX
+#include <sched.h>
+#endif
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+
+US_BEGIN_NAMESPACE
+
+/**
+ * A thread for tests which call the framework concurrently. Subclasses
+ * implement Run(), which is called on the new thread by Start().
+ */
+class TestThread
+{
+
+public:
+
+  TestThread()
+#ifdef US_PLATFORM_WINDOWS
+    : handle(NULL)
+#endif
+  {}
+
+  virtual ~TestThread() {}
+
+  void Start()
+  {
+#ifdef US_PLATFORM_WINDOWS
+    handle = CreateThread(NULL, 0, &TestThread::ThreadFunc, this, 0, NULL);
+    if (handle == NULL)
+      throw std::runtime_error("CreateThread() failed");
+#else
+    if (pthread_create(&thread, NULL, &TestThread::ThreadFunc, this) != 0)
+      throw std::runtime_error("pthread_create() failed");
+#endif
+  }
+
+  void Join()
+  {
+#ifdef US_PLATFORM_WINDOWS
+    WaitForSingleObject(handle, INFINITE);
+    CloseHandle(handle);
+#else
+    pthread_join(thread, NULL);
+#endif
+  }
+
+  /**
+   * Lets other threads run, also on a single processor.
+   */
+  static void YieldCurrentThread()
+  {
+#ifdef US_PLATFORM_WINDOWS
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  }
+
+protected:
+
+  virtual void Run() = 0;
+
+private:
+
+#ifdef US_PLATFORM_WINDOWS
+  static DWORD WINAPI ThreadFunc(LPVOID self)
+  {
+    static_cast<TestThread*>(self)->Run();
+    return 0;
+  }
+
+  HANDLE handle;
+#else
+  static void* ThreadFunc(void* self)
+  {
+    static_cast<TestThread*>(self)->Run();
+    return NULL;
+  }
+
+  pthread_t thread;
+#endif
+};
+
+US_END_NAMESPACE
+
+#endif // US_ENABLE_THREADING_SUPPORT
+
+#endif // USTESTTHREAD_H
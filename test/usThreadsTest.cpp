@@ -0,0 +1,174 @@
+/*=============================================================================
+
+  Library: CppMicroServices
+
+  Copyright (c) German Cancer Research Center,
+    Division of Medical and Biological Informatics
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=============================================================================*/
+
+#include <usSharedData.h>
+#include <usThreads_p.h>
+
+#include "usTestingMacros.h"
+#include "usTestThread.h"
+
+#include <vector>
+
+US_USE_NAMESPACE
+
+namespace {
+
+// A published object which counts its live instances
+struct PublishedValue : public SharedData
+{
+  PublishedValue(int value) : value(value) { instances.AtomicIncrement(); }
+  ~PublishedValue() { value = -1; instances.AtomicDecrement(); }
+
+  int value;
+
+  static AtomicCounter instances;
+};
+
+AtomicCounter PublishedValue::instances;
+
+typedef ExplicitlySharedDataPointer<const PublishedValue> PublishedValuePointer;
+
+#ifdef US_ENABLE_THREADING_SUPPORT
+
+// Loads the published value until it is stopped
+class PublishedValueReader : public TestThread
+{
+
+public:
+
+  PublishedValueReader(const PublishedPointer<const PublishedValue>& published)
+    : loads(0), invalidLoads(0), published(published)
+  {}
+
+  void Stop()
+  {
+    stopped.Store(true);
+  }
+
+  int loads;
+  int invalidLoads;
+
+protected:
+
+  void Run()
+  {
+    while (!stopped.Load())
+    {
+      PublishedValuePointer value;
+      published.Load(value);
+      if (value && value->value < 0) ++invalidLoads;
+      ++loads;
+    }
+  }
+
+private:
+
+  const PublishedPointer<const PublishedValue>& published;
+  AtomicFlag stopped;
+};
+
+#endif
+
+}
+
+void TestPublishedPointer()
+{
+  {
+    PublishedPointer<const PublishedValue> published;
+    PublishedValuePointer value;
+    published.Load(value);
+    US_TEST_CONDITION(!value, "test nothing published")
+
+    published.Store(new PublishedValue(1));
+    published.Load(value);
+    US_TEST_CONDITION(value && value->value == 1 && published.Get() == value.Data(), "test published value")
+
+    published.Store(new PublishedValue(2));
+    US_TEST_CONDITION(value->value == 1 && PublishedValue::instances.Load() == 2, "test loaded value is kept")
+    value.Reset();
+    US_TEST_CONDITION(PublishedValue::instances.Load() == 1, "test replaced value is released")
+
+    published.Store(NULL);
+    published.Load(value);
+    US_TEST_CONDITION(!value && PublishedValue::instances.Load() == 0, "test cleared value")
+
+    published.Store(new PublishedValue(3));
+  }
+  US_TEST_CONDITION(PublishedValue::instances.Load() == 0, "test destruction releases the value")
+}
+
+void TestPublishedPointerReaders()
+{
+#ifdef US_ENABLE_THREADING_SUPPORT
+  const std::size_t readerCount = 4;
+  {
+    PublishedPointer<const PublishedValue> published;
+    published.Store(new PublishedValue(0));
+
+    std::vector<PublishedValueReader*> readers;
+    for (std::size_t i = 0; i < readerCount; ++i)
+    {
+      readers.push_back(new PublishedValueReader(published));
+      readers.back()->Start();
+    }
+
+    for (int i = 1; i < 20000; ++i)
+    {
+      published.Store(new PublishedValue(i));
+    }
+
+    // Replaced values are released while the readers keep loading, once
+    // the readers which may use them made progress. Besides the published
+    // value, one value per reader and the last replaced one can be in use.
+    bool bounded = false;
+    for (int i = 0; i < 1000 && !bounded; ++i)
+    {
+      TestThread::YieldCurrentThread();
+      published.Store(new PublishedValue(i));
+      bounded = PublishedValue::instances.Load() <= static_cast<int>(readerCount) + 2;
+    }
+    US_TEST_CONDITION(bounded, "test values released while readers are active")
+
+    int loads = 0;
+    int invalidLoads = 0;
+    for (std::size_t i = 0; i < readerCount; ++i)
+    {
+      readers[i]->Stop();
+      readers[i]->Join();
+      loads += readers[i]->loads;
+      invalidLoads += readers[i]->invalidLoads;
+      delete readers[i];
+    }
+    US_TEST_CONDITION(loads > 0 && invalidLoads == 0, "test concurrently loaded values are valid")
+  }
+  US_TEST_CONDITION(PublishedValue::instances.Load() == 0, "test no values leaked")
+#endif
+}
+
+int usThreadsTest(int /*argc*/, char* /*argv*/[])
+{
+  US_TEST_BEGIN("ThreadsTest");
+
+  TestPublishedPointer();
+  TestPublishedPointerReaders();
+
+  US_TEST_END()
+}